@@ -46,6 +46,16 @@ def extract_features(logs):
             'page_faults_minor': summary.get('page_faults_minor', 0),
             'page_faults_major': summary.get('page_faults_major', 0),
             
+            # memory.high throttling cost (soft memory mode)
+            'memory_mode': summary.get('memory_mode', 'hard'),
+            'memory_high_events': summary.get('memory_high_events', 0),
+            'reclaim_pgscan': summary.get('reclaim_pgscan', 0),
+            'reclaim_pgsteal': summary.get('reclaim_pgsteal', 0),
+            'workingset_refault': summary.get('workingset_refault', 0),
+            'queue_wait_ms': summary.get('queue_wait_ms', 0),
+            'priority': summary.get('priority', 'batch'),
+            'frozen_ms': summary.get('frozen_ms', 0),
+            
             # Exit information
             'exit_reason': summary.get('exit_reason', 'UNKNOWN'),
             'termination': summary.get('termination', ''),
@@ -5,6 +5,10 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <errno.h>
+#include <unistd.h>
+#include <sys/prctl.h>
+#include <linux/filter.h>
+#include <linux/seccomp.h>
 
 #include <errno.h>
 
@@ -24,7 +28,7 @@
  * This function loads the seccomp filter into the kernel.
  * It uses a WHITELIST approach: Default action is KILL.
  */
-void install_syscall_filter(sandbox_profile_t profile) {
+int build_syscall_filter(sandbox_profile_t profile, struct sock_fprog *prog) {
     scmp_filter_ctx ctx;
 
     // 1. Initialize the filter.
@@ -46,7 +50,7 @@ void install_syscall_filter(sandbox_profile_t profile) {
 
     if (ctx == NULL) {
         perror("seccomp_init");
-        exit(1);
+        return -1;
     }
 
     // 2. Allow essential System Calls for a basic C/Python program.
@@ -85,15 +89,52 @@ void install_syscall_filter(sandbox_profile_t profile) {
     // Note: Python or standard libs might try to clone threads, which will fail here.
     // For this strict sandbox, we essentially allow single-threaded execution only.
     
-    // 4. Load the filter
+    // 4. Compile the filter to raw BPF.
+    // Compiling happens in the parent, once per profile: the cloned child may
+    // not call malloc() safely when the launcher is multi-threaded (batch mode),
+    // so it only has to hand the finished program to the kernel.
+    FILE *bpf = tmpfile();
+    if (!bpf || seccomp_export_bpf(ctx, fileno(bpf)) < 0) {
+        perror("seccomp_export_bpf");
+        if (bpf) fclose(bpf);
+        seccomp_release(ctx);
+        return -1;
+    }
+    seccomp_release(ctx);
+
+    long size = lseek(fileno(bpf), 0, SEEK_END);
+    prog->len = (unsigned short)(size / sizeof(struct sock_filter));
+    prog->filter = malloc(size);
+    if (!prog->filter || pread(fileno(bpf), prog->filter, size, 0) != size) {
+        perror("read seccomp program");
+        free(prog->filter);
+        fclose(bpf);
+        return -1;
+    }
+    fclose(bpf);
+    return 0;
+}
+
+// Allocation-free: safe to call in the cloned child right before execv()
+int load_syscall_filter(const struct sock_fprog *prog) {
+    if (prctl(PR_SET_NO_NEW_PRIVS, 1, 0, 0, 0) != 0) return -1;
+    return prctl(PR_SET_SECCOMP, SECCOMP_MODE_FILTER, prog);
+}
+
+void install_syscall_filter(sandbox_profile_t profile) {
+    struct sock_fprog prog;
+    if (build_syscall_filter(profile, &prog) != 0) {
+        exit(1);
+    }
+
     printf("[Sandbox] Loading Seccomp-BPF Profile...\n");
-    if (seccomp_load(ctx) < 0) {
+    if (load_syscall_filter(&prog) != 0) {
         perror("seccomp_load");
-        seccomp_release(ctx);
+        free(prog.filter);
         exit(1);
     }
 
-    seccomp_release(ctx);
+    free(prog.filter);
     printf("[Sandbox] Seccomp Enforced. System is locked down.\n");
 }
 
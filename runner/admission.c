@@ -0,0 +1,200 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "admission.h"
+#include "telemetry.h"
+
+/**
+ * ADMISSION CONTROL (Backpressure)
+ *
+ * Jobs queue in front of the supervisor and are only started while the host
+ * can carry them: PSI "some avg10" of cpu, memory and io under a bound, and
+ * MemAvailable above a floor. avg10 trails load by seconds, so while any
+ * resource is past half its bound we also space admissions one poll apart
+ * instead of releasing the whole queue into a host that is about to tip.
+ * The gate only holds batch jobs: an interactive job has someone waiting
+ * on it and goes past (counted as bypassed).
+ */
+
+#define PROGRESS_INTERVAL_MS 1000     // Live queue line while jobs are waiting
+
+static const char *psi_resources[3] = {"cpu", "memory", "io"};
+
+void admission_config_init(admission_config_t *config) {
+    memset(config, 0, sizeof(*config));
+    config->poll_ms = 100;
+}
+
+// "some avg10=1.23 avg60=..." from /proc/pressure/<resource>
+static double read_psi_some(const char *resource) {
+    char path[64], line[256];
+    snprintf(path, sizeof(path), "/proc/pressure/%s", resource);
+
+    FILE *fp = fopen(path, "r");
+    if (!fp) return -1.0;
+
+    double avg10 = -1.0;
+    while (fgets(line, sizeof(line), fp)) {
+        if (sscanf(line, "some avg10=%lf", &avg10) == 1) break;
+    }
+    fclose(fp);
+    return avg10;
+}
+
+static long read_mem_available_kb(void) {
+    char line[256];
+    FILE *fp = fopen("/proc/meminfo", "r");
+    if (!fp) return -1;
+
+    long kb = -1;
+    while (fgets(line, sizeof(line), fp)) {
+        if (sscanf(line, "MemAvailable: %ld kB", &kb) == 1) break;
+    }
+    fclose(fp);
+    return kb;
+}
+
+int admission_read_pressure(host_pressure_t *out) {
+    for (int r = 0; r < 3; r++) out->psi_some[r] = read_psi_some(psi_resources[r]);
+    out->mem_available_kb = read_mem_available_kb();
+    return 0;
+}
+
+// 1 if the host is past a bound (reason in why), 0 if a job may start.
+// Unreadable counters (no PSI in this kernel) never hold jobs back.
+int admission_over_bounds(const admission_config_t *config, const host_pressure_t *p, char *why, size_t len) {
+    if (config->psi_some_max > 0) {
+        for (int r = 0; r < 3; r++) {
+            if (p->psi_some[r] >= config->psi_some_max) {
+                snprintf(why, len, "%s some avg10=%.2f", psi_resources[r], p->psi_some[r]);
+                return 1;
+            }
+        }
+    }
+    if (config->mem_free_min_kb > 0 && p->mem_available_kb >= 0 &&
+        p->mem_available_kb < config->mem_free_min_kb) {
+        snprintf(why, len, "MemAvailable=%ld kB", p->mem_available_kb);
+        return 1;
+    }
+    return 0;
+}
+
+// Past half of a bound: admit, but no faster than one job per poll
+static int near_bounds(const admission_config_t *config, const host_pressure_t *p) {
+    if (config->psi_some_max > 0) {
+        for (int r = 0; r < 3; r++) {
+            if (p->psi_some[r] >= config->psi_some_max / 2) return 1;
+        }
+    }
+    return config->mem_free_min_kb > 0 && p->mem_available_kb >= 0 &&
+           p->mem_available_kb < config->mem_free_min_kb * 2;
+}
+
+void admission_init(admission_t *adm, const admission_config_t *config) {
+    memset(adm, 0, sizeof(*adm));
+    adm->config = *config;
+    if (adm->config.poll_ms <= 0) adm->config.poll_ms = 100;
+    pthread_mutex_init(&adm->lock, NULL);
+}
+
+// A job was submitted (its submit time has come): it waits in the queue
+// until admission_admit takes it out
+void admission_arrive(admission_t *adm, long submitted_ms) {
+    pthread_mutex_lock(&adm->lock);
+    adm->depth++;
+    if (adm->depth > adm->max_depth) adm->max_depth = adm->depth;
+    adm->waiting_since_sum += submitted_ms;
+    pthread_mutex_unlock(&adm->lock);
+}
+
+// Whether the host takes one more job now. Never blocks: the supervisor
+// asks before it dequeues a job, so a held job keeps its place in the
+// queue and reserves nothing.
+int admission_open(admission_t *adm) {
+    const admission_config_t *config = &adm->config;
+    if (config->psi_some_max <= 0 && config->mem_free_min_kb <= 0) return 1;
+
+    pthread_mutex_lock(&adm->lock);
+    long now = get_current_time_ms();
+    if (now - adm->checked_ms >= config->poll_ms) {
+        host_pressure_t p;
+        char why[64];
+        admission_read_pressure(&p);
+        adm->checked_ms = now;
+        if (admission_over_bounds(config, &p, why, sizeof(why))) {
+            if (!adm->holding) fprintf(stderr, "[Admission] Holding queue: %s (%d queued)\n", why, adm->depth);
+            adm->holding = 1;
+        } else {
+            if (adm->holding) fprintf(stderr, "[Admission] Host recovered, resuming (%d queued)\n", adm->depth);
+            adm->holding = 0;
+            adm->near = near_bounds(config, &p);
+        }
+    }
+    int open = !adm->holding && !(adm->near && now - adm->last_admit_ms < config->poll_ms);
+    if (adm->holding) adm->closed_ms = now;
+    pthread_mutex_unlock(&adm->lock);
+    return open;
+}
+
+// A job leaves the queue to start; bypass = interactive past a closed gate.
+// Returns its queue wait (since submitted_ms).
+long admission_admit(admission_t *adm, long submitted_ms, int bypass) {
+    long now = get_current_time_ms();
+    long wait_ms = now - submitted_ms;
+    if (wait_ms < 0) wait_ms = 0;
+
+    pthread_mutex_lock(&adm->lock);
+    adm->depth--;
+    adm->waiting_since_sum -= submitted_ms;
+    adm->admitted++;
+    if (adm->closed_ms >= submitted_ms && !bypass) adm->held++;
+    if (bypass) adm->bypassed++;
+    adm->wait_sum_ms += wait_ms;
+    if (wait_ms > adm->wait_max_ms) adm->wait_max_ms = wait_ms;
+    adm->last_admit_ms = now;
+    pthread_mutex_unlock(&adm->lock);
+    return wait_ms;
+}
+
+void admission_stats(admission_t *adm, admission_stats_t *out) {
+    long now = get_current_time_ms();
+    pthread_mutex_lock(&adm->lock);
+    out->depth = adm->depth;
+    out->max_depth = adm->max_depth;
+    out->waiting_mean_ms = adm->depth > 0 ? now - adm->waiting_since_sum / adm->depth : 0.0;
+    out->admitted = adm->admitted;
+    out->held = adm->held;
+    out->bypassed = adm->bypassed;
+    out->wait_sum_ms = adm->wait_sum_ms;
+    out->holding = adm->holding;
+    pthread_mutex_unlock(&adm->lock);
+}
+
+// Queue depth and how long the waiting jobs have waited so far, at most once
+// per PROGRESS_INTERVAL_MS and only while something is queued
+void admission_progress(admission_t *adm) {
+    long now = get_current_time_ms();
+    pthread_mutex_lock(&adm->lock);
+    if (adm->depth > 0 && now - adm->last_progress_ms >= PROGRESS_INTERVAL_MS) {
+        adm->last_progress_ms = now;
+        fprintf(stderr, "[Admission] Queue depth %d, waiting %.0f ms on average; %lu admitted, "
+                "wait mean %.1f ms\n", adm->depth, now - adm->waiting_since_sum / adm->depth, adm->admitted,
+                adm->admitted ? adm->wait_sum_ms / adm->admitted : 0.0);
+    }
+    pthread_mutex_unlock(&adm->lock);
+}
+
+void admission_report(admission_t *adm) {
+    pthread_mutex_lock(&adm->lock);
+    fprintf(stderr, "[Admission] %lu admitted (%lu held by host pressure, %lu interactive past the gate), "
+            "queue depth max %d, wait mean %.1f ms, max %ld ms\n",
+            adm->admitted, adm->held, adm->bypassed, adm->max_depth,
+            adm->admitted ? adm->wait_sum_ms / adm->admitted : 0.0, adm->wait_max_ms);
+    pthread_mutex_unlock(&adm->lock);
+}
+
+void admission_destroy(admission_t *adm) {
+    pthread_mutex_destroy(&adm->lock);
+}
@@ -0,0 +1,66 @@
+#ifndef ADMISSION_H
+#define ADMISSION_H
+
+#include <pthread.h>
+
+// Host bounds a new sandbox must fit under before it is started
+typedef struct {
+    double psi_some_max;        // Highest PSI "some avg10" (%) of cpu/memory/io; 0 = no bound
+    long mem_free_min_kb;       // Lowest MemAvailable; 0 = no bound
+    int poll_ms;                // Re-check interval while the host is over a bound
+} admission_config_t;
+
+// Host pressure as seen at one admission check
+typedef struct {
+    double psi_some[3];         // cpu, memory, io ("some avg10"; -1 if unsupported)
+    long mem_available_kb;      // -1 if unknown
+} host_pressure_t;
+
+// Queue of submitted-but-not-started jobs in front of the supervisor
+typedef struct {
+    admission_config_t config;
+    pthread_mutex_t lock;       // Protects everything below
+    int depth;                  // Jobs submitted and not admitted yet
+    int max_depth;
+    double waiting_since_sum;   // Submission times (ms) of those jobs, for their mean wait
+    long last_progress_ms;
+    unsigned long admitted;
+    unsigned long held;         // Admissions that waited on host pressure
+    unsigned long bypassed;     // Interactive jobs started past a closed gate
+    double wait_sum_ms;
+    long wait_max_ms;
+
+    // Gate state, re-read from the host at most once per poll_ms
+    int holding;                // Host is over a bound right now
+    int near;                   // Past half a bound: one admission per poll_ms
+    long checked_ms;
+    long closed_ms;             // Last time the gate was seen closed
+    long last_admit_ms;
+} admission_t;
+
+// Point-in-time view of the queue (metrics.c exports it)
+typedef struct {
+    int depth;
+    int max_depth;
+    double waiting_mean_ms;     // How long the queued jobs have waited so far
+    unsigned long admitted;
+    unsigned long held;
+    unsigned long bypassed;
+    double wait_sum_ms;
+    int holding;
+} admission_stats_t;
+
+// Function prototypes
+void admission_config_init(admission_config_t *config);
+int admission_read_pressure(host_pressure_t *out);
+int admission_over_bounds(const admission_config_t *config, const host_pressure_t *p, char *why, size_t len);
+void admission_init(admission_t *adm, const admission_config_t *config);
+void admission_arrive(admission_t *adm, long submitted_ms);
+int admission_open(admission_t *adm);
+long admission_admit(admission_t *adm, long submitted_ms, int bypass);
+void admission_stats(admission_t *adm, admission_stats_t *out);
+void admission_progress(admission_t *adm);
+void admission_report(admission_t *adm);
+void admission_destroy(admission_t *adm);
+
+#endif
@@ -0,0 +1,943 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <ctype.h>
+#include <pthread.h>
+#include <time.h>
+#include <math.h>
+#include <limits.h>
+#include <linux/filter.h>
+#include "batch.h"
+#include "job.h"
+#include "admission.h"
+#include "tenant.h"
+#include "cgroup.h"
+#include "predict.h"
+#include "metrics.h"
+
+/**
+ * BATCH MODE (Supervisor)
+ *
+ * One launcher process runs a whole manifest instead of one launcher per job.
+ * Manifest: one JSON object per line, e.g.
+ *   {"id": "t1", "binary": "/bin/ls", "args": ["-la"], "profile": "LEARNING",
+ *    "policy": "cpu_ms=1500", "limits": {"memory_mb": 64, "nproc": 10, "time_ms": 2000},
+ *    "stdout": "out/t1.txt", "stderr": "out/t1.err", "cpuset": "exclusive:2", "smt_idle": true,
+ *    "tenant": "team-a", "priority": "interactive", "submit_ms": 1500}
+ *
+ * Scheduling: jobs queue per tenant (FIFO within a tenant). Whenever a
+ * worker (one per core by default) is free it takes the head job of the
+ * tenant that has received the least CPU time per unit of weight, so a team
+ * submitting 500 jobs cannot starve one submitting 5 (weighted fair queuing).
+ * Results are streamed to stdout as JSON lines as soon as each job finishes,
+ * and per-tenant CPU-seconds and GB-seconds go into an aggregate report.
+ *
+ * Priority: interactive jobs are always dispatched before batch jobs. If one
+ * is waiting (its submit_ms has passed) and every worker is busy, the main
+ * thread freezes the youngest running batch job (cgroup.freeze), runs the
+ * interactive job in its place and thaws the batch job when it is done.
+ *
+ * Packing (--pack): each job's CPU, peak memory and runtime are predicted
+ * from earlier runs of the same binary (predict.c). A job is only started
+ * while its prediction plus a safety margin fits in the CPU and memory not
+ * yet reserved by running jobs; jobs with no history reserve a full core and
+ * their memory limit. Concurrency is then bounded by the packing rather than
+ * by the worker count.
+ *
+ * Admission: a job joins the admission queue at its submit time. Workers
+ * only dequeue batch jobs while host pressure allows another sandbox
+ * (admission.c), so a held job reserves nothing and is not charged to its
+ * tenant; interactive jobs are not held. The queue wait goes into the
+ * result line and the job's telemetry log.
+ */
+
+#define MAX_JOB_ARGS 64
+
+// CPU time charged to a tenant when one of its jobs is dispatched; replaced
+// by the real figure when the job finishes. Keeps concurrent dispatches
+// spread across tenants while the first jobs are still running.
+#define WFQ_NOMINAL_CPU_S 0.1
+
+// How often idle workers and the preemption loop look at the queues
+#define SCHED_POLL_US 20000
+
+// Packing: history runs needed for a prediction, smallest CPU reservation
+// (percent of a core) and default workers per core
+#define PREDICT_MIN_SAMPLES 3
+#define PACK_MIN_CPU 5
+#define PACK_WORKERS_PER_CORE 4
+
+typedef struct {
+    job_spec_t spec;
+    int tenant;                 // Index into the tenant table
+    long submit_ms;             // Arrival, relative to the start of the batch
+    int arrived;                // Counted into the admission queue
+    double charge_s;            // WFQ charge at dispatch (predicted CPU-seconds)
+    long reserve_cpu;           // Packing reservation: CPU percent and memory
+    long reserve_mem_kb;
+    char *argv[MAX_JOB_ARGS + 2];
+    char stdout_path[256];
+    char stderr_path[256];
+} batch_job_t;
+
+// Per-tenant job queue (indices into the job table)
+typedef struct {
+    int *items;
+    int head;
+    int tail;
+} job_queue_t;
+
+typedef struct batch batch_t;
+
+typedef struct {
+    int index;
+    pthread_t thread;
+    batch_t *batch;
+    unsigned long jobs_run;
+
+    // Current job, for the preemption loop (under sched_lock)
+    int busy;
+    int job;
+    job_priority_t priority;
+    long started_ms;
+    int frozen;                 // Frozen for an interactive job
+    job_control_t control;
+} worker_t;
+
+// An interactive job running in place of a frozen batch job
+typedef struct {
+    pthread_t thread;
+    batch_t *batch;
+    int index;
+    worker_t *victim;
+    long queue_wait_ms;
+} urgent_t;
+
+struct batch {
+    batch_job_t *jobs;
+    int job_count;
+    worker_t *workers;
+    int worker_count;
+    struct sock_fprog filters[3];   // Compiled once per profile, shared by all jobs
+    pthread_mutex_t output_lock;
+    admission_t admission;
+    long submitted_ms;
+    int *arrival_order;         // Job indices by submit_ms
+    int arrived;                // Prefix of arrival_order counted as arrived
+
+    // Weighted fair queuing across tenants, one queue set per priority
+    // class (sched_lock covers the tables and worker state)
+    pthread_mutex_t sched_lock;
+    tenant_t tenants[MAX_TENANTS];
+    job_queue_t queues[2][MAX_TENANTS];
+    unsigned char backlogged[MAX_TENANTS]; // Had an arrived job queued at the last dispatch
+    double vtime_floor;
+    int tenant_count;
+    int dispatched;
+
+    // Packing by predicted resources
+    int pack;
+    long cpu_capacity;          // Percent (100 per online core)
+    long mem_capacity_kb;
+    long cpu_reserved;
+    long mem_reserved_kb;
+    int running;
+    int max_running;
+    int predicted;              // Finished jobs that had a prediction
+    int mem_under;              // ... whose peak RSS exceeded it
+    int mem_over_reserve;       // ... and exceeded it plus the margin
+
+    // Preemption
+    urgent_t *urgent;
+    int urgent_count;
+    long frozen_total_ms;
+
+    // Runtime spread across jobs (placement benchmark)
+    int finished;
+    double runtime_sum;
+    double runtime_sq_sum;
+};
+
+// -------------------------------------------------------------
+// Manifest parsing (the subset of JSON the manifest uses)
+// -------------------------------------------------------------
+
+static const char *skip_ws(const char *p) {
+    while (*p && isspace((unsigned char)*p)) p++;
+    return p;
+}
+
+// Parse a JSON string at p into a malloc'd buffer; returns the position after it
+static const char *parse_string(const char *p, char **out) {
+    if (*p != '"') return NULL;
+    p++;
+
+    size_t cap = 64, len = 0;
+    char *buf = malloc(cap);
+    while (*p && *p != '"') {
+        char c = *p++;
+        if (c == '\\') {
+            char e = *p++;
+            switch (e) {
+                case 'n': c = '\n'; break;
+                case 't': c = '\t'; break;
+                case 'r': c = '\r'; break;
+                case 'b': c = '\b'; break;
+                case 'f': c = '\f'; break;
+                case 'u': {
+                    // ASCII subset only
+                    unsigned int code = 0;
+                    if (sscanf(p, "%4x", &code) != 1) { free(buf); return NULL; }
+                    p += 4;
+                    c = (char)(code < 0x80 ? code : '?');
+                    break;
+                }
+                case '\0': free(buf); return NULL;
+                default: c = e; break;   // \" \\ \/
+            }
+        }
+        if (len + 1 >= cap) {
+            cap *= 2;
+            buf = realloc(buf, cap);
+        }
+        buf[len++] = c;
+    }
+    if (*p != '"') {
+        free(buf);
+        return NULL;
+    }
+    buf[len] = '\0';
+    *out = buf;
+    return p + 1;
+}
+
+// Skip any JSON value (for keys the manifest does not use)
+static const char *skip_value(const char *p) {
+    p = skip_ws(p);
+    if (*p == '"') {
+        char *tmp;
+        p = parse_string(p, &tmp);
+        if (p) free(tmp);
+        return p;
+    }
+    if (*p == '{' || *p == '[') {
+        int depth = 0;
+        while (*p) {
+            if (*p == '"') {
+                char *tmp;
+                p = parse_string(p, &tmp);
+                if (!p) return NULL;
+                free(tmp);
+                continue;
+            }
+            if (*p == '{' || *p == '[') depth++;
+            if (*p == '}' || *p == ']') depth--;
+            p++;
+            if (depth == 0) return p;
+        }
+        return NULL;
+    }
+    while (*p && *p != ',' && *p != '}' && *p != ']') p++;
+    return p;
+}
+
+static const char *parse_limits(const char *p, job_limits_t *limits) {
+    p = skip_ws(p);
+    if (*p != '{') return NULL;
+    p = skip_ws(p + 1);
+
+    while (*p && *p != '}') {
+        char *key;
+        p = parse_string(p, &key);
+        if (!p) return NULL;
+        p = skip_ws(p);
+        if (*p != ':') { free(key); return NULL; }
+        p = skip_ws(p + 1);
+
+        char *end;
+        long value = strtol(p, &end, 10);
+        if (end == p) { free(key); return NULL; }
+        p = end;
+
+        if (strcmp(key, "memory_mb") == 0) limits->memory_mb = value;
+        else if (strcmp(key, "nproc") == 0) limits->nproc = (int)value;
+        else if (strcmp(key, "nofile") == 0) limits->nofile = (int)value;
+        else if (strcmp(key, "time_ms") == 0) limits->time_ms = value;
+        free(key);
+
+        p = skip_ws(p);
+        if (*p == ',') p = skip_ws(p + 1);
+    }
+    return *p == '}' ? p + 1 : NULL;
+}
+
+static void free_job(batch_job_t *job) {
+    for (int a = 1; a <= MAX_JOB_ARGS && job->argv[a]; a++) free(job->argv[a]);
+    free(job->spec.binary_path);
+    memset(job, 0, sizeof(*job));
+}
+
+// Parse one manifest line into job. Returns 0, or -1 with a message in err.
+static int parse_job(const char *line, const job_spec_t *defaults, batch_job_t *job, int line_no,
+                     char *err, size_t err_len) {
+    memset(job, 0, sizeof(*job));
+    job->spec = *defaults;
+    job->spec.binary_path = NULL;
+    job->spec.args = NULL;
+    job->spec.quiet = 1;
+    snprintf(job->spec.id, sizeof(job->spec.id), "job%d", line_no);
+
+    int argc = 1;
+    const char *p = skip_ws(line);
+    if (*p != '{') {
+        snprintf(err, err_len, "expected object");
+        goto fail;
+    }
+    p = skip_ws(p + 1);
+
+    while (*p && *p != '}') {
+        char *key;
+        p = parse_string(p, &key);
+        if (!p) { snprintf(err, err_len, "bad key"); goto fail; }
+        p = skip_ws(p);
+        if (*p != ':') { free(key); snprintf(err, err_len, "expected ':'"); goto fail; }
+        p = skip_ws(p + 1);
+
+        char *str = NULL;
+        if (strcmp(key, "args") == 0) {
+            if (*p != '[') { free(key); snprintf(err, err_len, "args must be an array"); goto fail; }
+            p = skip_ws(p + 1);
+            while (p && *p && *p != ']') {
+                p = parse_string(p, &str);
+                if (!p) break;
+                if (argc > MAX_JOB_ARGS) {
+                    snprintf(err, err_len, "more than %d arguments", MAX_JOB_ARGS);
+                    free(str);
+                    free(key);
+                    goto fail;
+                }
+                job->argv[argc++] = str;
+                p = skip_ws(p);
+                if (*p == ',') p = skip_ws(p + 1);
+            }
+            if (p && *p == ']') p++;
+        } else if (strcmp(key, "limits") == 0) {
+            p = parse_limits(p, &job->spec.limits);
+        } else if (strcmp(key, "mem_soft") == 0) {
+            job->spec.mem_soft = (strncmp(p, "true", 4) == 0);
+            p = skip_value(p);
+        } else if (strcmp(key, "submit_ms") == 0) {
+            job->submit_ms = strtol(p, NULL, 10);
+            p = skip_value(p);
+        } else if (strcmp(key, "smt_idle") == 0) {
+            job->spec.idle_siblings = (strncmp(p, "true", 4) == 0);
+            p = skip_value(p);
+        } else if (*p == '"') {
+            p = parse_string(p, &str);
+            if (p) {
+                if (strcmp(key, "binary") == 0) {
+                    job->spec.binary_path = str;
+                    str = NULL;
+                } else if (strcmp(key, "id") == 0) {
+                    snprintf(job->spec.id, sizeof(job->spec.id), "%s", str);
+                } else if (strcmp(key, "profile") == 0) {
+                    if (job_parse_profile(str, &job->spec.profile, &job->spec.profile_name) != 0) {
+                        snprintf(err, err_len, "unknown profile %s", str);
+                        free(str);
+                        free(key);
+                        goto fail;
+                    }
+                } else if (strcmp(key, "policy") == 0) {
+                    if (policy_parse(str, &job->spec.policy) != 0) {
+                        snprintf(err, err_len, "invalid policy %s", str);
+                        free(str);
+                        free(key);
+                        goto fail;
+                    }
+                } else if (strcmp(key, "cpuset") == 0) {
+                    if (job_parse_cpuset(str, &job->spec.cpuset_mode, &job->spec.cpuset_cores) != 0) {
+                        snprintf(err, err_len, "invalid cpuset %s", str);
+                        free(str);
+                        free(key);
+                        goto fail;
+                    }
+                } else if (strcmp(key, "priority") == 0) {
+                    if (job_parse_priority(str, &job->spec.priority) != 0) {
+                        snprintf(err, err_len, "unknown priority %s", str);
+                        free(str);
+                        free(key);
+                        goto fail;
+                    }
+                } else if (strcmp(key, "tenant") == 0) {
+                    if (job_parse_tenant(str, job->spec.tenant, sizeof(job->spec.tenant)) != 0) {
+                        snprintf(err, err_len, "invalid tenant %s", str);
+                        free(str);
+                        free(key);
+                        goto fail;
+                    }
+                } else if (strcmp(key, "stdout") == 0) {
+                    snprintf(job->stdout_path, sizeof(job->stdout_path), "%s", str);
+                } else if (strcmp(key, "stderr") == 0) {
+                    snprintf(job->stderr_path, sizeof(job->stderr_path), "%s", str);
+                }
+                free(str);
+            }
+        } else {
+            p = skip_value(p);
+        }
+        free(key);
+
+        if (!p) {
+            snprintf(err, err_len, "malformed value");
+            goto fail;
+        }
+        p = skip_ws(p);
+        if (*p == ',') p = skip_ws(p + 1);
+    }
+
+    if (!job->spec.binary_path) {
+        snprintf(err, err_len, "missing \"binary\"");
+        goto fail;
+    }
+    job->argv[0] = job->spec.binary_path;
+    job->argv[argc] = NULL;
+    job->spec.args = job->argv;
+    return 0;
+
+fail:
+    free_job(job);
+    return -1;
+}
+
+// Tenant table index for name, adding it with default limits on first use
+static int tenant_index(batch_t *batch, const char *name) {
+    tenant_t *t = tenant_find(batch->tenants, batch->tenant_count, name);
+    if (t) return (int)(t - batch->tenants);
+    if (batch->tenant_count == MAX_TENANTS) return -1;
+    tenant_init(&batch->tenants[batch->tenant_count], name);
+    return batch->tenant_count++;
+}
+
+static int load_manifest(const char *path, const job_spec_t *defaults, batch_t *batch) {
+    FILE *fp = fopen(path, "r");
+    if (!fp) {
+        perror("fopen manifest");
+        return -1;
+    }
+
+    int cap = 64;
+    batch->jobs = calloc(cap, sizeof(batch_job_t));
+    batch->job_count = 0;
+
+    char *line = NULL;
+    size_t line_cap = 0;
+    int line_no = 0;
+    while (getline(&line, &line_cap, fp) != -1) {
+        line_no++;
+        if (*skip_ws(line) == '\0') continue;
+
+        if (batch->job_count == cap) {
+            cap *= 2;
+            batch->jobs = realloc(batch->jobs, sizeof(batch_job_t) * cap);
+            memset(&batch->jobs[batch->job_count], 0, sizeof(batch_job_t) * (cap - batch->job_count));
+        }
+
+        char err[128];
+        if (parse_job(line, defaults, &batch->jobs[batch->job_count], line_no, err, sizeof(err)) != 0) {
+            fprintf(stderr, "[Batch] %s:%d: %s (skipped)\n", path, line_no, err);
+            continue;
+        }
+
+        // Jobs without a tenant share the default one
+        batch_job_t *job = &batch->jobs[batch->job_count];
+        if (!job->spec.tenant[0]) snprintf(job->spec.tenant, sizeof(job->spec.tenant), DEFAULT_TENANT);
+        job->tenant = tenant_index(batch, job->spec.tenant);
+        if (job->tenant < 0) {
+            fprintf(stderr, "[Batch] %s:%d: more than %d tenants (skipped)\n", path, line_no, MAX_TENANTS);
+            free_job(job);
+            continue;
+        }
+        batch->job_count++;
+    }
+    free(line);
+    fclose(fp);
+    return 0;
+}
+
+// -------------------------------------------------------------
+// Weighted fair queuing (tenant_next): a tenant is charged its predicted
+// CPU time at dispatch and corrected to the actual time at exit
+// -------------------------------------------------------------
+
+// Whether a job's reservation fits next to the running ones. With nothing
+// running everything fits, so an oversized job still runs (alone).
+static int job_fits(const batch_t *batch, const batch_job_t *job) {
+    if (!batch->pack || batch->running == 0) return 1;
+    return batch->cpu_reserved + job->reserve_cpu <= batch->cpu_capacity &&
+           batch->mem_reserved_kb + job->reserve_mem_kb <= batch->mem_capacity_kb;
+}
+
+// Tenant whose head job of class prio goes next (-1 if none has arrived, or
+// with packing, none fits). Caller holds sched_lock.
+static int next_tenant(batch_t *batch, job_priority_t prio, int packed) {
+    long now = get_current_time_ms() - batch->submitted_ms;
+    unsigned char eligible[MAX_TENANTS];
+    for (int t = 0; t < batch->tenant_count; t++) {
+        const job_queue_t *q = &batch->queues[prio][t];
+        eligible[t] = 0;
+        if (q->head == q->tail) continue;
+        const batch_job_t *head = &batch->jobs[q->items[q->head]];
+        eligible[t] = head->submit_ms <= now && !(packed && !job_fits(batch, head));
+    }
+    return tenant_next(batch->tenants, batch->tenant_count, eligible);
+}
+
+// Tenants with an arrived job queued in either class; one that just became
+// backlogged starts level with the others (tenant_update_backlog).
+// Caller holds sched_lock.
+static void update_backlog(batch_t *batch) {
+    long now = get_current_time_ms() - batch->submitted_ms;
+    unsigned char waiting[MAX_TENANTS];
+    for (int t = 0; t < batch->tenant_count; t++) {
+        waiting[t] = 0;
+        for (int prio = PRIORITY_BATCH; prio <= PRIORITY_INTERACTIVE; prio++) {
+            const job_queue_t *q = &batch->queues[prio][t];
+            if (q->head != q->tail && batch->jobs[q->items[q->head]].submit_ms <= now) waiting[t] = 1;
+        }
+    }
+    tenant_update_backlog(batch->tenants, batch->tenant_count, waiting, batch->backlogged, &batch->vtime_floor);
+}
+
+// A job joins the admission queue once its submit time has passed.
+// Caller holds sched_lock.
+static void note_arrival(batch_t *batch, batch_job_t *job) {
+    if (job->arrived) return;
+    job->arrived = 1;
+    admission_arrive(&batch->admission, batch->submitted_ms + job->submit_ms);
+}
+
+static void note_arrivals(batch_t *batch) {
+    long now = get_current_time_ms() - batch->submitted_ms;
+    while (batch->arrived < batch->job_count) {
+        batch_job_t *job = &batch->jobs[batch->arrival_order[batch->arrived]];
+        if (job->submit_ms > now) break;
+        note_arrival(batch, job);
+        batch->arrived++;
+    }
+}
+
+static int by_submit_ms(const void *a, const void *b, void *ctx) {
+    const batch_job_t *jobs = ctx;
+    long sa = jobs[*(const int *)a].submit_ms, sb = jobs[*(const int *)b].submit_ms;
+    if (sa != sb) return sa < sb ? -1 : 1;
+    return *(const int *)a - *(const int *)b;
+}
+
+// Dequeue the next job of class min_prio or above, interactive first, and
+// reserve its predicted resources. Caller holds sched_lock.
+static int take_job(batch_t *batch, job_priority_t min_prio, int packed) {
+    update_backlog(batch);
+    for (int prio = PRIORITY_INTERACTIVE; prio >= (int)min_prio; prio--) {
+        int t = next_tenant(batch, (job_priority_t)prio, packed);
+        if (t < 0) continue;
+
+        int index = batch->queues[prio][t].items[batch->queues[prio][t].head++];
+        batch_job_t *job = &batch->jobs[index];
+        // next_tenant's clock may be ahead of the last note_arrivals
+        note_arrival(batch, job);
+        tenant_charge(&batch->tenants[t], job->charge_s);
+        batch->dispatched++;
+        batch->cpu_reserved += job->reserve_cpu;
+        batch->mem_reserved_kb += job->reserve_mem_kb;
+        if (++batch->running > batch->max_running) batch->max_running = batch->running;
+        return index;
+    }
+    return -1;
+}
+
+// Undo take_job for a job that could not be started: it goes back to the
+// head of its queue. Caller holds sched_lock.
+static void return_job(batch_t *batch, int index) {
+    batch_job_t *job = &batch->jobs[index];
+    batch->queues[job->spec.priority][job->tenant].head--;
+    tenant_charge(&batch->tenants[job->tenant], -job->charge_s);
+    batch->dispatched--;
+    batch->cpu_reserved -= job->reserve_cpu;
+    batch->mem_reserved_kb -= job->reserve_mem_kb;
+    batch->running--;
+}
+
+// A worker whose job has a process to freeze (not still waiting to start it)
+static int worker_running(worker_t *worker) {
+    pthread_mutex_lock(&worker->control.lock);
+    int running = worker->control.pid > 0;
+    pthread_mutex_unlock(&worker->control.lock);
+    return running;
+}
+
+// Charge the tenant what the job really used
+static void finish_job(batch_t *batch, const batch_job_t *job, const job_result_t *res, int ok) {
+    pthread_mutex_lock(&batch->sched_lock);
+    tenant_t *t = &batch->tenants[job->tenant];
+    double cpu_seconds = ok ? res->cpu_time_ms / 1000.0 : 0.0;
+    tenant_charge(t, cpu_seconds - job->charge_s);
+    t->jobs++;
+    t->cpu_seconds += cpu_seconds;
+    if (ok) t->gb_seconds += res->mem_gb_seconds;
+    if (ok) batch->frozen_total_ms += res->frozen_ms;
+
+    batch->cpu_reserved -= job->reserve_cpu;
+    batch->mem_reserved_kb -= job->reserve_mem_kb;
+    batch->running--;
+    if (ok && job->spec.prediction.samples > 0) {
+        batch->predicted++;
+        if (res->peak_rss_kb > job->spec.prediction.peak_rss_kb) batch->mem_under++;
+        if (res->peak_rss_kb > job->reserve_mem_kb) batch->mem_over_reserve++;
+    }
+    pthread_mutex_unlock(&batch->sched_lock);
+}
+
+// -------------------------------------------------------------
+// Workers
+// -------------------------------------------------------------
+
+static void stream_result(batch_t *batch, const batch_job_t *job, const job_spec_t *spec,
+                          const job_result_t *res, int worker, int ok) {
+    char line[768 + 3 * JSON_STR_MAX];
+    char id[JSON_STR_MAX], binary[JSON_STR_MAX], log[JSON_STR_MAX];
+    json_escape(job->spec.id, id, sizeof(id));
+    json_escape(job->spec.binary_path, binary, sizeof(binary));
+    int len;
+    if (ok) {
+        len = snprintf(line, sizeof(line),
+                       "{\"id\": \"%s\", \"binary\": \"%s\", \"worker\": %d, \"pid\": %d, "
+                       "\"exit_reason\": \"%s\", \"runtime_ms\": %ld, \"peak_cpu\": %d, "
+                       "\"peak_memory_kb\": %ld, \"queue_wait_ms\": %ld, \"frozen_ms\": %ld, \"log\": \"%s\"}\n",
+                       id, binary, worker, res->pid, res->exit_reason,
+                       res->runtime_ms, res->cpu_usage_percent, res->memory_peak_kb, spec->queue_wait_ms,
+                       res->frozen_ms, json_escape(res->log_path, log, sizeof(log)));
+    } else {
+        len = snprintf(line, sizeof(line),
+                       "{\"id\": \"%s\", \"binary\": \"%s\", \"worker\": %d, \"exit_reason\": \"LAUNCH_FAILED\", "
+                       "\"queue_wait_ms\": %ld}\n",
+                       id, binary, worker, spec->queue_wait_ms);
+    }
+    if (len > (int)sizeof(line)) len = sizeof(line);
+
+    // One write() per line so concurrent results never interleave
+    pthread_mutex_lock(&batch->output_lock);
+    if (ok) {
+        batch->finished++;
+        batch->runtime_sum += res->runtime_ms;
+        batch->runtime_sq_sum += (double)res->runtime_ms * res->runtime_ms;
+    }
+    ssize_t ignored = write(STDOUT_FILENO, line, len);
+    (void)ignored;
+    pthread_mutex_unlock(&batch->output_lock);
+}
+
+static int open_output(const char *path) {
+    return open(path[0] ? path : "/dev/null", O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+}
+
+static void run_job(batch_t *batch, int index, job_control_t *control, int worker, long queue_wait_ms) {
+    batch_job_t *job = &batch->jobs[index];
+    job_spec_t spec = job->spec;
+    spec.filter = &batch->filters[spec.profile];
+    spec.control = control;
+    spec.queue_wait_ms = queue_wait_ms;
+    spec.stdout_fd = open_output(job->stdout_path);
+    spec.stderr_fd = open_output(job->stderr_path);
+
+    job_result_t res = {0};
+    int ok = metrics_run_job(&spec, &res) == 0;
+    stream_result(batch, job, &spec, &res, worker, ok);
+    finish_job(batch, job, &res, ok);
+
+    if (spec.stdout_fd >= 0) close(spec.stdout_fd);
+    if (spec.stderr_fd >= 0) close(spec.stderr_fd);
+}
+
+static void *worker_main(void *arg) {
+    worker_t *self = (worker_t *)arg;
+    batch_t *batch = self->batch;
+
+    for (;;) {
+        pthread_mutex_lock(&batch->sched_lock);
+        // Under host pressure only interactive jobs are taken
+        int open = admission_open(&batch->admission);
+        int index = take_job(batch, open ? PRIORITY_BATCH : PRIORITY_INTERACTIVE, 1);
+        int done = index < 0 && batch->dispatched == batch->job_count;
+        long queue_wait_ms = 0;
+        if (index >= 0) {
+            queue_wait_ms = admission_admit(&batch->admission, batch->submitted_ms + batch->jobs[index].submit_ms,
+                                            !open);
+            self->busy = 1;
+            self->job = index;
+            self->priority = batch->jobs[index].spec.priority;
+            self->started_ms = get_current_time_ms();
+        }
+        pthread_mutex_unlock(&batch->sched_lock);
+
+        if (done) break;
+        if (index < 0) {
+            // Remaining jobs have not been submitted yet, do not fit, or are held
+            usleep(SCHED_POLL_US);
+            continue;
+        }
+
+        run_job(batch, index, &self->control, self->index, queue_wait_ms);
+        self->jobs_run++;
+
+        pthread_mutex_lock(&batch->sched_lock);
+        self->busy = 0;
+        pthread_mutex_unlock(&batch->sched_lock);
+    }
+    return NULL;
+}
+
+// -------------------------------------------------------------
+// Preemption (cgroup.freeze)
+// -------------------------------------------------------------
+
+static void *urgent_main(void *arg) {
+    urgent_t *u = (urgent_t *)arg;
+    batch_t *batch = u->batch;
+
+    // Started under sched_lock: wait until preempt_loop has filled u in
+    pthread_mutex_lock(&batch->sched_lock);
+    long queue_wait_ms = u->queue_wait_ms;
+    pthread_mutex_unlock(&batch->sched_lock);
+
+    run_job(batch, u->index, NULL, u->victim->index, queue_wait_ms);
+
+    job_thaw(&u->victim->control);
+    pthread_mutex_lock(&batch->sched_lock);
+    u->victim->frozen = 0;
+    fprintf(stderr, "[Batch] Thawed %s after %s finished\n",
+            batch->jobs[u->victim->job].spec.id, batch->jobs[u->index].spec.id);
+    pthread_mutex_unlock(&batch->sched_lock);
+    return NULL;
+}
+
+// Runs on the main thread until every job has been dispatched: an arrived
+// interactive job with no idle worker freezes the youngest batch job.
+static void preempt_loop(batch_t *batch) {
+    for (;;) {
+        pthread_mutex_lock(&batch->sched_lock);
+        note_arrivals(batch);
+        if (batch->dispatched == batch->job_count) {
+            pthread_mutex_unlock(&batch->sched_lock);
+            break;
+        }
+
+        int idle = 0;
+        worker_t *victim = NULL;
+        for (int w = 0; w < batch->worker_count; w++) {
+            worker_t *worker = &batch->workers[w];
+            if (!worker->busy) {
+                idle++;
+            } else if (worker->priority == PRIORITY_BATCH && !worker->frozen &&
+                       (!victim || worker->started_ms > victim->started_ms) && worker_running(worker)) {
+                victim = worker;
+            }
+        }
+
+        if (idle == 0 && victim && next_tenant(batch, PRIORITY_INTERACTIVE, 0) >= 0 &&
+            job_freeze(&victim->control) == 0) {
+            urgent_t *u = &batch->urgent[batch->urgent_count++];
+            u->batch = batch;
+            u->victim = victim;
+            u->index = take_job(batch, PRIORITY_INTERACTIVE, 0);
+            victim->frozen = 1;
+            if (pthread_create(&u->thread, NULL, urgent_main, u) != 0) {
+                perror("pthread_create urgent");
+                return_job(batch, u->index);
+                job_thaw(&victim->control);
+                victim->frozen = 0;
+                batch->urgent_count--;
+            } else {
+                // urgent_main waits for sched_lock, so it sees queue_wait_ms
+                int open = admission_open(&batch->admission);
+                u->queue_wait_ms = admission_admit(&batch->admission,
+                                                   batch->submitted_ms + batch->jobs[u->index].submit_ms, !open);
+                fprintf(stderr, "[Batch] Froze %s for interactive job %s\n",
+                        batch->jobs[victim->job].spec.id, batch->jobs[u->index].spec.id);
+            }
+        }
+        pthread_mutex_unlock(&batch->sched_lock);
+        admission_progress(&batch->admission);
+        usleep(SCHED_POLL_US);
+    }
+}
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int batch_run(const char *manifest_path, const batch_config_t *config) {
+    batch_t batch = {0};
+    pthread_mutex_init(&batch.output_lock, NULL);
+    pthread_mutex_init(&batch.sched_lock, NULL);
+
+    // Configured tenants first, so their limits win over manifest defaults
+    for (int t = 0; t < config->tenant_count && t < MAX_TENANTS; t++) {
+        batch.tenants[batch.tenant_count++] = config->tenants[t];
+    }
+
+    if (load_manifest(manifest_path, config->defaults, &batch) != 0) return 1;
+
+    int worker_count = config->workers;
+    long online = sysconf(_SC_NPROCESSORS_ONLN);
+
+    // Packing bounds concurrency by predicted demand; leave it room to
+    // fit several light jobs per core
+    if (worker_count <= 0) worker_count = (int)(config->pack ? online * PACK_WORKERS_PER_CORE : online);
+    if (worker_count > batch.job_count) worker_count = batch.job_count > 0 ? batch.job_count : 1;
+
+    fprintf(stderr, "[Batch] %d jobs from %s, %d workers, %d tenants\n", batch.job_count, manifest_path,
+            worker_count, batch.tenant_count);
+
+    // Compile each seccomp profile once, before any thread exists
+    for (int p = PROFILE_STRICT; p <= PROFILE_LEARNING; p++) {
+        if (job_compile_filter((sandbox_profile_t)p, &batch.filters[p]) != 0) return 1;
+    }
+
+    ensure_logs_directory();
+
+    // Predict every job from the run history, and size its reservation
+    run_history_t history;
+    history_load("logs", &history);
+    int with_history = 0;
+    batch.pack = config->pack;
+    batch.cpu_capacity = online * 100;
+    host_pressure_t host;
+    admission_read_pressure(&host);
+    batch.mem_capacity_kb = host.mem_available_kb > 0 ? host.mem_available_kb : LONG_MAX / 2;
+
+    for (int i = 0; i < batch.job_count; i++) {
+        batch_job_t *job = &batch.jobs[i];
+        job_spec_t *spec = &job->spec;
+        predict_hash_file(spec->binary_path, spec->binary_hash, sizeof(spec->binary_hash));
+
+        job->charge_s = WFQ_NOMINAL_CPU_S;
+        job->reserve_cpu = 100;
+        job->reserve_mem_kb = spec->limits.memory_mb * 1024;
+        if (predict_job(&history, spec->binary_hash, spec->binary_path, config->quantile,
+                        PREDICT_MIN_SAMPLES, &spec->prediction) == 0) {
+            with_history++;
+            double margin = 1.0 + config->pack_margin;
+            job->charge_s = spec->prediction.cpu_time_ms / 1000.0;
+            job->reserve_cpu = (long)(spec->prediction.cpu_percent * margin);
+            if (job->reserve_cpu < PACK_MIN_CPU) job->reserve_cpu = PACK_MIN_CPU;
+            job->reserve_mem_kb = (long)(spec->prediction.peak_rss_kb * margin);
+        }
+    }
+    history_free(&history);
+    fprintf(stderr, "[Predict] %d of %d jobs have history (q=%.2f)%s\n", with_history, batch.job_count,
+            config->quantile, config->pack ? ", packing by prediction" : "");
+
+    // Tenant level of the hierarchy: sandbox_project/<tenant>, with its limits
+    for (int t = 0; t < batch.tenant_count; t++) {
+        if (tenant_setup_cgroup(&batch.tenants[t]) != 0) {
+            fprintf(stderr, "[Tenant] WARNING: could not apply cgroup limits for '%s'; fair queuing only.\n",
+                    batch.tenants[t].name);
+        }
+    }
+
+    // Queue jobs per class and tenant in order of arrival (manifest order on ties)
+    for (int prio = PRIORITY_BATCH; prio <= PRIORITY_INTERACTIVE; prio++) {
+        for (int t = 0; t < batch.tenant_count; t++) {
+            batch.queues[prio][t].items = malloc(sizeof(int) * (batch.job_count + 1));
+        }
+    }
+    for (int i = 0; i < batch.job_count; i++) {
+        job_queue_t *q = &batch.queues[batch.jobs[i].spec.priority][batch.jobs[i].tenant];
+        int pos = q->tail++;
+        while (pos > 0 && batch.jobs[q->items[pos - 1]].submit_ms > batch.jobs[i].submit_ms) {
+            q->items[pos] = q->items[pos - 1];
+            pos--;
+        }
+        q->items[pos] = i;
+    }
+
+    batch.worker_count = worker_count;
+    batch.workers = calloc(worker_count, sizeof(worker_t));
+    for (int w = 0; w < worker_count; w++) {
+        batch.workers[w].index = w;
+        batch.workers[w].batch = &batch;
+        job_control_init(&batch.workers[w].control);
+    }
+    batch.urgent = calloc(batch.job_count + 1, sizeof(urgent_t));
+
+    batch.arrival_order = malloc(sizeof(int) * (batch.job_count + 1));
+    for (int i = 0; i < batch.job_count; i++) batch.arrival_order[i] = i;
+    qsort_r(batch.arrival_order, batch.job_count, sizeof(int), by_submit_ms, batch.jobs);
+
+    admission_init(&batch.admission, &config->admission);
+    metrics_watch_admission(&batch.admission);
+    batch.submitted_ms = get_current_time_ms();
+
+    double start = now_seconds();
+    for (int w = 0; w < worker_count; w++) {
+        pthread_create(&batch.workers[w].thread, NULL, worker_main, &batch.workers[w]);
+    }
+
+    preempt_loop(&batch);
+
+    for (int w = 0; w < worker_count; w++) {
+        pthread_join(batch.workers[w].thread, NULL);
+    }
+    for (int u = 0; u < batch.urgent_count; u++) {
+        pthread_join(batch.urgent[u].thread, NULL);
+    }
+    double elapsed = now_seconds() - start;
+
+    fprintf(stderr, "[Batch] %d jobs in %.2f s: %.1f jobs/s on %d workers\n",
+            batch.job_count, elapsed, elapsed > 0 ? batch.job_count / elapsed : 0.0, worker_count);
+    if (batch.finished > 0) {
+        double mean = batch.runtime_sum / batch.finished;
+        double variance = batch.runtime_sq_sum / batch.finished - mean * mean;
+        fprintf(stderr, "[Batch] Runtime mean %.1f ms, stddev %.1f ms\n", mean, variance > 0 ? sqrt(variance) : 0.0);
+    }
+    if (batch.predicted > 0) {
+        fprintf(stderr, "[Predict] Peak RSS above prediction for %d of %d predicted jobs, "
+                "above prediction + margin for %d; max %d jobs running at once\n",
+                batch.mem_under, batch.predicted, batch.mem_over_reserve, batch.max_running);
+    }
+    if (batch.urgent_count > 0) {
+        fprintf(stderr, "[Batch] %d preemptions, %ld ms frozen in total (excluded from runtimes)\n",
+                batch.urgent_count, batch.frozen_total_ms);
+    }
+    admission_report(&batch.admission);
+    metrics_watch_admission(NULL);
+    admission_destroy(&batch.admission);
+
+    // Aggregate accounting per tenant
+    tenant_report(batch.tenants, batch.tenant_count, stderr);
+    char report[128];
+    snprintf(report, sizeof(report), "logs/tenants_%d_%ld.json", getpid(), time(NULL));
+    if (tenant_write_report(batch.tenants, batch.tenant_count, report) == 0) {
+        fprintf(stderr, "[Tenant] Report written to %s\n", report);
+    }
+
+    // Tenant cgroups are left in place when other runs still use them
+    for (int t = 0; t < batch.tenant_count; t++) {
+        if (batch.tenants[t].cgroup[0]) cgroup_remove(batch.tenants[t].cgroup);
+        free(batch.queues[PRIORITY_BATCH][t].items);
+        free(batch.queues[PRIORITY_INTERACTIVE][t].items);
+    }
+    for (int w = 0; w < worker_count; w++) pthread_mutex_destroy(&batch.workers[w].control.lock);
+    free(batch.workers);
+    free(batch.urgent);
+    free(batch.arrival_order);
+    for (int i = 0; i < batch.job_count; i++) free_job(&batch.jobs[i]);
+    free(batch.jobs);
+    for (int p = PROFILE_STRICT; p <= PROFILE_LEARNING; p++) free(batch.filters[p].filter);
+    return 0;
+}
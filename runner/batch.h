@@ -0,0 +1,24 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+#include "job.h"
+#include "admission.h"
+#include "tenant.h"
+
+// Supervisor options from the launcher's command line
+typedef struct {
+    int workers;                    // Concurrency (0 = one per online core)
+    const job_spec_t *defaults;     // Manifest entries start from these
+    admission_config_t admission;   // Host bounds for starting another job
+    const tenant_t *tenants;        // --tenant definitions (others get defaults)
+    int tenant_count;
+    int pack;                       // Admit by predicted CPU/memory instead of one job per worker
+    double pack_margin;             // Safety margin on predictions (0.2 = +20%)
+    double quantile;                // Quantile of the run history used as the prediction
+} batch_config_t;
+
+// Batch (supervisor) mode: run a JSONL manifest of jobs with bounded
+// concurrency, one worker per core, streaming one result line per job.
+int batch_run(const char *manifest_path, const batch_config_t *config);
+
+#endif
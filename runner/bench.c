@@ -0,0 +1,579 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <math.h>
+#include <sched.h>
+#include <signal.h>
+#include <time.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+#include "bench.h"
+
+/**
+ * BENCHMARK MODE (--bench N)
+ *
+ * A single run's runtime_ms answers "how long did this take, give or take
+ * a sample interval". For "how fast is this program" the binary runs many
+ * times in one sandbox, prepared once and pinned to one CPU (an exclusive
+ * core when --exclusive-cpus has any), with stdin/stdout/stderr on
+ * /dev/null. The zygote inside the sandbox times each fork-to-wait4 with
+ * CLOCK_MONOTONIC and reports rusage CPU time and peak RSS; nothing samples
+ * /proc meanwhile.
+ *
+ * Warmup runs are discarded. After BENCH_MIN_ITERATIONS measured runs the
+ * launcher stops as soon as the 95% CI of the median wall time is within
+ * the requested precision, or after N runs.
+ *
+ * --overhead N measures what the sandbox itself costs: see bench_overhead().
+ */
+
+#define STACK_SIZE (1024 * 1024)
+
+// zygote -> launcher, one per iteration
+typedef struct {
+    int status;                 // wait4() status, -1 if fork failed
+    int timed_out;
+    long long wall_ns;
+    long long cpu_ns;           // utime + stime (rusage, microsecond resolution)
+    long peak_rss_kb;
+} bench_report_t;
+
+typedef struct {
+    const job_spec_t *spec;
+    int sock;
+    int peer;                   // Launcher's end, inherited by clone()
+    int cpu;                    // Pinned to this CPU
+} bench_args_t;
+
+static long long now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+// -------------------------------------------------------------
+// Zygote (inside the sandbox namespaces)
+// -------------------------------------------------------------
+
+// Wait for child, killing it at the wall-clock limit
+static pid_t wait_iteration(pid_t child, const sigset_t *chld, long limit_ms, int *status,
+                            struct rusage *ru, int *timed_out) {
+    long long deadline = limit_ms > 0 ? now_ns() + limit_ms * 1000000LL : 0;
+    for (;;) {
+        pid_t pid = wait4(child, status, WNOHANG, ru);
+        if (pid != 0) return pid;
+        if (*timed_out) return wait4(child, status, 0, ru);
+
+        struct timespec left = { 1, 0 };
+        if (deadline) {
+            long long ns = deadline - now_ns();
+            if (ns <= 0) {
+                kill(child, SIGKILL);
+                *timed_out = 1;
+                continue;
+            }
+            left.tv_sec = ns / 1000000000LL;
+            left.tv_nsec = ns % 1000000000LL;
+        }
+        sigtimedwait(chld, NULL, &left);
+    }
+}
+
+// Child of a fresh sandbox per run (--overhead)
+static int overhead_child_fn(void *arg) {
+    const job_spec_t *spec = (const job_spec_t *)arg;
+    int null_fd = open("/dev/null", O_RDWR | O_CLOEXEC);
+    dup2(null_fd, STDIN_FILENO);
+    dup2(null_fd, STDOUT_FILENO);
+    dup2(null_fd, STDERR_FILENO);
+    job_enter_sandbox(spec);
+    job_exec(spec);
+    return 1;
+}
+
+static int bench_zygote_fn(void *arg) {
+    const bench_args_t *b = (const bench_args_t *)arg;
+    const job_spec_t *spec = b->spec;
+
+    close(b->peer);
+    cpu_set_t one;
+    CPU_ZERO(&one);
+    CPU_SET(b->cpu, &one);
+    sched_setaffinity(0, sizeof(one), &one);
+
+    int null_fd = open("/dev/null", O_RDWR | O_CLOEXEC);
+    job_enter_sandbox(spec);
+
+    sigset_t chld;
+    sigemptyset(&chld);
+    sigaddset(&chld, SIGCHLD);
+    sigprocmask(SIG_BLOCK, &chld, NULL);
+
+    // One request (any int) per iteration; EOF ends the benchmark
+    int request;
+    while (recv(b->sock, &request, sizeof(request), 0) == sizeof(request)) {
+        bench_report_t report = {0};
+        long long start = now_ns();
+        pid_t child = fork();
+        if (child == 0) {
+            sigprocmask(SIG_UNBLOCK, &chld, NULL);
+            dup2(null_fd, STDIN_FILENO);
+            dup2(null_fd, STDOUT_FILENO);
+            dup2(null_fd, STDERR_FILENO);
+            job_exec(spec);
+        }
+
+        struct rusage ru = {0};
+        if (child < 0 || wait_iteration(child, &chld, spec->limits.time_ms, &report.status, &ru,
+                                        &report.timed_out) != child) {
+            report.status = -1;
+        }
+        report.wall_ns = now_ns() - start;
+        report.cpu_ns = ((long long)(ru.ru_utime.tv_sec + ru.ru_stime.tv_sec) * 1000000LL +
+                         ru.ru_utime.tv_usec + ru.ru_stime.tv_usec) * 1000LL;
+        report.peak_rss_kb = ru.ru_maxrss;
+        if (send(b->sock, &report, sizeof(report), MSG_NOSIGNAL) != sizeof(report)) break;
+    }
+    _exit(0);
+}
+
+// -------------------------------------------------------------
+// Statistics
+// -------------------------------------------------------------
+
+static int compare_double(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+static double median_sorted(const double *sorted, int n) {
+    return n % 2 ? sorted[n / 2] : (sorted[n / 2 - 1] + sorted[n / 2]) / 2.0;
+}
+
+// Median, MAD, min and a 95% CI for the median from order statistics
+// (no normality assumption; run times are skewed)
+void bench_stats(const double *values, int n, bench_stats_t *out) {
+    memset(out, 0, sizeof(*out));
+    if (n <= 0) return;
+
+    double *sorted = malloc(sizeof(double) * n);
+    double *dev = malloc(sizeof(double) * n);
+    if (!sorted || !dev) {
+        free(sorted);
+        free(dev);
+        return;
+    }
+    memcpy(sorted, values, sizeof(double) * n);
+    qsort(sorted, n, sizeof(double), compare_double);
+
+    out->median = median_sorted(sorted, n);
+    out->min = sorted[0];
+    for (int i = 0; i < n; i++) dev[i] = fabs(sorted[i] - out->median);
+    qsort(dev, n, sizeof(double), compare_double);
+    out->mad = median_sorted(dev, n);
+
+    // Ranks n/2 -+ 1.96 * sqrt(n)/2 (1-based), clamped to the sample
+    double half = 1.96 * sqrt((double)n) / 2.0;
+    int lo = (int)floor(n / 2.0 - half);
+    int hi = (int)ceil(n / 2.0 + half) + 1;
+    if (lo < 1) lo = 1;
+    if (hi > n) hi = n;
+    out->ci_low = sorted[lo - 1];
+    out->ci_high = sorted[hi - 1];
+
+    free(sorted);
+    free(dev);
+}
+
+// -------------------------------------------------------------
+// Launcher side
+// -------------------------------------------------------------
+
+static void describe_exit(const bench_report_t *r, char *out, size_t len) {
+    if (r->status == -1) {
+        snprintf(out, len, "SPAWN_FAILED");
+    } else if (WIFEXITED(r->status)) {
+        snprintf(out, len, "EXITED(%d)", WEXITSTATUS(r->status));
+    } else if (r->timed_out) {
+        snprintf(out, len, "TIME_LIMIT_EXCEEDED");
+    } else if (WTERMSIG(r->status) == SIGSYS) {
+        snprintf(out, len, "SECURITY_VIOLATION");
+    } else {
+        snprintf(out, len, "SIGNALED");
+    }
+}
+
+// An exclusive core if the allocator has one free, else the last allowed CPU
+static int pick_cpu(const job_spec_t *spec, cpu_set_t *reserved) {
+    cpu_set_t run_on;
+    CPU_ZERO(reserved);
+    if (spec->cores && core_allocate(spec->cores, CPUSET_EXCLUSIVE, 1, spec->idle_siblings, &run_on,
+                                     reserved) == 0) {
+        for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+            if (CPU_ISSET(cpu, &run_on)) return cpu;
+        }
+    }
+    if (sched_getaffinity(0, sizeof(run_on), &run_on) != 0) return 0;
+    for (int cpu = CPU_SETSIZE - 1; cpu >= 0; cpu--) {
+        if (CPU_ISSET(cpu, &run_on)) return cpu;
+    }
+    return 0;
+}
+
+static void write_series(FILE *fp, const char *name, const double *values, int n, const char *end) {
+    fprintf(fp, "    \"%s\": [", name);
+    for (int i = 0; i < n; i++) fprintf(fp, "%.0f%s", values[i], i < n - 1 ? "," : "");
+    fprintf(fp, "]%s\n", end);
+}
+
+static void write_stats(FILE *fp, const char *name, const bench_stats_t *s, const char *end) {
+    fprintf(fp, "    \"%s\": {\"median\": %.0f, \"mad\": %.0f, \"min\": %.0f, \"ci95_low\": %.0f, \"ci95_high\": %.0f}%s\n",
+            name, s->median, s->mad, s->min, s->ci_low, s->ci_high, end);
+}
+
+static void print_stats(const char *name, const bench_stats_t *s, double scale, const char *unit) {
+    printf("[Bench] %-8s median %10.3f %s  MAD %9.3f  min %10.3f  95%% CI [%.3f, %.3f]\n", name,
+           s->median / scale, unit, s->mad / scale, s->min / scale, s->ci_low / scale, s->ci_high / scale);
+}
+
+int bench_run(const job_spec_t *spec_in, const bench_config_t *config) {
+    job_spec_t spec = *spec_in;
+    spec.quiet = 1;
+    struct sock_fprog own_filter = {0};
+    if (!spec.filter) {
+        if (job_compile_filter(spec.profile, &own_filter) != 0) return 1;
+        spec.filter = &own_filter;
+    }
+    if (!spec.binary_hash[0]) predict_hash_file(spec.binary_path, spec.binary_hash, sizeof(spec.binary_hash));
+
+    int max = config->iterations;
+    double *wall_ns = calloc(max, sizeof(double));
+    double *cpu_ns = calloc(max, sizeof(double));
+    double *rss_kb = calloc(max, sizeof(double));
+    int sv[2];
+    char *stack = malloc(STACK_SIZE);
+    if (!wall_ns || !cpu_ns || !rss_kb || !stack ||
+        socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, sv) != 0) {
+        perror("bench setup");
+        free(wall_ns);
+        free(cpu_ns);
+        free(rss_kb);
+        free(stack);
+        free(own_filter.filter);
+        return 1;
+    }
+
+    cpu_set_t reserved;
+    int flags = CLONE_NEWNS | CLONE_NEWPID | CLONE_NEWIPC | CLONE_NEWUTS | CLONE_NEWUSER | SIGCHLD;
+    bench_args_t b = { &spec, sv[1], sv[0], pick_cpu(&spec, &reserved) };
+    fflush(stdout);
+    pid_t zygote = clone(bench_zygote_fn, stack + STACK_SIZE, flags, &b);
+    free(stack);
+    close(sv[1]);
+    if (zygote == -1) {
+        perror("clone failed");
+        close(sv[0]);
+        if (spec.cores) core_release(spec.cores, &reserved);
+        free(wall_ns);
+        free(cpu_ns);
+        free(rss_kb);
+        free(own_filter.filter);
+        return 1;
+    }
+    printf("[Bench] %s: up to %d run(s) after %d warmup, pinned to CPU %d%s, stop at +-%.1f%% of the median\n",
+           spec.binary_path, max, config->warmup, b.cpu, CPU_COUNT(&reserved) ? " (exclusive)" : "",
+           config->precision * 100.0);
+
+    int n = 0, stable = 0;
+    char exit_reason[32] = "EXITED(0)";
+    bench_stats_t wall;
+    for (int i = 0; i < config->warmup + max; i++) {
+        bench_report_t report;
+        if (send(sv[0], &i, sizeof(i), MSG_NOSIGNAL) != sizeof(i) ||
+            recv(sv[0], &report, sizeof(report), 0) != sizeof(report)) {
+            fprintf(stderr, "[Bench] Sandbox zygote exited early\n");
+            break;
+        }
+        // Only runs that ended on their own are comparable
+        describe_exit(&report, exit_reason, sizeof(exit_reason));
+        if (report.status == -1 || !WIFEXITED(report.status)) {
+            printf("[Bench] Run %d ended %s: stopping\n", i, exit_reason);
+            break;
+        }
+        if (i < config->warmup) continue;
+
+        wall_ns[n] = report.wall_ns;
+        cpu_ns[n] = report.cpu_ns;
+        rss_kb[n] = report.peak_rss_kb;
+        n++;
+        if (n >= BENCH_MIN_ITERATIONS) {
+            bench_stats(wall_ns, n, &wall);
+            if ((wall.ci_high - wall.ci_low) / 2.0 <= config->precision * wall.median) {
+                stable = 1;
+                break;
+            }
+        }
+    }
+
+    close(sv[0]);
+    waitpid(zygote, NULL, 0);
+    if (spec.cores) core_release(spec.cores, &reserved);
+
+    bench_stats_t cpu, rss;
+    bench_stats(wall_ns, n, &wall);
+    bench_stats(cpu_ns, n, &cpu);
+    bench_stats(rss_kb, n, &rss);
+    printf("[Bench] %d measured run(s), %s\n", n,
+           stable ? "estimate stable" : "iteration limit reached before the estimate was stable");
+    if (n > 0) {
+        print_stats("wall", &wall, 1e6, "ms");
+        print_stats("cpu", &cpu, 1e6, "ms");
+        print_stats("peak_rss", &rss, 1, "KB");
+    }
+
+    char log_path[128];
+    snprintf(log_path, sizeof(log_path), "logs/bench_%d_%ld.json", getpid(), time(NULL));
+    FILE *fp = fopen(log_path, "w");
+    if (fp) {
+        fprintf(fp, "{\n");
+        char program[JSON_STR_MAX];
+        fprintf(fp, "  \"program\": \"%s\",\n", json_escape(spec.binary_path, program, sizeof(program)));
+        fprintf(fp, "  \"profile\": \"%s\",\n", spec.profile_name);
+        if (spec.binary_hash[0]) fprintf(fp, "  \"binary_hash\": \"%s\",\n", spec.binary_hash);
+        fprintf(fp, "  \"bench\": {\"max_iterations\": %d, \"warmup\": %d, \"precision\": %.4f, \"cpu\": %d, "
+                    "\"exclusive\": %s, \"iterations\": %d, \"stable\": %s, \"exit_reason\": \"%s\"},\n",
+                max, config->warmup, config->precision, b.cpu, CPU_COUNT(&reserved) ? "true" : "false", n,
+                stable ? "true" : "false", exit_reason);
+        fprintf(fp, "  \"summary\": {\n");
+        write_stats(fp, "wall_ns", &wall, ",");
+        write_stats(fp, "cpu_ns", &cpu, ",");
+        write_stats(fp, "peak_rss_kb", &rss, "");
+        fprintf(fp, "  },\n");
+        fprintf(fp, "  \"iterations\": {\n");
+        write_series(fp, "wall_ns", wall_ns, n, ",");
+        write_series(fp, "cpu_ns", cpu_ns, n, ",");
+        write_series(fp, "peak_rss_kb", rss_kb, n, "");
+        fprintf(fp, "  }\n}\n");
+        fclose(fp);
+        printf("[Bench] Log written to %s\n", log_path);
+    } else {
+        perror("fopen bench log");
+    }
+
+    free(wall_ns);
+    free(cpu_ns);
+    free(rss_kb);
+    free(own_filter.filter);
+    return n > 0 ? 0 : 1;
+}
+
+// -------------------------------------------------------------
+// OVERHEAD A/B (--overhead N)
+// N rounds, each running the binary once per variant: plain fork+exec, then
+// a fresh sandbox (namespaces, mounts, rlimits, seccomp) under every
+// profile. All variants share one pinned CPU and the order rotates every
+// round, so drift (frequency, caches, other load) hits them alike.
+// Namespaces are created inside the parent's clone() and never show up in
+// the child's rusage, so spawn time (clone() or fork() until it returns in
+// the parent) is measured on its own. The child's system time holds the
+// rest: mount and rlimit setup, then per-syscall seccomp filtering.
+// -------------------------------------------------------------
+
+#define OVERHEAD_VARIANTS 4
+
+typedef struct {
+    const char *name;
+    int sandboxed;
+    job_spec_t spec;
+    struct sock_fprog filter;
+    double *wall_ns;
+    double *cpu_ns;
+    double *sys_ns;
+    double *spawn_ns;           // clone()/fork() as seen by the parent
+    int ok;
+    char failed[32];            // Exit reason of the first failed run ("" = none)
+    bench_stats_t wall, cpu, sys, spawn;
+} overhead_variant_t;
+
+static int overhead_once(overhead_variant_t *v, const sigset_t *chld, char *stack, int null_fd) {
+    int flags = CLONE_NEWNS | CLONE_NEWPID | CLONE_NEWIPC | CLONE_NEWUTS | CLONE_NEWUSER | SIGCHLD;
+    bench_report_t report = {0};
+    struct rusage ru = {0};
+
+    long long start = now_ns();
+    pid_t child;
+    if (v->sandboxed) {
+        child = clone(overhead_child_fn, stack + STACK_SIZE, flags, &v->spec);
+    } else {
+        child = fork();
+        if (child == 0) {
+            sigprocmask(SIG_UNBLOCK, chld, NULL);
+            signal(SIGPIPE, SIG_DFL);
+            dup2(null_fd, STDIN_FILENO);
+            dup2(null_fd, STDOUT_FILENO);
+            dup2(null_fd, STDERR_FILENO);
+            execv(v->spec.binary_path, v->spec.args);
+            _exit(127);
+        }
+    }
+    long long spawn = now_ns() - start;
+    if (child < 0 || wait_iteration(child, chld, v->spec.limits.time_ms, &report.status, &ru,
+                                    &report.timed_out) != child) {
+        report.status = -1;
+    }
+    long long wall = now_ns() - start;
+
+    if (report.status == -1 || !WIFEXITED(report.status) || WEXITSTATUS(report.status) == 127) {
+        if (!v->failed[0]) describe_exit(&report, v->failed, sizeof(v->failed));
+        return -1;
+    }
+    v->wall_ns[v->ok] = wall;
+    v->spawn_ns[v->ok] = spawn;
+    v->cpu_ns[v->ok] = ((double)(ru.ru_utime.tv_sec + ru.ru_stime.tv_sec) * 1e6 +
+                        ru.ru_utime.tv_usec + ru.ru_stime.tv_usec) * 1000.0;
+    v->sys_ns[v->ok] = ((double)ru.ru_stime.tv_sec * 1e6 + ru.ru_stime.tv_usec) * 1000.0;
+    v->ok++;
+    return 0;
+}
+
+static void print_delta(const char *name, double value, double base) {
+    printf("  %s %9.3f ms (%+8.3f ms, %+6.1f%%)", name, value / 1e6, (value - base) / 1e6,
+           base > 0 ? (value - base) * 100.0 / base : 0.0);
+}
+
+int bench_overhead(const job_spec_t *spec_in, int rounds) {
+    static const struct { const char *name; sandbox_profile_t profile; int sandboxed; } kinds[OVERHEAD_VARIANTS] = {
+        { "none", PROFILE_STRICT, 0 },
+        { "STRICT", PROFILE_STRICT, 1 },
+        { "RESOURCE-AWARE", PROFILE_RESOURCE_AWARE, 1 },
+        { "LEARNING", PROFILE_LEARNING, 1 },
+    };
+
+    overhead_variant_t variants[OVERHEAD_VARIANTS];
+    memset(variants, 0, sizeof(variants));
+    char *stack = malloc(STACK_SIZE);
+    int null_fd = open("/dev/null", O_RDWR | O_CLOEXEC);
+    int ready = stack != NULL && null_fd >= 0;
+    for (int i = 0; i < OVERHEAD_VARIANTS; i++) {
+        overhead_variant_t *v = &variants[i];
+        v->name = kinds[i].name;
+        v->sandboxed = kinds[i].sandboxed;
+        v->spec = *spec_in;
+        v->spec.quiet = 1;
+        v->spec.profile = kinds[i].profile;
+        v->spec.profile_name = kinds[i].name;
+        v->wall_ns = calloc(rounds, sizeof(double));
+        v->cpu_ns = calloc(rounds, sizeof(double));
+        v->sys_ns = calloc(rounds, sizeof(double));
+        v->spawn_ns = calloc(rounds, sizeof(double));
+        ready = ready && v->wall_ns && v->cpu_ns && v->sys_ns && v->spawn_ns;
+        if (v->sandboxed) {
+            ready = ready && job_compile_filter(v->spec.profile, &v->filter) == 0;
+            v->spec.filter = &v->filter;
+        }
+    }
+
+    cpu_set_t reserved, old_affinity, one;
+    CPU_ZERO(&reserved);
+    int cpu = -1;
+    if (ready) {
+        // Pin ourselves: fork() and clone() children inherit it
+        cpu = pick_cpu(spec_in, &reserved);
+        sched_getaffinity(0, sizeof(old_affinity), &old_affinity);
+        CPU_ZERO(&one);
+        CPU_SET(cpu, &one);
+        sched_setaffinity(0, sizeof(one), &one);
+
+        printf("[Overhead] %s: %d interleaved round(s) of plain fork+exec vs every profile, pinned to CPU %d%s\n",
+               spec_in->binary_path, rounds, cpu, CPU_COUNT(&reserved) ? " (exclusive)" : "");
+        fflush(stdout);
+
+        sigset_t chld, old_mask;
+        sigemptyset(&chld);
+        sigaddset(&chld, SIGCHLD);
+        sigprocmask(SIG_BLOCK, &chld, &old_mask);
+        for (int r = 0; r < rounds; r++) {
+            for (int k = 0; k < OVERHEAD_VARIANTS; k++) {
+                overhead_variant_t *v = &variants[(r + k) % OVERHEAD_VARIANTS];
+                if (v->failed[0] && v->ok == 0) continue;   // e.g. the profile blocks the binary
+                overhead_once(v, &chld, stack, null_fd);
+            }
+        }
+        sigprocmask(SIG_SETMASK, &old_mask, NULL);
+        sched_setaffinity(0, sizeof(old_affinity), &old_affinity);
+        if (spec_in->cores) core_release(spec_in->cores, &reserved);
+    } else {
+        perror("overhead setup");
+    }
+
+    const overhead_variant_t *base = &variants[0];
+    for (int i = 0; i < OVERHEAD_VARIANTS; i++) {
+        overhead_variant_t *v = &variants[i];
+        bench_stats(v->wall_ns, v->ok, &v->wall);
+        bench_stats(v->cpu_ns, v->ok, &v->cpu);
+        bench_stats(v->sys_ns, v->ok, &v->sys);
+        bench_stats(v->spawn_ns, v->ok, &v->spawn);
+    }
+    for (int i = 0; ready && i < OVERHEAD_VARIANTS; i++) {
+        const overhead_variant_t *v = &variants[i];
+        printf("[Overhead] %-15s", v->name);
+        if (v->ok == 0 || base->ok == 0) {
+            printf(" n/a (%s)\n", v->failed[0] ? v->failed : "no runs");
+            continue;
+        }
+        print_delta("wall", v->wall.median, base->wall.median);
+        print_delta("cpu", v->cpu.median, base->cpu.median);
+        print_delta("sys", v->sys.median, base->sys.median);
+        print_delta("spawn", v->spawn.median, base->spawn.median);
+        printf("%s\n", v->failed[0] ? " (some runs failed)" : "");
+    }
+
+    int rc = 1;
+    char log_path[128];
+    snprintf(log_path, sizeof(log_path), "logs/overhead_%d_%ld.json", getpid(), time(NULL));
+    FILE *fp = ready ? fopen(log_path, "w") : NULL;
+    if (fp) {
+        fprintf(fp, "{\n");
+        char program[JSON_STR_MAX];
+        fprintf(fp, "  \"program\": \"%s\",\n", json_escape(spec_in->binary_path, program, sizeof(program)));
+        fprintf(fp, "  \"overhead\": {\"rounds\": %d, \"cpu\": %d, \"exclusive\": %s},\n", rounds, cpu,
+                CPU_COUNT(&reserved) ? "true" : "false");
+        fprintf(fp, "  \"variants\": [\n");
+        for (int i = 0; i < OVERHEAD_VARIANTS; i++) {
+            const overhead_variant_t *v = &variants[i];
+            fprintf(fp, "    {\"name\": \"%s\", \"runs\": %d, \"failed\": \"%s\",\n", v->name, v->ok, v->failed);
+            write_stats(fp, "wall_ns", &v->wall, ",");
+            write_stats(fp, "cpu_ns", &v->cpu, ",");
+            write_stats(fp, "sys_ns", &v->sys, ",");
+            write_stats(fp, "spawn_ns", &v->spawn, ",");
+            fprintf(fp, "    \"overhead_ns\": {\"wall\": %.0f, \"cpu\": %.0f, \"sys\": %.0f, \"spawn\": %.0f},\n",
+                    v->wall.median - base->wall.median, v->cpu.median - base->cpu.median,
+                    v->sys.median - base->sys.median, v->spawn.median - base->spawn.median);
+            write_series(fp, "wall_ns", v->wall_ns, v->ok, ",");
+            write_series(fp, "cpu_ns", v->cpu_ns, v->ok, ",");
+            write_series(fp, "sys_ns", v->sys_ns, v->ok, ",");
+            write_series(fp, "spawn_ns", v->spawn_ns, v->ok, "");
+            fprintf(fp, "    }%s\n", i < OVERHEAD_VARIANTS - 1 ? "," : "");
+        }
+        fprintf(fp, "  ]\n}\n");
+        fclose(fp);
+        printf("[Overhead] Log written to %s\n", log_path);
+        rc = base->ok > 0 ? 0 : 1;
+    }
+
+    for (int i = 0; i < OVERHEAD_VARIANTS; i++) {
+        free(variants[i].wall_ns);
+        free(variants[i].cpu_ns);
+        free(variants[i].sys_ns);
+        free(variants[i].spawn_ns);
+        free(variants[i].filter.filter);
+    }
+    if (null_fd >= 0) close(null_fd);
+    free(stack);
+    return rc;
+}
@@ -0,0 +1,28 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include "job.h"
+
+#define BENCH_MIN_ITERATIONS 5  // Before the stopping rule may end the run
+
+typedef struct {
+    int iterations;             // At most this many measured runs
+    int warmup;                 // Runs discarded first (page cache, CPU frequency)
+    double precision;           // Stop once the wall-time CI half-width is within this fraction of the median
+} bench_config_t;
+
+// Robust summary of one metric over the measured iterations
+typedef struct {
+    double median;
+    double mad;                 // Median absolute deviation
+    double min;
+    double ci_low;              // 95% distribution-free CI of the median
+    double ci_high;
+} bench_stats_t;
+
+// Function prototypes
+void bench_stats(const double *values, int n, bench_stats_t *out);
+int bench_run(const job_spec_t *spec, const bench_config_t *config);
+int bench_overhead(const job_spec_t *spec, int rounds);
+
+#endif
@@ -0,0 +1,435 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <time.h>
+#include <sys/stat.h>
+#include "cache.h"
+
+/**
+ * EXECUTION CACHE (--cache[=DIR])
+ *
+ * CI resubmits the same binary with the same args and stdin many times a
+ * day. With --cache a run is keyed by a 128-bit FNV-1a hash of the binary's
+ * contents, argv, stdin (a regular file or /dev/null), the environment, the
+ * profile, the LEARNING policy, the limits and, with --expect, the expected
+ * output's contents and the verify mode. A hit replays the stored stdout/stderr and
+ * writes the original run's log marked "cached": true, without launching.
+ *
+ * DIR/<key>/ holds stdout, stderr, result and log.json. Entries are built in
+ * DIR/tmp.* and renamed into place, so concurrent launchers never see half an
+ * entry. The entry directory's mtime is its LRU stamp: after every insert
+ * the least recently used entries go until DIR fits the disk budget.
+ *
+ * --cache-verify=RATE re-executes that fraction of hits and compares the
+ * result; an entry that differs is marked nondeterministic and no longer
+ * served.
+ */
+
+#define STALE_TMP_SECONDS (24 * 3600)   // Left behind by a launcher that died mid-run
+
+typedef unsigned __int128 hash128_t;
+
+#define FNV128_PRIME (((hash128_t)1 << 88) | 0x13b)
+
+typedef struct {
+    char name[CACHE_KEY_LEN];
+    time_t last_used;
+    long kb;
+} cache_entry_t;
+
+static void fnv_update(hash128_t *h, const void *data, size_t len) {
+    const unsigned char *p = data;
+    for (size_t i = 0; i < len; i++) {
+        *h ^= p[i];
+        *h *= FNV128_PRIME;
+    }
+}
+
+// Length-prefixed, so ("ab", "c") and ("a", "bc") hash differently
+static void fnv_field(hash128_t *h, const char *s) {
+    size_t len = strlen(s);
+    fnv_update(h, &len, sizeof(len));
+    fnv_update(h, s, len);
+}
+
+// From offset to EOF with pread(), leaving the file position to the job
+static int fnv_fd(hash128_t *h, int fd, off_t offset) {
+    unsigned char buf[65536];
+    ssize_t got;
+    while ((got = pread(fd, buf, sizeof(buf), offset)) > 0) {
+        fnv_update(h, buf, got);
+        offset += got;
+    }
+    return got < 0 ? -1 : 0;
+}
+
+// A tty or pipe can't be hashed without consuming it, so those runs are not cached
+static int fnv_stdin(hash128_t *h, int fd) {
+    struct stat st, null_st;
+    if (fstat(fd, &st) != 0) return -1;
+
+    if (S_ISREG(st.st_mode)) {
+        off_t offset = lseek(fd, 0, SEEK_CUR);
+        fnv_field(h, "stdin:file");
+        return fnv_fd(h, fd, offset < 0 ? 0 : offset);
+    }
+    if (S_ISCHR(st.st_mode) && stat("/dev/null", &null_st) == 0 && st.st_rdev == null_st.st_rdev) {
+        fnv_field(h, "stdin:null");
+        return 0;
+    }
+    return -1;
+}
+
+// Everything that decides what the job does. Returns -1 if it can't be cached.
+int cache_key(const job_spec_t *spec, char *out, size_t len) {
+    hash128_t h = ((hash128_t)0x6c62272e07bb0142ULL << 64) | 0x62b821756295c58dULL;
+
+    int fd = open(spec->binary_path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return -1;
+    int rc = fnv_fd(&h, fd, 0);
+    close(fd);
+    if (rc != 0) return -1;
+
+    size_t argc = 0;
+    while (spec->args[argc]) argc++;
+    fnv_update(&h, &argc, sizeof(argc));
+    for (size_t i = 0; i < argc; i++) fnv_field(&h, spec->args[i]);
+
+    if (spec->stdin_path) {
+        // Opening a FIFO would block until a writer shows up, and it can't be
+        // hashed anyway (O_NONBLOCK covers one swapped in after the stat)
+        struct stat st;
+        if (stat(spec->stdin_path, &st) != 0 || S_ISFIFO(st.st_mode)) return -1;
+        fd = open(spec->stdin_path, O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+        if (fd < 0) return -1;
+        rc = fnv_stdin(&h, fd);
+        close(fd);
+        if (rc != 0) return -1;
+    } else if (fnv_stdin(&h, spec->stdin_fd >= 0 ? spec->stdin_fd : STDIN_FILENO) != 0) {
+        return -1;
+    }
+
+    // The verdict in the stored log depends on the expected output and how it is compared
+    if (spec->expected_path) {
+        fd = open(spec->expected_path, O_RDONLY | O_CLOEXEC);
+        if (fd < 0) return -1;
+        fnv_field(&h, "expect");
+        rc = fnv_fd(&h, fd, 0);
+        close(fd);
+        if (rc != 0) return -1;
+        fnv_field(&h, verify_mode_name(spec->verify_mode));
+        fnv_field(&h, spec->verify_kill ? "verify_kill" : "verify_nokill");
+    }
+
+    // The job inherits our environment, and its output may depend on any of it
+    size_t envc = 0;
+    while (environ[envc]) envc++;
+    fnv_update(&h, &envc, sizeof(envc));
+    for (size_t i = 0; i < envc; i++) fnv_field(&h, environ[i]);
+
+    char config[256];
+    snprintf(config, sizeof(config), "%s mem_soft=%d mem_mb=%ld nproc=%d nofile=%d time_ms=%ld policy=%s:%ld,%lu,%ld "
+             "scratch=%ld,%ld",
+             spec->profile_name, spec->mem_soft, spec->limits.memory_mb, spec->limits.nproc, spec->limits.nofile,
+             spec->limits.time_ms, spec->policy.name, spec->policy.cpu_ms_threshold, spec->policy.majflt_threshold,
+             spec->policy.memory_kb_threshold, spec->scratch_mb, spec->scratch_mb > 0 ? spec->scratch_inodes : 0);
+    fnv_field(&h, config);
+
+    snprintf(out, len, "%016llx%016llx", (unsigned long long)(h >> 64), (unsigned long long)h);
+    return 0;
+}
+
+// -------------------------------------------------------------
+// ENTRY FILES
+// -------------------------------------------------------------
+
+static int copy_fd(int in, int out) {
+    char buf[65536];
+    ssize_t got;
+    while ((got = read(in, buf, sizeof(buf))) > 0) {
+        for (ssize_t done = 0; done < got; ) {
+            ssize_t put = write(out, buf + done, got - done);
+            if (put < 0) return -1;
+            done += put;
+        }
+    }
+    return got < 0 ? -1 : 0;
+}
+
+static int copy_file(const char *from, int out) {
+    int fd = open(from, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return -1;
+    int rc = copy_fd(fd, out);
+    close(fd);
+    return rc;
+}
+
+static int copy_to_path(const char *from, const char *to) {
+    int out = open(to, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (out < 0) return -1;
+    int rc = copy_file(from, out);
+    close(out);
+    return rc;
+}
+
+static int same_file(const char *a, const char *b) {
+    FILE *fa = fopen(a, "r"), *fb = fopen(b, "r");
+    int same = fa && fb;
+    while (same) {
+        int ca = fgetc(fa), cb = fgetc(fb);
+        if (ca != cb) same = 0;
+        if (ca == EOF) break;
+    }
+    if (fa) fclose(fa);
+    if (fb) fclose(fb);
+    return same;
+}
+
+static char *read_file(const char *path) {
+    FILE *fp = fopen(path, "r");
+    if (!fp) return NULL;
+    char *buf = NULL;
+    size_t len = 0;
+    if (getdelim(&buf, &len, '\0', fp) < 0) {
+        free(buf);
+        buf = NULL;
+    }
+    fclose(fp);
+    return buf;
+}
+
+// Disk use of an entry in KB; remove != 0 deletes it on the way
+static long walk_entry(const char *path, int remove) {
+    long kb = 0;
+    DIR *dir = opendir(path);
+    if (!dir) return 0;
+    struct dirent *ent;
+    while ((ent = readdir(dir)) != NULL) {
+        if (ent->d_name[0] == '.') continue;
+        struct stat st;
+        if (fstatat(dirfd(dir), ent->d_name, &st, AT_SYMLINK_NOFOLLOW) == 0) kb += st.st_blocks / 2;
+        if (remove) unlinkat(dirfd(dir), ent->d_name, 0);
+    }
+    closedir(dir);
+    if (remove) rmdir(path);
+    return kb;
+}
+
+static int compare_last_used(const void *a, const void *b) {
+    const cache_entry_t *x = a, *y = b;
+    return (x->last_used > y->last_used) - (x->last_used < y->last_used);
+}
+
+// Drop least recently used entries until the cache fits its budget
+static void cache_evict(const cache_config_t *config) {
+    DIR *dir = opendir(config->dir);
+    if (!dir) return;
+
+    int count = 0, cap = 64;
+    cache_entry_t *entries = malloc(sizeof(cache_entry_t) * cap);
+    long total_kb = 0;
+    time_t now = time(NULL);
+    struct dirent *ent;
+    while (entries && (ent = readdir(dir)) != NULL) {
+        if (ent->d_name[0] == '.') continue;
+        char path[512];
+        snprintf(path, sizeof(path), "%s/%s", config->dir, ent->d_name);
+        struct stat st;
+        if (stat(path, &st) != 0 || !S_ISDIR(st.st_mode)) continue;
+
+        if (strncmp(ent->d_name, "tmp.", 4) == 0) {
+            if (now - st.st_mtime > STALE_TMP_SECONDS) walk_entry(path, 1);
+            continue;
+        }
+        if (strlen(ent->d_name) != CACHE_KEY_LEN - 1) continue;
+
+        if (count == cap) {
+            cap *= 2;
+            entries = realloc(entries, sizeof(cache_entry_t) * cap);
+            if (!entries) break;
+        }
+        snprintf(entries[count].name, sizeof(entries[count].name), "%s", ent->d_name);
+        entries[count].last_used = st.st_mtime;
+        entries[count].kb = walk_entry(path, 0);
+        total_kb += entries[count].kb;
+        count++;
+    }
+    closedir(dir);
+    if (!entries) return;
+
+    qsort(entries, count, sizeof(cache_entry_t), compare_last_used);
+    int evicted = 0;
+    for (int i = 0; i < count && total_kb > config->budget_kb; i++) {
+        char path[512];
+        snprintf(path, sizeof(path), "%s/%s", config->dir, entries[i].name);
+        walk_entry(path, 1);
+        total_kb -= entries[i].kb;
+        evicted++;
+    }
+    if (evicted > 0) {
+        printf("[Cache] Evicted %d least recently used entr%s (now %ld KB of %ld KB)\n",
+               evicted, evicted == 1 ? "y" : "ies", total_kb, config->budget_kb);
+    }
+    free(entries);
+}
+
+// -------------------------------------------------------------
+// HIT / MISS
+// -------------------------------------------------------------
+
+// Replay a stored run: its output, then its log under a new name
+static int serve_hit(const char *entry, const char *key, const char *exit_reason, long runtime_ms) {
+    printf("[Cache] Hit %s: %s (original run took %ld ms), not launching\n", key, exit_reason, runtime_ms);
+    fflush(stdout);
+
+    char path[600];
+    snprintf(path, sizeof(path), "%s/stdout", entry);
+    copy_file(path, STDOUT_FILENO);
+    snprintf(path, sizeof(path), "%s/stderr", entry);
+    copy_file(path, STDERR_FILENO);
+
+    // Most recently used now
+    utimensat(AT_FDCWD, entry, NULL, 0);
+
+    snprintf(path, sizeof(path), "%s/log.json", entry);
+    char *log = read_file(path);
+    if (!log || strncmp(log, "{\n", 2) != 0) {
+        free(log);
+        return 0;
+    }
+
+    char filename[128];
+    snprintf(filename, sizeof(filename), "logs/run_cached_%d_%ld.json", getpid(), time(NULL));
+    FILE *fp = fopen(filename, "w");
+    if (fp) {
+        fprintf(fp, "{\n  \"cached\": true,\n  \"cache_key\": \"%s\",\n%s", key, log + 2);
+        fclose(fp);
+        printf("[Telemetry] Log written to %s (cached)\n", filename);
+    }
+    free(log);
+    return 0;
+}
+
+// Run the job with stdout/stderr captured in dir, then pass them on as a
+// normal run would have (after the fact rather than live)
+static int run_captured(job_spec_t *spec, const char *dir, job_result_t *result) {
+    char out_path[600], err_path[600];
+    snprintf(out_path, sizeof(out_path), "%s/stdout", dir);
+    snprintf(err_path, sizeof(err_path), "%s/stderr", dir);
+
+    int out = open(out_path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    int err = open(err_path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    int rc = -1;
+    if (out >= 0 && err >= 0) {
+        spec->stdout_fd = out;
+        spec->stderr_fd = err;
+        rc = job_run(spec, result);
+        spec->stdout_fd = -1;
+        spec->stderr_fd = -1;
+    }
+    if (out >= 0) close(out);
+    if (err >= 0) close(err);
+
+    fflush(stdout);
+    copy_file(out_path, STDOUT_FILENO);
+    copy_file(err_path, STDERR_FILENO);
+    return rc;
+}
+
+static int outputs_match(const char *a, const char *b) {
+    char pa[600], pb[600];
+    const char *files[] = { "stdout", "stderr" };
+    for (int i = 0; i < 2; i++) {
+        snprintf(pa, sizeof(pa), "%s/%s", a, files[i]);
+        snprintf(pb, sizeof(pb), "%s/%s", b, files[i]);
+        if (!same_file(pa, pb)) return 0;
+    }
+    return 1;
+}
+
+// Run spec through the cache. Returns like job_run().
+int cache_run(const cache_config_t *config, job_spec_t *spec) {
+    job_result_t result;
+    char key[CACHE_KEY_LEN];
+    if (cache_key(spec, key, sizeof(key)) != 0) {
+        printf("[Cache] Stdin is not a regular file or /dev/null: running uncached\n");
+        return job_run(spec, &result);
+    }
+    mkdir(config->dir, 0755);
+    srand48(getpid() ^ time(NULL));
+
+    char entry[512], path[600];
+    snprintf(entry, sizeof(entry), "%s/%s", config->dir, key);
+    snprintf(path, sizeof(path), "%s/nondeterministic", entry);
+    int nondeterministic = access(path, F_OK) == 0;
+
+    char cached_reason[32] = "";
+    long cached_runtime_ms = 0;
+    snprintf(path, sizeof(path), "%s/result", entry);
+    FILE *fp = nondeterministic ? NULL : fopen(path, "r");
+    int hit = fp && fscanf(fp, "%31s %ld", cached_reason, &cached_runtime_ms) == 2;
+    if (fp) fclose(fp);
+
+    int verify = hit && config->verify_rate > 0 && drand48() < config->verify_rate;
+    if (hit && !verify) {
+        return serve_hit(entry, key, cached_reason, cached_runtime_ms);
+    }
+    if (nondeterministic) printf("[Cache] %s is marked nondeterministic: running uncached\n", key);
+    if (verify) printf("[Cache] Hit %s: re-executing to verify the cached result\n", key);
+
+    char tmp[512];
+    snprintf(tmp, sizeof(tmp), "%s/tmp.XXXXXX", config->dir);
+    if (!mkdtemp(tmp)) {
+        perror("cache mkdtemp");
+        return job_run(spec, &result);
+    }
+    if (run_captured(spec, tmp, &result) != 0) {
+        walk_entry(tmp, 1);
+        return -1;
+    }
+
+    if (verify) {
+        if (strcmp(result.exit_reason, cached_reason) == 0 && outputs_match(tmp, entry)) {
+            printf("[Cache] Verified %s: the re-run matches\n", key);
+            utimensat(AT_FDCWD, entry, NULL, 0);
+        } else {
+            printf("[Cache] WARNING: %s is nondeterministic (%s, cached %s, output %s); no longer served\n",
+                   key, result.exit_reason, cached_reason, outputs_match(tmp, entry) ? "same" : "differs");
+            snprintf(path, sizeof(path), "%s/nondeterministic", entry);
+            close(open(path, O_WRONLY | O_CREAT | O_CLOEXEC, 0644));
+        }
+        walk_entry(tmp, 1);
+        return 0;
+    }
+
+    // Only clean exits are worth replaying; kills and limits depend on the machine
+    if (nondeterministic || strncmp(result.exit_reason, "EXITED(", 7) != 0) {
+        if (!nondeterministic) printf("[Cache] %s not stored (%s)\n", key, result.exit_reason);
+        walk_entry(tmp, 1);
+        return 0;
+    }
+
+    snprintf(path, sizeof(path), "%s/log.json", tmp);
+    int stored = copy_to_path(result.log_path, path) == 0;
+    snprintf(path, sizeof(path), "%s/result", tmp);
+    fp = stored ? fopen(path, "w") : NULL;
+    if (fp) {
+        fprintf(fp, "%s %ld\n", result.exit_reason, result.runtime_ms);
+        stored = fclose(fp) == 0;
+    } else {
+        stored = 0;
+    }
+
+    // Another launcher may have stored the same key meanwhile; theirs wins
+    if (stored && rename(tmp, entry) == 0) {
+        printf("[Cache] Stored %s\n", key);
+        cache_evict(config);
+    } else {
+        walk_entry(tmp, 1);
+    }
+    return 0;
+}
@@ -0,0 +1,19 @@
+#ifndef CACHE_H
+#define CACHE_H
+
+#include "job.h"
+
+#define CACHE_KEY_LEN 33        // 128-bit key as hex + NUL
+
+// Result cache for deterministic jobs (--cache)
+typedef struct {
+    const char *dir;            // Entries live in DIR/<key>/
+    long budget_kb;             // LRU-evict down to this much disk
+    double verify_rate;         // Fraction of hits re-executed to catch nondeterminism
+} cache_config_t;
+
+// Function prototypes
+int cache_key(const job_spec_t *spec, char *out, size_t len);
+int cache_run(const cache_config_t *config, job_spec_t *spec);
+
+#endif
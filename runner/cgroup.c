@@ -0,0 +1,168 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/stat.h>
+#include "cgroup.h"
+
+// Root of the cgroup v2 hierarchy; on hybrid hosts it lives under /unified
+const char *cgroup_root(void) {
+    if (access(CGROUP_ROOT "/cgroup.controllers", F_OK) != 0 &&
+        access(CGROUP_ROOT "/unified/cgroup.controllers", F_OK) == 0) {
+        return CGROUP_ROOT "/unified";
+    }
+    return CGROUP_ROOT;
+}
+
+// Resolve the cgroup v2 directory of a process from /proc/[pid]/cgroup.
+// On hybrid hosts the unified hierarchy lives under /sys/fs/cgroup/unified.
+int cgroup_path_of(pid_t pid, char *out, size_t len) {
+    char path[64];
+    snprintf(path, sizeof(path), "/proc/%d/cgroup", pid);
+
+    FILE *fp = fopen(path, "r");
+    if (!fp) return -1;
+
+    char line[512];
+    char rel[512] = "";
+    while (fgets(line, sizeof(line), fp)) {
+        if (strncmp(line, "0::", 3) == 0) {
+            line[strcspn(line, "\n")] = '\0';
+            snprintf(rel, sizeof(rel), "%s", line + 3);
+            break;
+        }
+    }
+    fclose(fp);
+
+    if (rel[0] == '\0') return -1;
+
+    snprintf(out, len, "%s%s", cgroup_root(), strcmp(rel, "/") == 0 ? "" : rel);
+    return 0;
+}
+
+// Read a cgroup interface file into buf (newline stripped)
+int cgroup_read_file(const char *cgroup_path, const char *file, char *buf, size_t len) {
+    char path[512];
+    snprintf(path, sizeof(path), "%s/%s", cgroup_path, file);
+
+    FILE *fp = fopen(path, "r");
+    if (!fp) return -1;
+
+    if (!fgets(buf, len, fp)) {
+        fclose(fp);
+        return -1;
+    }
+    fclose(fp);
+    buf[strcspn(buf, "\n")] = '\0';
+    return 0;
+}
+
+// Returns 1 if memory.high is configured (anything other than "max")
+int cgroup_memory_high_set(const char *cgroup_path) {
+    char value[64];
+    if (cgroup_read_file(cgroup_path, "memory.high", value, sizeof(value)) != 0) return 0;
+    return strcmp(value, "max") != 0;
+}
+
+// Parse memory.stat and memory.events for reclaim/throttling counters.
+// Kernels >= 5.9 split workingset_refault into _anon and _file; both are summed.
+int cgroup_read_mem_stat(const char *cgroup_path, cgroup_mem_stat_t *out) {
+    char path[512];
+    char key[64];
+    unsigned long long value;
+
+    memset(out, 0, sizeof(*out));
+
+    snprintf(path, sizeof(path), "%s/memory.stat", cgroup_path);
+    FILE *fp = fopen(path, "r");
+    if (!fp) return -1;
+
+    while (fscanf(fp, "%63s %llu", key, &value) == 2) {
+        if (strcmp(key, "pgscan") == 0) {
+            out->pgscan = value;
+        } else if (strcmp(key, "pgsteal") == 0) {
+            out->pgsteal = value;
+        } else if (strncmp(key, "workingset_refault", 18) == 0) {
+            out->workingset_refault += value;
+        }
+    }
+    fclose(fp);
+
+    snprintf(path, sizeof(path), "%s/memory.events", cgroup_path);
+    fp = fopen(path, "r");
+    if (fp) {
+        while (fscanf(fp, "%63s %llu", key, &value) == 2) {
+            if (strcmp(key, "high") == 0) {
+                out->high_events = value;
+                break;
+            }
+        }
+        fclose(fp);
+    }
+    return 0;
+}
+
+int cgroup_write_file(const char *cgroup_path, const char *file, const char *value) {
+    char path[512];
+    snprintf(path, sizeof(path), "%s/%s", cgroup_path, file);
+
+    FILE *fp = fopen(path, "w");
+    if (!fp) return -1;
+    int ok = fputs(value, fp) >= 0;
+    // Errors from the kernel surface on flush
+    if (fclose(fp) != 0) ok = 0;
+    return ok ? 0 : -1;
+}
+
+// Create rel_path (e.g. "sandbox_project/run_12_3") below the v2 root,
+// delegating the controllers we use at every level on the way down.
+// Controllers the kernel does not offer are skipped individually.
+int cgroup_create(const char *rel_path, char *out, size_t len) {
+    static const char *controllers[] = { "+cpuset", "+cpu", "+memory", "+pids" };
+
+    char path[512];
+    snprintf(path, sizeof(path), "%s", cgroup_root());
+
+    char rel[256];
+    snprintf(rel, sizeof(rel), "%s", rel_path);
+
+    char *saveptr = NULL;
+    for (char *part = strtok_r(rel, "/", &saveptr); part; part = strtok_r(NULL, "/", &saveptr)) {
+        for (size_t i = 0; i < sizeof(controllers) / sizeof(controllers[0]); i++) {
+            cgroup_write_file(path, "cgroup.subtree_control", controllers[i]);
+        }
+
+        size_t used = strlen(path);
+        snprintf(path + used, sizeof(path) - used, "/%s", part);
+        if (mkdir(path, 0755) != 0 && errno != EEXIST) return -1;
+    }
+
+    snprintf(out, len, "%s", path);
+    return 0;
+}
+
+int cgroup_attach(const char *cgroup_path, pid_t pid) {
+    char value[32];
+    snprintf(value, sizeof(value), "%d", pid);
+    return cgroup_write_file(cgroup_path, "cgroup.procs", value);
+}
+
+// rmdir only succeeds once every process in the cgroup has been reaped
+int cgroup_remove(const char *cgroup_path) {
+    return rmdir(cgroup_path);
+}
+
+// A job cgroup is a sibling of the launcher's, not a child (processes may not
+// live in inner nodes), so carry over the limits sandbox.py set on ours.
+void cgroup_copy_limits(const char *from, const char *to) {
+    static const char *files[] = { "memory.max", "memory.high", "pids.max", "cpu.max" };
+    char value[128];
+
+    for (size_t i = 0; i < sizeof(files) / sizeof(files[0]); i++) {
+        if (cgroup_read_file(from, files[i], value, sizeof(value)) == 0) {
+            cgroup_write_file(to, files[i], value);
+        }
+    }
+}
@@ -0,0 +1,31 @@
+#ifndef CGROUP_H
+#define CGROUP_H
+
+#include <sys/types.h>
+#include <stddef.h>
+
+#define CGROUP_ROOT "/sys/fs/cgroup"
+#define SANDBOX_CGROUP_PARENT "sandbox_project"
+
+// Reclaim counters from memory.stat plus the "high" count from memory.events.
+// All values are cumulative for the cgroup; callers diff against a baseline.
+typedef struct {
+    unsigned long long pgscan;
+    unsigned long long pgsteal;
+    unsigned long long workingset_refault;
+    unsigned long long high_events;
+} cgroup_mem_stat_t;
+
+// Function prototypes
+int cgroup_path_of(pid_t pid, char *out, size_t len);
+int cgroup_read_file(const char *cgroup_path, const char *file, char *buf, size_t len);
+int cgroup_memory_high_set(const char *cgroup_path);
+int cgroup_read_mem_stat(const char *cgroup_path, cgroup_mem_stat_t *out);
+const char *cgroup_root(void);
+int cgroup_write_file(const char *cgroup_path, const char *file, const char *value);
+int cgroup_create(const char *rel_path, char *out, size_t len);
+int cgroup_attach(const char *cgroup_path, pid_t pid);
+int cgroup_remove(const char *cgroup_path);
+void cgroup_copy_limits(const char *from, const char *to);
+
+#endif
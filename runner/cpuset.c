@@ -0,0 +1,166 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "cpuset.h"
+
+// Parse a kernel CPU list ("0-3,8,10-11") into a cpu_set_t
+int cpuset_parse(const char *list, cpu_set_t *out) {
+    CPU_ZERO(out);
+    const char *p = list;
+    while (*p && *p != '\n') {
+        char *end;
+        long first = strtol(p, &end, 10);
+        if (end == p || first < 0 || first >= CPU_SETSIZE) return -1;
+        long last = first;
+        p = end;
+        if (*p == '-') {
+            last = strtol(p + 1, &end, 10);
+            if (end == p + 1 || last < first || last >= CPU_SETSIZE) return -1;
+            p = end;
+        }
+        for (long cpu = first; cpu <= last; cpu++) CPU_SET(cpu, out);
+        if (*p == ',') p++;
+    }
+    return 0;
+}
+
+// Format a cpu_set_t as a kernel CPU list (the syntax cpuset.cpus expects)
+int cpuset_format(const cpu_set_t *set, char *buf, size_t len) {
+    size_t used = 0;
+    buf[0] = '\0';
+    for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+        if (!CPU_ISSET(cpu, set)) continue;
+        int last = cpu;
+        while (last + 1 < CPU_SETSIZE && CPU_ISSET(last + 1, set)) last++;
+
+        int n = (last == cpu) ? snprintf(buf + used, len - used, "%s%d", used ? "," : "", cpu)
+                              : snprintf(buf + used, len - used, "%s%d-%d", used ? "," : "", cpu, last);
+        if (n < 0 || (size_t)n >= len - used) return -1;
+        used += n;
+        cpu = last;
+    }
+    return 0;
+}
+
+// SMT siblings of a CPU (including itself), from sysfs topology
+static void thread_siblings(int cpu, cpu_set_t *out) {
+    char path[128], list[256];
+    snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/topology/thread_siblings_list", cpu);
+
+    CPU_ZERO(out);
+    FILE *fp = fopen(path, "r");
+    if (fp) {
+        if (fgets(list, sizeof(list), fp)) cpuset_parse(list, out);
+        fclose(fp);
+    }
+    if (CPU_COUNT(out) == 0) CPU_SET(cpu, out);
+}
+
+int core_allocator_init(core_allocator_t *alloc, const char *exclusive_list) {
+    memset(alloc, 0, sizeof(*alloc));
+    pthread_mutex_init(&alloc->lock, NULL);
+    pthread_cond_init(&alloc->released, NULL);
+
+    // Online CPUs are what our own affinity mask allows
+    if (sched_getaffinity(0, sizeof(cpu_set_t), &alloc->online) != 0) {
+        perror("sched_getaffinity");
+        return -1;
+    }
+
+    CPU_ZERO(&alloc->exclusive_pool);
+    if (exclusive_list && cpuset_parse(exclusive_list, &alloc->exclusive_pool) != 0) {
+        fprintf(stderr, "[Cpuset] Invalid CPU list: %s\n", exclusive_list);
+        return -1;
+    }
+    CPU_AND(&alloc->exclusive_pool, &alloc->exclusive_pool, &alloc->online);
+
+    // Shared pool = online minus the exclusive partition
+    CPU_XOR(&alloc->shared_pool, &alloc->online, &alloc->exclusive_pool);
+    if (CPU_COUNT(&alloc->shared_pool) == 0) {
+        fprintf(stderr, "[Cpuset] WARNING: exclusive CPUs cover the host; shared jobs float on all CPUs.\n");
+        alloc->shared_pool = alloc->online;
+    }
+    CPU_ZERO(&alloc->in_use);
+    return 0;
+}
+
+// Try to pick 'cores' free exclusive CPUs. With idle_siblings, each pick also
+// reserves its SMT siblings so nothing else shares the physical core.
+static int try_pick(core_allocator_t *alloc, int cores, int idle_siblings,
+                    cpu_set_t *run_on, cpu_set_t *reserved) {
+    CPU_ZERO(run_on);
+    CPU_ZERO(reserved);
+
+    for (int cpu = 0; cpu < CPU_SETSIZE && CPU_COUNT(run_on) < cores; cpu++) {
+        if (!CPU_ISSET(cpu, &alloc->exclusive_pool)) continue;
+        if (CPU_ISSET(cpu, &alloc->in_use) || CPU_ISSET(cpu, reserved)) continue;
+
+        cpu_set_t take;
+        CPU_ZERO(&take);
+        CPU_SET(cpu, &take);
+        if (idle_siblings) {
+            thread_siblings(cpu, &take);
+
+            // Every sibling must be ours to idle: inside the pool and free
+            cpu_set_t outside, busy;
+            CPU_AND(&outside, &take, &alloc->exclusive_pool);
+            CPU_AND(&busy, &take, &alloc->in_use);
+            if (!CPU_EQUAL(&outside, &take) || CPU_COUNT(&busy) > 0) continue;
+        }
+
+        CPU_SET(cpu, run_on);
+        CPU_OR(reserved, reserved, &take);
+    }
+    return CPU_COUNT(run_on) == cores ? 0 : -1;
+}
+
+// Returns 0 with the CPUs to run on (and what was reserved), or -1 if the
+// exclusive partition can never satisfy the request (caller falls back).
+// Exclusive requests block until enough exclusive cores are released.
+int core_allocate(core_allocator_t *alloc, cpuset_mode_t mode, int cores, int idle_siblings,
+                  cpu_set_t *run_on, cpu_set_t *reserved) {
+    CPU_ZERO(reserved);
+
+    if (mode == CPUSET_NONE) {
+        *run_on = alloc->online;
+        return 0;
+    }
+    if (mode == CPUSET_SHARED) {
+        *run_on = alloc->shared_pool;
+        return 0;
+    }
+
+    if (cores <= 0) cores = 1;
+
+    pthread_mutex_lock(&alloc->lock);
+
+    // Would the request fit into an empty partition at all?
+    cpu_set_t saved_in_use = alloc->in_use;
+    CPU_ZERO(&alloc->in_use);
+    int feasible = try_pick(alloc, cores, idle_siblings, run_on, reserved) == 0;
+    alloc->in_use = saved_in_use;
+    if (!feasible) {
+        pthread_mutex_unlock(&alloc->lock);
+        return -1;
+    }
+
+    while (try_pick(alloc, cores, idle_siblings, run_on, reserved) != 0) {
+        pthread_cond_wait(&alloc->released, &alloc->lock);
+    }
+    CPU_OR(&alloc->in_use, &alloc->in_use, reserved);
+    pthread_mutex_unlock(&alloc->lock);
+    return 0;
+}
+
+void core_release(core_allocator_t *alloc, const cpu_set_t *reserved) {
+    if (CPU_COUNT(reserved) == 0) return;
+
+    pthread_mutex_lock(&alloc->lock);
+    cpu_set_t keep;
+    CPU_XOR(&keep, &alloc->in_use, reserved);
+    CPU_AND(&alloc->in_use, &alloc->in_use, &keep);
+    pthread_cond_broadcast(&alloc->released);
+    pthread_mutex_unlock(&alloc->lock);
+}
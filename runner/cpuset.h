@@ -0,0 +1,34 @@
+#ifndef CPUSET_H
+#define CPUSET_H
+
+#include <sched.h>
+#include <stddef.h>
+#include <pthread.h>
+
+// How a sandbox is placed on CPUs
+typedef enum {
+    CPUSET_NONE,        // Float across all CPUs (old behaviour)
+    CPUSET_SHARED,      // Batch jobs: confined to the shared pool
+    CPUSET_EXCLUSIVE    // Latency-sensitive: cores nobody else runs on
+} cpuset_mode_t;
+
+// Static partition of the host: exclusive cores are handed out one job at a
+// time, everything else online forms the shared pool.
+typedef struct {
+    pthread_mutex_t lock;
+    pthread_cond_t released;
+    cpu_set_t online;
+    cpu_set_t exclusive_pool;
+    cpu_set_t shared_pool;
+    cpu_set_t in_use;               // Exclusive cores (and idled siblings) held now
+} core_allocator_t;
+
+// Function prototypes
+int cpuset_parse(const char *list, cpu_set_t *out);
+int cpuset_format(const cpu_set_t *set, char *buf, size_t len);
+int core_allocator_init(core_allocator_t *alloc, const char *exclusive_list);
+int core_allocate(core_allocator_t *alloc, cpuset_mode_t mode, int cores, int idle_siblings,
+                  cpu_set_t *run_on, cpu_set_t *reserved);
+void core_release(core_allocator_t *alloc, const cpu_set_t *reserved);
+
+#endif
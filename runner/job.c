@@ -0,0 +1,1718 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sched.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+#include <sys/mount.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <poll.h>
+#include <sys/syscall.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <grp.h>
+#include "../policies/seccomp_rules.h"
+#include "job.h"
+#include "libsandbox.h"
+#include "cgroup.h"
+#include "probes.h"
+
+// Stack size for cloned child
+#define STACK_SIZE (1024 * 1024)
+
+// The child must stay off stdio when the launcher is multi-threaded (batch
+// mode): another thread may hold the stdout lock at the moment of clone().
+#define CHILD_LOG(spec, ...) do { if (!(spec)->quiet && !(spec)->child_quiet) printf(__VA_ARGS__); } while (0)
+
+/**
+ * STRUCTURE:
+ * 1. Setup Resources (RLIMIT)
+ * 2. Isolate (Namespaces) - handled via 'clone' logic
+ * 3. Apply Seccomp
+ * 4. Execve
+ */
+
+// Defaults match the limits the launcher has always applied
+void job_spec_init(job_spec_t *spec) {
+    memset(spec, 0, sizeof(*spec));
+    spec->profile = PROFILE_STRICT;
+    spec->profile_name = "STRICT";
+    policy_default(&spec->policy);
+    spec->limits.memory_mb = 128;
+    spec->limits.nproc = 20;
+    spec->limits.nofile = 64;
+    spec->limits.time_ms = 0;
+    spec->stdin_fd = -1;
+    spec->stdout_fd = -1;
+    spec->stderr_fd = -1;
+    spec->cpuset_mode = CPUSET_NONE;
+    spec->cpuset_cores = 1;
+    spec->sync_fd = -1;
+    spec->sync_wfd = -1;
+    spec->capture_limit = 1024 * 1024;
+    spec->scratch_inodes = 4096;
+}
+
+int job_parse_profile(const char *name, sandbox_profile_t *profile, const char **profile_name) {
+    if (strcmp(name, "STRICT") == 0) {
+        *profile = PROFILE_STRICT;
+        *profile_name = "STRICT";
+    } else if (strcmp(name, "RESOURCE-AWARE") == 0) {
+        *profile = PROFILE_RESOURCE_AWARE;
+        *profile_name = "RESOURCE-AWARE";
+    } else if (strcmp(name, "LEARNING") == 0) {
+        *profile = PROFILE_LEARNING;
+        *profile_name = "LEARNING";
+    } else {
+        return -1;
+    }
+    return 0;
+}
+
+// "shared", "exclusive" or "exclusive:N"
+int job_parse_cpuset(const char *value, cpuset_mode_t *mode, int *cores) {
+    if (strcmp(value, "none") == 0) {
+        *mode = CPUSET_NONE;
+    } else if (strcmp(value, "shared") == 0) {
+        *mode = CPUSET_SHARED;
+    } else if (strncmp(value, "exclusive", 9) == 0) {
+        *mode = CPUSET_EXCLUSIVE;
+        if (value[9] == ':') {
+            *cores = atoi(value + 10);
+            if (*cores <= 0) return -1;
+        } else if (value[9] != '\0') {
+            return -1;
+        }
+    } else {
+        return -1;
+    }
+    return 0;
+}
+
+// "interactive" or "batch"
+int job_parse_priority(const char *value, job_priority_t *priority) {
+    if (strcmp(value, "interactive") == 0) {
+        *priority = PRIORITY_INTERACTIVE;
+    } else if (strcmp(value, "batch") == 0) {
+        *priority = PRIORITY_BATCH;
+    } else {
+        return -1;
+    }
+    return 0;
+}
+
+// A tenant name becomes a directory under sandbox_project/ and a string in
+// logs and reports, so only [A-Za-z0-9_.-] is taken; "", hidden names ("."
+// and ".." included) and names the tenant field would truncate (merging two
+// tenants) are refused
+int job_parse_tenant(const char *value, char *tenant, size_t len) {
+    if (value[0] == '\0' || value[0] == '.' || strlen(value) >= len) return -1;
+    if (value[strspn(value, "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789_.-")] != '\0') return -1;
+    snprintf(tenant, len, "%s", value);
+    return 0;
+}
+
+// -------------------------------------------------------------
+// PREEMPTION (cgroup.freeze)
+// A supervisor freezes a running job to make room for an urgent one and
+// thaws it afterwards. Frozen time is tracked here so job_run can leave it
+// out of the job's runtime, time limit and samples.
+// Without a job cgroup the child gets SIGSTOP/SIGCONT, which only stops the
+// sandbox's init process, not anything it has forked.
+// -------------------------------------------------------------
+
+void job_control_init(job_control_t *ctl) {
+    memset(ctl, 0, sizeof(*ctl));
+    pthread_mutex_init(&ctl->lock, NULL);
+}
+
+int job_freeze(job_control_t *ctl) {
+    int rc = -1;
+    pthread_mutex_lock(&ctl->lock);
+    if (ctl->pid > 0 && !ctl->frozen) {
+        if (ctl->cgroup[0] && cgroup_write_file(ctl->cgroup, "cgroup.freeze", "1") == 0) {
+            rc = 0;
+        } else {
+            rc = kill(ctl->pid, SIGSTOP);
+        }
+        if (rc == 0) {
+            ctl->frozen = 1;
+            ctl->frozen_since_ms = get_current_time_ms();
+        }
+    }
+    pthread_mutex_unlock(&ctl->lock);
+    return rc;
+}
+
+int job_thaw(job_control_t *ctl) {
+    int rc = 0;
+    pthread_mutex_lock(&ctl->lock);
+    if (ctl->frozen) {
+        if (ctl->pid > 0) {
+            if (!(ctl->cgroup[0] && cgroup_write_file(ctl->cgroup, "cgroup.freeze", "0") == 0)) {
+                rc = kill(ctl->pid, SIGCONT);
+            }
+        }
+        ctl->frozen = 0;
+        ctl->frozen_ms += get_current_time_ms() - ctl->frozen_since_ms;
+    }
+    pthread_mutex_unlock(&ctl->lock);
+    return rc;
+}
+
+// Total frozen time so far, including a freeze still in progress
+long job_frozen_ms(job_control_t *ctl) {
+    if (!ctl) return 0;
+    pthread_mutex_lock(&ctl->lock);
+    long total = ctl->frozen_ms;
+    if (ctl->frozen) total += get_current_time_ms() - ctl->frozen_since_ms;
+    pthread_mutex_unlock(&ctl->lock);
+    return total;
+}
+
+static const char *cpuset_mode_name(cpuset_mode_t mode) {
+    switch (mode) {
+        case CPUSET_SHARED: return "shared";
+        case CPUSET_EXCLUSIVE: return "exclusive";
+        default: return "none";
+    }
+}
+
+// Compile a profile's seccomp filter once so many jobs can share it
+int job_compile_filter(sandbox_profile_t profile, struct sock_fprog *prog) {
+    return build_syscall_filter(profile, prog);
+}
+
+// Child process function
+static int child_fn(void *arg) {
+    const job_spec_t *spec = (const job_spec_t *)arg;
+
+    // Wait until the parent has placed us (cgroup, CPU affinity)
+    // Our copy of the write end goes first: if the parent dies before
+    // writing, the read sees EOF instead of waiting on ourselves forever
+    if (spec->sync_fd >= 0) {
+        char go;
+        close(spec->sync_wfd);
+        if (read(spec->sync_fd, &go, 1) != 1) _exit(1);
+        close(spec->sync_fd);
+    }
+    SBX_PROBE(child__setup, "sync");
+
+    // Job output goes to its own files in batch mode (and pipes in a pipeline)
+    if (spec->stdin_fd >= 0) dup2(spec->stdin_fd, STDIN_FILENO);
+    if (spec->stdout_fd >= 0) dup2(spec->stdout_fd, STDOUT_FILENO);
+    if (spec->stderr_fd >= 0) dup2(spec->stderr_fd, STDERR_FILENO);
+
+    CHILD_LOG(spec, "[Sandbox-Child] PID: %d inside new namespace\n", getpid());
+
+    job_enter_sandbox(spec);
+    job_exec(spec);
+    return 1;
+}
+
+// Isolation that a process can set up once and pass on to every fork:
+// private read-only mounts and rlimits. Runs inside the new namespaces.
+void job_enter_sandbox(const job_spec_t *spec) {
+    // -------------------------------------------------------------
+    // F. INTERPROCESS COMMUNICATION (IPC)
+    // Mechanism: IPC Isolation via Namespace
+    // The child is in a new IPC namespace, so it cannot see host semaphores/shm.
+    // -------------------------------------------------------------
+
+    // -------------------------------------------------------------
+    // E. FILE SYSTEM MANAGEMENT
+    // Mechanism: Mount Namespace + Read-Only Root
+    // -------------------------------------------------------------
+    // 1. make mount setting private
+    if (mount(NULL, "/", NULL, MS_PRIVATE | MS_REC, NULL) != 0) {
+        if (!spec->quiet) perror("mount / private");
+    }
+
+    // 2. Remount / as Read-Only
+    // This prevents the untrusted process from modifying ANY file in the system
+    // unless we explicitly mount a writable tmpfs (which we skip for strict sandbox).
+    if (mount(NULL, "/", NULL, MS_REMOUNT | MS_BIND | MS_RDONLY, NULL) != 0) {
+       if (!spec->quiet) perror("mount / read-only");
+       // Non-fatal for demo if unprivileged, but critical for security.
+    } else {
+       CHILD_LOG(spec, "[Sandbox-Child] Filesystem locked (Read-Only Root Enforced).\n");
+    }
+
+    // 3. Writable scratch at /tmp, capped in size and inodes (scratch.c)
+    // A pooled slot is already mounted and only needs binding; otherwise the
+    // child mounts its own tmpfs, which its user namespace allows.
+    // Every slot of the pool, other jobs' /tmp included, was copied into our
+    // mount namespace. Mounts inherited across user namespaces are locked and
+    // cannot be unmounted here, so an empty read-only tmpfs goes over the pool
+    // directory instead; our own slot is reached through an fd opened first.
+    int slot_fd = spec->scratch_path[0] ? open(spec->scratch_path, O_PATH | O_DIRECTORY | O_CLOEXEC) : -1;
+    if (spec->scratch_pool && mount("tmpfs", spec->scratch_pool->dir, "tmpfs",
+                                    MS_RDONLY | MS_NOSUID | MS_NODEV | MS_NOEXEC, "size=4k,nr_inodes=1") != 0) {
+        if (!spec->quiet) perror("mount scratch pool cover");
+        _exit(1);
+    }
+    if (spec->scratch_mb > 0) {
+        char options[64], slot[64];
+        scratch_mount_options(spec->scratch_mb, spec->scratch_inodes, options, sizeof(options));
+        snprintf(slot, sizeof(slot), "/proc/self/fd/%d", slot_fd);
+        int rc = spec->scratch_path[0] ?
+                 (slot_fd >= 0 ? mount(slot, "/tmp", NULL, MS_BIND, NULL) : -1) :
+                 mount("tmpfs", "/tmp", "tmpfs", MS_NOSUID | MS_NODEV, options);
+        if (slot_fd >= 0) close(slot_fd);
+        if (rc != 0) {
+            if (!spec->quiet) perror("mount /tmp scratch");
+        } else {
+            CHILD_LOG(spec, "[Sandbox-Child] Scratch /tmp: %ld MB, %ld inodes%s.\n", spec->scratch_mb,
+                      spec->scratch_inodes, spec->scratch_path[0] ? " (pooled)" : "");
+        }
+        // Own mount: become the ids the parent mapped, now that mounting is done
+        if (!spec->scratch_path[0]) {
+            // Drops root's groups; denied (and nothing to drop) when unprivileged
+            if (setgroups(0, NULL) != 0 && errno != EPERM && !spec->quiet) perror("setgroups");
+            if (setresgid(spec->scratch_gid, spec->scratch_gid, spec->scratch_gid) != 0 ||
+                setresuid(spec->scratch_uid, spec->scratch_uid, spec->scratch_uid) != 0) {
+                // Never run the job as root mapped into the sandbox
+                if (!spec->quiet) perror("scratch ids");
+                _exit(1);
+            }
+        }
+    }
+    SBX_PROBE(child__setup, "mounts");
+
+    // -------------------------------------------------------------
+    // B. MEMORY MANAGEMENT (Soft Limits)
+    // Mechanism: setrlimit() for Stack and Data
+    // Hard limits are enforced by Cgroups v2 in the Python runner (or here if Resource Aware).
+    // -------------------------------------------------------------
+    if (spec->profile == PROFILE_RESOURCE_AWARE) {
+         // Tighter limits or specific ones for Resource Aware
+         CHILD_LOG(spec, "[Sandbox-Child] Applying RESOURCE-AWARE limits...\n");
+    }
+
+    struct rlimit rl;
+    // Limit stack to 8MB
+    rl.rlim_cur = 8 * 1024 * 1024;
+    rl.rlim_max = 8 * 1024 * 1024;
+    setrlimit(RLIMIT_STACK, &rl);
+
+    // Limit File Descriptors
+    rl.rlim_cur = spec->limits.nofile;
+    rl.rlim_max = spec->limits.nofile;
+    setrlimit(RLIMIT_NOFILE, &rl);
+
+    // B. MEMORY MANAGEMENT (Fallback if Cgroups fail)
+    // Limit Address Space (128MB by default).
+    // In soft mode the cgroup's memory.high throttles and reclaims instead,
+    // so a brief spike over budget slows the job rather than failing malloc().
+    if (!spec->mem_soft) {
+        rl.rlim_cur = (rlim_t)spec->limits.memory_mb * 1024 * 1024;
+        rl.rlim_max = (rlim_t)spec->limits.memory_mb * 1024 * 1024;
+        setrlimit(RLIMIT_AS, &rl);
+    } else {
+        CHILD_LOG(spec, "[Sandbox-Child] Soft memory mode: relying on cgroup memory.high/memory.max.\n");
+    }
+
+    // C. PROCESS MANAGEMENT (Fallback)
+    // Limit number of processes (Fork Bomb protection)
+    // Note: In unprivileged UserNS, this limits processes in this namespace.
+    // As the shared nobody, pids.max of the job cgroup does it instead.
+    if (!spec->nproc_cgroup) {
+        rl.rlim_cur = spec->limits.nproc;
+        rl.rlim_max = spec->limits.nproc;
+        setrlimit(RLIMIT_NPROC, &rl);
+    }
+    SBX_PROBE(child__setup, "rlimits");
+}
+
+// Load the precompiled seccomp filter and exec the job; never returns
+void job_exec(const job_spec_t *spec) {
+    // An ignored SIGPIPE (Python, the pipeline relay) would survive execve
+    signal(SIGPIPE, SIG_DFL);
+
+    // -------------------------------------------------------------
+    // D. SYSTEM CALL HANDLING
+    // Mechanism: Seccomp BPF (compiled by the parent, loaded here)
+    // -------------------------------------------------------------
+    CHILD_LOG(spec, "[Sandbox] Loading Seccomp-BPF Profile...\n");
+    if (load_syscall_filter(spec->filter) != 0) {
+        SBX_PROBE(seccomp__load, 0);
+        if (!spec->quiet) perror("seccomp_load");
+        _exit(1);
+    }
+    SBX_PROBE(seccomp__load, 1);
+    CHILD_LOG(spec, "[Sandbox] Seccomp Enforced. System is locked down.\n");
+
+    // -------------------------------------------------------------
+    // C. PROCESS MANAGEMENT
+    // Mechanism: execv()
+    // Replaces the current process image with the untrusted code.
+    // -------------------------------------------------------------
+    CHILD_LOG(spec, "[Sandbox-Child] Executing untrusted binary: %s\n", spec->binary_path);
+    if (!spec->quiet) fflush(stdout);
+    SBX_PROBE(exec, spec->binary_path);
+    execv(spec->binary_path, spec->args);
+
+    // If execv returns, it failed
+    if (!spec->quiet) perror("execv failed");
+    _exit(1);
+}
+
+// Reclaim counters accumulated since launch (baseline subtracted, clamped at 0)
+static void sample_reclaim(const char *cgroup_path, const cgroup_mem_stat_t *base, cgroup_mem_stat_t *delta) {
+    cgroup_mem_stat_t now;
+    if (cgroup_read_mem_stat(cgroup_path, &now) != 0) return;
+
+    delta->pgscan = now.pgscan > base->pgscan ? now.pgscan - base->pgscan : 0;
+    delta->pgsteal = now.pgsteal > base->pgsteal ? now.pgsteal - base->pgsteal : 0;
+    delta->workingset_refault = now.workingset_refault > base->workingset_refault ?
+                                now.workingset_refault - base->workingset_refault : 0;
+    delta->high_events = now.high_events > base->high_events ? now.high_events - base->high_events : 0;
+}
+
+// -------------------------------------------------------------
+// SANDBOX LIFECYCLE (libsandbox.h)
+// sbx_spawn sets up and launches the child, sbx_sample takes one monitoring
+// sample, sbx_wait finishes the job and writes its log. job_run is the
+// whole sequence for callers that just want a result.
+// -------------------------------------------------------------
+
+#define CONTROL_MAX_CLIENTS 8
+#define CAPTURE_PIPE_SIZE (1024 * 1024)     // pipe-max-size for unprivileged users
+#define VERIFY_CHUNK (64 * 1024)
+
+typedef struct {
+    int in;                         // Read end of the child's pipe, -1 = not captured (or at EOF)
+    int out;                        // Capture file
+    int pipe_size;
+    long since_ms;                  // Last drain
+    char path[256];
+    int forward;                    // Caller's stdout_fd: verified output goes on to it whole (-1 = none)
+} capture_stream_t;
+
+typedef struct {
+    int fd;                         // -1 = free slot
+    char buf[256];                  // Partial command line
+    size_t len;
+} control_client_t;
+
+struct sbx_handle {
+    job_spec_t spec;
+    struct sock_fprog own_filter;   // Compiled for this job (spec.filter was NULL)
+    pid_t pid;
+    int pidfd;                      // -1 = no pidfd_open(), poll with waitpid
+    int status;
+    int reaped;
+    int monitor_killed;
+    long start_time;
+    long last_elapsed;
+    int last_cpu;
+    unsigned long long total_ticks;
+    char cgroup_path[512];          // Source of reclaim counters
+    char job_cgroup[512];           // Cgroup the child runs in ("" = ours)
+    int own_cgroup;                 // job_cgroup was created for this job
+    cpu_set_t reserved;
+    int have_reclaim;
+    cgroup_mem_stat_t reclaim_base;
+    telemetry_log_t log_data;
+    char window_path[256];          // Service mode JSONL (see telemetry_flush_window)
+
+    long long collector_ns;         // Time spent in sbx_sample
+    long samples_taken;
+
+    // Control socket (see control_command)
+    long sample_period_ms;
+    int control_fd;                 // Listening, -1 = none
+    char control_path[108];
+    control_client_t clients[CONTROL_MAX_CLIENTS];
+    job_control_t own_control;      // Freeze/thaw for runs without a supervisor's
+
+    capture_stream_t capture[2];    // stdout, stderr (see capture_drain)
+    int devnull;                    // Sink for output past the capture limit
+
+    // Streaming verification of stdout (see capture_read)
+    int verifying;
+    verifier_t verifier;
+    unsigned char *verify_buf;
+
+    // Input (see stdin_feed)
+    int stdin_file;                 // Regular file shared with the child: its offset is what was read
+    int stdin_src;                  // Non-seekable input still being streamed, -1 = none (or at EOF)
+    int stdin_pipe;                 // Our write end of the child's stdin
+    int stdin_probe;                // Our copy of the read end, for the bytes still queued
+    int stdin_wait_in;              // Source had nothing to move: poll it rather than the pipe
+    unsigned long long stdin_fed;
+
+    int scratch_slot;               // Pool slot bound at /tmp, -1 = none
+    char scratch_probe[256];        // Where the sampler finds the job's /tmp
+};
+
+static int control_open(sbx_handle_t *h);
+static int monitor_wait(sbx_handle_t *h, long timeout_ms);
+static int capture_open(sbx_handle_t *h, int child_ends[2]);
+static void capture_start(sbx_handle_t *h);
+static void capture_finish(sbx_handle_t *h);
+static int stdin_open(sbx_handle_t *h);
+static void stdin_feed(sbx_handle_t *h);
+static void stdin_check(sbx_handle_t *h, long elapsed);
+
+void sbx_config_init(sbx_config_t *config) {
+    job_spec_init(config);
+}
+
+int sbx_pidfd(const sbx_handle_t *h) {
+    return h->pidfd;
+}
+
+pid_t sbx_pid(const sbx_handle_t *h) {
+    return h->pid;
+}
+
+static int open_pidfd(pid_t pid) {
+#ifdef SYS_pidfd_open
+    return (int)syscall(SYS_pidfd_open, pid, 0);
+#else
+    (void)pid;
+    return -1;
+#endif
+}
+
+static void free_handle(sbx_handle_t *h) {
+    if (h->pidfd >= 0) close(h->pidfd);
+    if (h->control_fd >= 0) {
+        close(h->control_fd);
+        unlink(h->control_path);
+    }
+    for (int i = 0; i < CONTROL_MAX_CLIENTS; i++) {
+        if (h->clients[i].fd >= 0) close(h->clients[i].fd);
+    }
+    for (int i = 0; i < 2; i++) {
+        if (h->capture[i].in >= 0) close(h->capture[i].in);
+        if (h->capture[i].out >= 0) close(h->capture[i].out);
+    }
+    if (h->devnull >= 0) close(h->devnull);
+    if (h->verifying) verify_close(&h->verifier);
+    free(h->verify_buf);
+    int stdin_fds[4] = { h->stdin_file, h->stdin_src, h->stdin_pipe, h->stdin_probe };
+    for (int i = 0; i < 4; i++) {
+        if (stdin_fds[i] >= 0) close(stdin_fds[i]);
+    }
+    free(h->own_filter.filter);
+    free(h);
+}
+
+static int write_proc(pid_t pid, const char *file, const char *text) {
+    char path[64];
+    snprintf(path, sizeof(path), "/proc/%d/%s", pid, file);
+    int fd = open(path, O_WRONLY | O_CLOEXEC);
+    if (fd < 0) return -1;
+    ssize_t n = write(fd, text, strlen(text));
+    close(fd);
+    return n == (ssize_t)strlen(text) ? 0 : -1;
+}
+
+// The child's user namespace has no uid mapped, and a tmpfs it mounts
+// itself refuses to create files for an unmapped owner: map the ids it is to
+// run as (spec.scratch_uid/gid, see sbx_spawn) before it starts
+static int map_ids(pid_t pid, uid_t uid, gid_t gid) {
+    char map[64];
+    // Unprivileged, gid_map may only be written once setgroups() is denied
+    if (geteuid() != 0 && write_proc(pid, "setgroups", "deny") != 0) return -1;
+    snprintf(map, sizeof(map), "%u %u 1\n", (unsigned)uid, (unsigned)uid);
+    if (write_proc(pid, "uid_map", map) != 0) return -1;
+    snprintf(map, sizeof(map), "%u %u 1\n", (unsigned)gid, (unsigned)gid);
+    return write_proc(pid, "gid_map", map);
+}
+
+// Launch one sandboxed program. Returns NULL if the sandbox could not be created.
+sbx_handle_t *sbx_spawn(const sbx_config_t *config) {
+    sbx_handle_t *h = calloc(1, sizeof(*h));
+    if (!h) {
+        perror("calloc sandbox");
+        return NULL;
+    }
+    h->spec = *config;
+    h->pidfd = -1;
+    h->last_cpu = -1;
+    h->sample_period_ms = SBX_SAMPLE_MS;
+    h->control_fd = -1;
+    for (int i = 0; i < CONTROL_MAX_CLIENTS; i++) h->clients[i].fd = -1;
+    h->capture[0].in = h->capture[0].out = h->capture[1].in = h->capture[1].out = -1;
+    h->capture[0].forward = h->capture[1].forward = -1;
+    h->devnull = -1;
+    h->stdin_file = h->stdin_src = h->stdin_pipe = h->stdin_probe = -1;
+    h->scratch_slot = -1;
+    job_spec_t *spec = &h->spec;
+
+    // freeze/thaw on the control socket need a job_control_t of our own
+    if (spec->control_path && !spec->control) {
+        job_control_init(&h->own_control);
+        spec->control = &h->own_control;
+    }
+
+    if (!spec->filter) {
+        if (build_syscall_filter(spec->profile, &h->own_filter) != 0) {
+            free(h);
+            return NULL;
+        }
+        spec->filter = &h->own_filter;
+    }
+
+    // Ties this run to earlier runs of the same program (see predict.c)
+    if (!spec->binary_hash[0]) predict_hash_file(spec->binary_path, spec->binary_hash, sizeof(spec->binary_hash));
+
+    if (spec->expected_path) {
+        if (verify_open(&h->verifier, spec->expected_path, spec->verify_mode) != 0 ||
+            !(h->verify_buf = malloc(VERIFY_CHUNK))) {
+            perror(spec->expected_path);
+            free_handle(h);
+            return NULL;
+        } else {
+            h->verifying = 1;
+        }
+    }
+
+    if (spec->stdin_path && stdin_open(h) != 0) {
+        perror(spec->stdin_path);
+        free_handle(h);
+        return NULL;
+    }
+
+    // Prepare child stack
+    char *stack = malloc(STACK_SIZE);
+    if (!stack) {
+        perror("malloc stack");
+        free_handle(h);
+        return NULL;
+    }
+
+    // -------------------------------------------------------------
+    // B. MEMORY MANAGEMENT (Soft Limits via memory.high)
+    // The child inherits our cgroup (sandbox.py attaches us before exec),
+    // so reclaim counters of that cgroup describe the sandboxed job.
+    // An embedder may name the job's cgroup instead (spec.cgroup).
+    // -------------------------------------------------------------
+    int have_cgroup;
+    if (spec->cgroup) {
+        snprintf(h->cgroup_path, sizeof(h->cgroup_path), "%s", spec->cgroup);
+        have_cgroup = 1;
+    } else {
+        have_cgroup = (cgroup_path_of(getpid(), h->cgroup_path, sizeof(h->cgroup_path)) == 0);
+    }
+
+    if (spec->mem_soft && !(have_cgroup && cgroup_memory_high_set(h->cgroup_path))) {
+        if (!spec->quiet) {
+            printf("[Sandbox-Parent] WARNING: --mem-soft needs memory.high on our cgroup. Keeping RLIMIT_AS hard cap.\n");
+        }
+        spec->mem_soft = 0;
+    }
+
+    // -------------------------------------------------------------
+    // A. CPU SCHEDULING (Core allocation via cpuset)
+    // Exclusive jobs get cores nothing else runs on; shared jobs are confined
+    // to the shared pool. The mask goes into cpuset.cpus of a per-job cgroup,
+    // and into sched_setaffinity() where cgroup v2 is unavailable.
+    // -------------------------------------------------------------
+    static unsigned long job_seq = 0;
+    cpu_set_t run_on;
+    CPU_ZERO(&run_on);
+    CPU_ZERO(&h->reserved);
+    char cpus[64] = "";
+
+    if (spec->cpuset_mode != CPUSET_NONE && spec->cores) {
+        if (core_allocate(spec->cores, spec->cpuset_mode, spec->cpuset_cores, spec->idle_siblings,
+                          &run_on, &h->reserved) != 0) {
+            if (!spec->quiet) {
+                printf("[Sandbox-Parent] WARNING: exclusive CPUs cannot fit %d core(s). Using the shared pool.\n",
+                       spec->cpuset_cores);
+            }
+            spec->cpuset_mode = CPUSET_SHARED;
+            core_allocate(spec->cores, CPUSET_SHARED, 0, 0, &run_on, &h->reserved);
+        }
+        cpuset_format(&run_on, cpus, sizeof(cpus));
+    }
+
+    // Scratch /tmp: a pooled slot when there is a pool, else the child mounts
+    // one and needs a uid to create files in it under. An unprivileged
+    // launcher can only map its own; root maps nobody and the child switches
+    // to it, since host root mapped into the sandbox would own root's files.
+    spec->scratch_path[0] = '\0';
+    if (spec->scratch_mb > 0 && spec->scratch_pool) {
+        h->scratch_slot = scratch_acquire(spec->scratch_pool, spec->scratch_path, sizeof(spec->scratch_path));
+    }
+    int need_ids = spec->scratch_mb > 0 && h->scratch_slot < 0;
+    spec->scratch_uid = geteuid() == 0 ? SCRATCH_NOBODY : geteuid();
+    spec->scratch_gid = geteuid() == 0 ? SCRATCH_NOBODY : getegid();
+    // Every such job is the same nobody host-wide, so RLIMIT_NPROC (counted
+    // per uid) would be one budget for all of them: the job cgroup's
+    // pids.max takes its place, RLIMIT_NPROC only without a cgroup
+    int shared_uid = need_ids && geteuid() == 0;
+    spec->nproc_cgroup = 0;
+
+    // Per-job cgroup: below the tenant's (sandbox_project/<tenant>/<run>) so
+    // the tenant's cpu.weight, memory.max and pids.max cover the job
+    int place_job = spec->cpuset_mode != CPUSET_NONE || spec->tenant[0] || spec->cgroup || spec->cpu_quota_us > 0 ||
+                    shared_uid;
+    if (spec->cgroup) {
+        // The caller set its limits and removes it afterwards
+        snprintf(h->job_cgroup, sizeof(h->job_cgroup), "%s", spec->cgroup);
+        if (cpus[0]) cgroup_write_file(h->job_cgroup, "cpuset.cpus", cpus);
+    } else if (place_job) {
+        char rel[128];
+        unsigned long seq = __atomic_add_fetch(&job_seq, 1, __ATOMIC_RELAXED);
+        if (spec->tenant[0]) {
+            snprintf(rel, sizeof(rel), SANDBOX_CGROUP_PARENT "/%s/run_%d_%lu", spec->tenant, getpid(), seq);
+        } else {
+            snprintf(rel, sizeof(rel), SANDBOX_CGROUP_PARENT "/run_%d_%lu", getpid(), seq);
+        }
+        if (cgroup_create(rel, h->job_cgroup, sizeof(h->job_cgroup)) == 0) {
+            h->own_cgroup = 1;
+            if (have_cgroup) cgroup_copy_limits(h->cgroup_path, h->job_cgroup);
+            if (spec->cpu_quota_us > 0) {
+                char quota[32];
+                snprintf(quota, sizeof(quota), "%ld 100000", spec->cpu_quota_us);
+                cgroup_write_file(h->job_cgroup, "cpu.max", quota);
+            }
+            if (cpus[0]) cgroup_write_file(h->job_cgroup, "cpuset.cpus", cpus);
+            if (shared_uid) {
+                char pids[32];
+                snprintf(pids, sizeof(pids), "%d", spec->limits.nproc);
+                spec->nproc_cgroup = cgroup_write_file(h->job_cgroup, "pids.max", pids) == 0;
+            }
+            // Reclaim counters now come from the job's own cgroup
+            snprintf(h->cgroup_path, sizeof(h->cgroup_path), "%s", h->job_cgroup);
+            have_cgroup = 1;
+        } else {
+            h->job_cgroup[0] = '\0';
+        }
+
+        if (!spec->quiet && spec->cpuset_mode != CPUSET_NONE) {
+            printf("[Sandbox-Parent] CPU placement: %s on CPUs %s%s\n", cpuset_mode_name(spec->cpuset_mode), cpus,
+                   h->job_cgroup[0] ? "" : " (affinity only, no cgroup v2)");
+        }
+    }
+
+    h->have_reclaim = have_cgroup && cgroup_read_mem_stat(h->cgroup_path, &h->reclaim_base) == 0;
+
+    // The child blocks until it has been moved into its cgroup and pinned
+    int sync_pipe[2] = { -1, -1 };
+    if ((place_job || need_ids) && pipe2(sync_pipe, O_CLOEXEC) == 0) {
+        spec->sync_fd = sync_pipe[0];
+        spec->sync_wfd = sync_pipe[1];
+    }
+
+    // -------------------------------------------------------------
+    // C. PROCESS MANAGEMENT & E. FILESYSTEM
+    // Mechanism: clone() with CLONE_NEW* flags
+    // Creating a new process in new namespaces (PID, IPC, UTS, MOUNT).
+    // SIGCHLD tells the kernel to notify us when child dies.
+    // -------------------------------------------------------------
+    // Note: Creating User Namespaces (CLONE_NEWUSER) allows unprivileged users
+    // to usage other namespaces. Required for WSL2 often.
+
+    int flags = CLONE_NEWNS | CLONE_NEWPID | CLONE_NEWIPC | CLONE_NEWUTS | CLONE_NEWUSER | SIGCHLD;
+
+    // Output capture: the child gets the write ends as stdout/stderr
+    int capture_ends[2] = { -1, -1 };
+    if ((spec->capture_dir || h->verifying) && capture_open(h, capture_ends) != 0 && !spec->quiet) {
+        perror("capture pipe");
+    }
+    spec->child_quiet = h->capture[0].in >= 0;
+
+    if (!spec->quiet) fflush(stdout);
+    h->start_time = get_current_time_ms();
+
+    SBX_PROBE(clone__start);
+    h->pid = clone(child_fn, stack + STACK_SIZE, flags, spec);
+    SBX_PROBE(clone__end, h->pid);
+
+    // Without CLONE_VM the child runs on its own copy of the stack, so ours
+    // can go now rather than live as long as the job
+    free(stack);
+    for (int i = 0; i < 2; i++) {
+        if (capture_ends[i] >= 0) close(capture_ends[i]);
+    }
+
+    if (h->pid == -1) {
+        perror("clone failed");
+        if (sync_pipe[0] >= 0) {
+            close(sync_pipe[0]);
+            close(sync_pipe[1]);
+        }
+        if (h->own_cgroup) cgroup_remove(h->job_cgroup);
+        if (spec->cores) core_release(spec->cores, &h->reserved);
+        if (h->scratch_slot >= 0) scratch_release(spec->scratch_pool, h->scratch_slot);
+        free_handle(h);
+        return NULL;
+    }
+
+    // Nobody else reaps our children, so the pid cannot be reused before this
+    h->pidfd = open_pidfd(h->pid);
+
+    if (sync_pipe[0] >= 0) {
+        close(sync_pipe[0]);
+        if (h->job_cgroup[0] && cgroup_attach(h->job_cgroup, h->pid) != 0 && !spec->quiet) {
+            perror("cgroup attach");
+        }
+        if (spec->cpuset_mode != CPUSET_NONE) sched_setaffinity(h->pid, sizeof(cpu_set_t), &run_on);
+        if (need_ids && map_ids(h->pid, spec->scratch_uid, spec->scratch_gid) != 0 && !spec->quiet) {
+            perror("uid_map");
+        }
+        ssize_t ignored = write(sync_pipe[1], "1", 1);
+        (void)ignored;
+        close(sync_pipe[1]);
+    }
+
+    if (!spec->quiet) printf("[Sandbox-Parent] Child launched with PID: %d\n", h->pid);
+
+    // From here on the supervisor may freeze the job
+    if (spec->control) {
+        pthread_mutex_lock(&spec->control->lock);
+        spec->control->pid = h->pid;
+        snprintf(spec->control->cgroup, sizeof(spec->control->cgroup), "%s", h->job_cgroup);
+        spec->control->frozen = 0;
+        spec->control->frozen_ms = 0;
+        pthread_mutex_unlock(&spec->control->lock);
+    }
+
+    telemetry_log_t *log_data = &h->log_data;
+    log_data->program_name = spec->binary_path;
+    log_data->profile_name = spec->profile_name;
+    log_data->memory_mode = spec->mem_soft ? "soft" : "hard";
+    log_data->policy_name = (spec->profile == PROFILE_LEARNING) ? spec->policy.name : NULL;
+    log_data->quiet = spec->quiet;
+    log_data->cpuset_mode = cpuset_mode_name(spec->cpuset_mode);
+    snprintf(log_data->cpuset_cpus, sizeof(log_data->cpuset_cpus), "%s", cpus);
+    log_data->queue_wait_ms = spec->queue_wait_ms;
+    log_data->tenant = spec->tenant[0] ? spec->tenant : NULL;
+    log_data->priority = spec->priority == PRIORITY_INTERACTIVE ? "interactive" : "batch";
+    log_data->binary_hash = spec->binary_hash;
+    log_data->pred_samples = spec->prediction.samples;
+    log_data->pred_quantile = spec->prediction.quantile;
+    log_data->pred_cpu_percent = spec->prediction.cpu_percent;
+    log_data->pred_rss_kb = spec->prediction.peak_rss_kb;
+    log_data->pred_runtime_ms = spec->prediction.runtime_ms;
+    if (spec->scratch_mb > 0) {
+        log_data->scratch_mode = h->scratch_slot >= 0 ? "pool" : "mount";
+        log_data->scratch_mb = spec->scratch_mb;
+        log_data->scratch_inodes = spec->scratch_inodes;
+        // A pool slot is visible from here; an own mount only through the child's root
+        if (h->scratch_slot >= 0) {
+            snprintf(h->scratch_probe, sizeof(h->scratch_probe), "%s", spec->scratch_path);
+        } else {
+            snprintf(h->scratch_probe, sizeof(h->scratch_probe), "/proc/%d/root/tmp", h->pid);
+        }
+    }
+    if (spec->window_ms > 0) {
+        snprintf(h->window_path, sizeof(h->window_path), "logs/service_%d_%ld.jsonl", h->pid, (long)time(NULL));
+        log_data->window_path = h->window_path;
+        log_data->window_ms = spec->window_ms;
+        if (!spec->quiet) printf("[Sandbox-Parent] Service mode: telemetry windows every %lds -> %s\n",
+                                 spec->window_ms / 1000, h->window_path);
+    }
+    if (spec->control_path && control_open(h) == 0) {
+        log_data->control_path = h->control_path;
+        if (!spec->quiet) {
+            printf("[Sandbox-Parent] Control socket: %s\n", h->control_path);
+        } else {
+            // Batch and daemon jobs are quiet; the socket is only useful while the job runs
+            fprintf(stderr, "[Sandbox-Parent] Job %s (pid %d) control socket: %s\n",
+                    spec->id[0] ? spec->id : spec->binary_path, h->pid, h->control_path);
+        }
+    }
+    if (h->capture[0].in >= 0 || h->capture[1].in >= 0) {
+        capture_start(h);
+        if (!spec->quiet && spec->capture_dir) {
+            printf("[Sandbox-Parent] Capturing output to %s/run_%d.{stdout,stderr} (limit %ld bytes)\n",
+                   spec->capture_dir, h->pid, spec->capture_limit);
+        }
+        if (!spec->quiet && h->verifying) {
+            printf("[Sandbox-Parent] Verifying stdout against %s (%s)%s\n", spec->expected_path,
+                   verify_mode_name(spec->verify_mode), spec->verify_kill ? ", killing at the first mismatch" : "");
+        }
+    }
+    return h;
+}
+
+// Wait up to timeout_ms for the child to exit (-1 = forever).
+// Returns 1 once it has exited (and is reaped), 0 if still running.
+int sbx_poll(sbx_handle_t *h, int timeout_ms) {
+    if (h->reaped) return 1;
+
+    int waited = 0;
+    if (h->control_fd >= 0 || h->capture[0].in >= 0 || h->capture[1].in >= 0 || h->stdin_src >= 0) {
+        // Serve the control socket, drain captured output and feed input meanwhile
+        if (!monitor_wait(h, timeout_ms)) return 0;
+        waited = 1;
+    } else if (h->pidfd >= 0) {
+        struct pollfd pfd = { h->pidfd, POLLIN, 0 };
+        if (poll(&pfd, 1, timeout_ms) <= 0) return 0;
+    }
+
+    pid_t wait_result = waitpid(h->pid, &h->status, WNOHANG);
+    if (wait_result == 0 && h->pidfd < 0 && !waited) {
+        usleep(timeout_ms >= 0 ? timeout_ms * 1000 : SBX_SAMPLE_MS * 1000);
+        wait_result = waitpid(h->pid, &h->status, WNOHANG);
+    }
+    if (wait_result == -1) perror("waitpid");
+    if (wait_result != 0) h->reaped = 1;
+    return h->reaped;
+}
+
+// -------------------------------------------------------------
+// H. TIME MANAGEMENT & TELEMETRY
+// Mechanism: /proc sampling while the child runs
+// Takes one sample (copied to 'out' if given) and enforces the policy and
+// time limit. Returns 0 with a sample, 1 if the job has ended.
+// -------------------------------------------------------------
+static int sample_once(sbx_handle_t *h, telemetry_sample_t *out) {
+    if (h->reaped) return 1;
+
+    pid_t wait_result = waitpid(h->pid, &h->status, WNOHANG);
+    if (wait_result != 0) {
+        if (wait_result == -1) perror("waitpid");
+        h->reaped = 1;
+        return 1;
+    }
+
+    job_spec_t *spec = &h->spec;
+    telemetry_log_t *log_data = &h->log_data;
+    pid_t child_pid = h->pid;
+
+    // Child still running, collect metrics
+    long current_mem = 0, current_rss = 0, resident_kb = 0;
+    get_memory_peaks(child_pid, &current_mem, &current_rss, &resident_kb);
+    if (current_mem > log_data->memory_peak_kb) {
+        log_data->memory_peak_kb = current_mem;
+    }
+    if (current_rss > log_data->peak_rss_kb) {
+        log_data->peak_rss_kb = current_rss;
+    }
+
+    // Capure CPU ticks and Faults
+    unsigned long minflt = 0, majflt = 0;
+    unsigned long long current_ticks = get_process_metrics(child_pid, &minflt, &majflt);
+    if (current_ticks > h->total_ticks) {
+        h->total_ticks = current_ticks;
+    }
+    // Update faults (they are cumulative in stat, so just take latest)
+    log_data->minflt = minflt;
+    log_data->majflt = majflt;
+
+    // Add time-series sample (time spent frozen does not count)
+    long elapsed = get_current_time_ms() - h->start_time - job_frozen_ms(spec->control);
+    double cpu_seconds = (double)current_ticks / sysconf(_SC_CLK_TCK);
+    double wall_seconds = (double)elapsed / 1000.0;
+    int current_cpu_percent = (wall_seconds > 0) ? (int)((cpu_seconds / wall_seconds) * 100.0) : 0;
+
+    // Reclaim cost so far (memory.high throttling)
+    if (h->have_reclaim) {
+        sample_reclaim(h->cgroup_path, &h->reclaim_base, &log_data->reclaim_total);
+    }
+
+    telemetry_sample_t sample = {0};
+    sample.time_ms = elapsed;
+    sample.cpu_percent = current_cpu_percent;
+    sample.cpu_time_ms = (long)(current_ticks * 1000 / sysconf(_SC_CLK_TCK));
+    sample.majflt = majflt;
+    sample.memory_kb = current_mem;
+    sample.reclaim = log_data->reclaim_total;
+
+    // Migrations: the scheduler's own counter, or observed CPU changes
+    sample.cpu = get_process_cpu(child_pid);
+    long migrations = get_migrations(child_pid);
+    if (migrations >= 0) {
+        log_data->migrations = (unsigned long)migrations;
+    } else if (h->last_cpu >= 0 && sample.cpu >= 0 && sample.cpu != h->last_cpu) {
+        log_data->migrations++;
+    }
+    if (sample.cpu >= 0) h->last_cpu = sample.cpu;
+    sample.migrations = log_data->migrations;
+    if (log_data->scratch_mode) {
+        long used_inodes = 0;
+        if (scratch_usage(h->scratch_probe, spec->scratch_mb, &sample.scratch_kb, &used_inodes) == 0) {
+            if (sample.scratch_kb > log_data->scratch_peak_kb) log_data->scratch_peak_kb = sample.scratch_kb;
+            if (used_inodes > log_data->scratch_peak_inodes) log_data->scratch_peak_inodes = used_inodes;
+        }
+    }
+    if (log_data->stdin_path) stdin_check(h, elapsed);
+    add_sample(log_data, &sample);
+    SBX_PROBE(sample, child_pid, sample.time_ms, sample.cpu_percent, sample.cpu_time_ms,
+              sample.memory_kb, sample.majflt);
+    if (spec->on_sample) spec->on_sample(spec->sample_ctx, &sample);
+    if (out) *out = sample;
+
+    // Memory integral for tenant accounting (GB-seconds) over what is resident
+    // now: the job's own cgroup covers its children too, else the child's VmRSS
+    char current[32];
+    if (h->own_cgroup && cgroup_read_file(h->job_cgroup, "memory.current", current, sizeof(current)) == 0) {
+        resident_kb = (long)(strtoull(current, NULL, 10) / 1024);
+    }
+    log_data->mem_gb_seconds += (double)resident_kb / (1024.0 * 1024.0) * (elapsed - h->last_elapsed) / 1000.0;
+    h->last_elapsed = elapsed;
+
+    // -------------------------------------------------------------
+    // DYNAMIC POLICY ADAPTATION (Phase 5)
+    // OS Concept: Runtime Enforcement based on Behavioral Analysis
+    // Thresholds live in policy.c so policy-sim replays identical logic.
+    // -------------------------------------------------------------
+    if (spec->profile == PROFILE_LEARNING) {
+        policy_input_t input = { sample.time_ms, sample.cpu_time_ms, sample.majflt, sample.memory_kb };
+        const char *reason = policy_kill_reason(&spec->policy, &input);
+        SBX_PROBE(policy__decision, child_pid, reason != NULL, reason ? reason : "");
+
+        if (reason) {
+             if (!spec->quiet) {
+                 printf("\n[Sandbox-Monitor] ⚠️ RISK DETECTED in Learning Mode!\n");
+                 printf("[Sandbox-Monitor] Reason: %s threshold of policy '%s' exceeded (%ld ms CPU, %lu faults).\n",
+                        reason, spec->policy.name, sample.cpu_time_ms, majflt);
+                 printf("[Sandbox-Monitor] 🔄 ADAPTING POLICY: Switching to STRICT enforcement (Terminating Process)...\n");
+             }
+
+             kill(child_pid, SIGKILL);
+             h->monitor_killed = 1;
+
+             snprintf(log_data->exit_reason, sizeof(log_data->exit_reason), "POLICY_ADAPATION_KILL");
+        }
+    }
+
+    // H. TIME MANAGEMENT: wall-clock limit
+    if (!h->monitor_killed && spec->limits.time_ms > 0 && elapsed > spec->limits.time_ms) {
+        if (!spec->quiet) printf("[Sandbox-Monitor] Time limit (%ld ms) exceeded. Terminating...\n", spec->limits.time_ms);
+        kill(child_pid, SIGKILL);
+        h->monitor_killed = 1;
+        snprintf(log_data->exit_reason, sizeof(log_data->exit_reason), "TIME_LIMIT_EXCEEDED");
+    }
+
+    if (h->monitor_killed) {
+        // Reap the child; the kill reason above takes precedence
+        waitpid(child_pid, &h->status, 0);
+        h->reaped = 1;
+    }
+    return 0;
+}
+
+// Collector cost is accounted per job (result.collector_us)
+int sbx_sample(sbx_handle_t *h, telemetry_sample_t *out) {
+    if (h->reaped) return 1;
+    struct timespec t0, t1;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    int rc = sample_once(h, out);
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    h->collector_ns += (t1.tv_sec - t0.tv_sec) * 1000000000LL + (t1.tv_nsec - t0.tv_nsec);
+    if (rc == 0) h->samples_taken++;
+    return rc;
+}
+
+// -------------------------------------------------------------
+// CONTROL SOCKET (spec.control_path)
+// A Unix stream socket per run, served between samples by sbx_poll: one
+// command per line, one JSON object per reply.
+//   snapshot              state, limits and the timeline so far
+//   period MS             sample period (10..10000 ms)
+//   freeze | thaw         cgroup.freeze, or SIGSTOP/SIGCONT without a job cgroup
+//   limit KEY=VALUE       time_ms, memory_mb, nofile, nproc
+//   kill                  SIGKILL, exit_reason KILLED_BY_CONTROL
+// Clients are non-blocking; one that can't take a whole reply is dropped
+// rather than stalling the sampling loop.
+// -------------------------------------------------------------
+
+// spec.control_path with every %d replaced by the sandbox pid ("%%" is a
+// literal '%'), so the jobs of one batch or daemon each get their own socket
+static int control_expand(const char *template, pid_t pid, char *out, size_t len) {
+    size_t n = 0;
+    for (const char *p = template; *p; p++) {
+        char pid_str[16];
+        const char *piece = p;
+        size_t piece_len = 1;
+        if (p[0] == '%' && p[1] == 'd') {
+            piece_len = snprintf(pid_str, sizeof(pid_str), "%d", pid);
+            piece = pid_str;
+            p++;
+        } else if (p[0] == '%' && p[1] == '%') {
+            p++;
+        }
+        if (n + piece_len >= len) return -1;
+        memcpy(out + n, piece, piece_len);
+        n += piece_len;
+    }
+    out[n] = '\0';
+    return 0;
+}
+
+static int control_open(sbx_handle_t *h) {
+    const char *template = h->spec.control_path[0] ? h->spec.control_path : "logs/control_%d.sock";
+    if (control_expand(template, h->pid, h->control_path, sizeof(h->control_path)) != 0) {
+        fprintf(stderr, "[Sandbox-Parent] Control socket path too long: %s\n", template);
+        return -1;
+    }
+
+    struct sockaddr_un addr = {0};
+    addr.sun_family = AF_UNIX;
+    snprintf(addr.sun_path, sizeof(addr.sun_path), "%s", h->control_path);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0);
+    if (fd < 0) {
+        perror("control socket");
+        return -1;
+    }
+    unlink(h->control_path);
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 || listen(fd, CONTROL_MAX_CLIENTS) != 0) {
+        perror(h->control_path);
+        close(fd);
+        return -1;
+    }
+    // Whoever can talk to it can kill the job
+    chmod(h->control_path, 0600);
+    h->control_fd = fd;
+    return 0;
+}
+
+static void control_reply(control_client_t *c, char *reply, size_t len) {
+    if (send(c->fd, reply, len, MSG_DONTWAIT | MSG_NOSIGNAL) != (ssize_t)len) {
+        close(c->fd);
+        c->fd = -1;
+    }
+}
+
+static void control_snapshot(sbx_handle_t *h, FILE *out) {
+    const job_spec_t *spec = &h->spec;
+    const telemetry_log_t *log = &h->log_data;
+    char program[JSON_STR_MAX];
+
+    // A supervisor thread freezes and thaws the job: read its state in one go
+    job_control_t *ctl = spec->control;
+    pthread_mutex_lock(&ctl->lock);
+    long now = get_current_time_ms();
+    int frozen = ctl->frozen;
+    long frozen_ms = ctl->frozen_ms + (frozen ? now - ctl->frozen_since_ms : 0);
+    pthread_mutex_unlock(&ctl->lock);
+    long elapsed = now - h->start_time - frozen_ms;
+
+    fprintf(out, "{\"ok\": true, \"pid\": %d, \"program\": \"%s\", \"profile\": \"%s\", \"elapsed_ms\": %ld, "
+                 "\"sample_period_ms\": %ld, \"frozen\": %s, \"frozen_ms\": %ld, \"memory_peak_kb\": %ld, ",
+            h->pid, json_escape(spec->binary_path, program, sizeof(program)), spec->profile_name, elapsed, h->sample_period_ms,
+            frozen ? "true" : "false", frozen_ms, log->memory_peak_kb);
+    fprintf(out, "\"limits\": {\"time_ms\": %ld, \"memory_mb\": %ld, \"nofile\": %d, \"nproc\": %d}, ",
+            spec->limits.time_ms, spec->limits.memory_mb, spec->limits.nofile, spec->limits.nproc);
+
+    const char *names[] = { "time_ms", "cpu_percent", "cpu_time_ms", "memory_kb" };
+    fprintf(out, "\"samples\": %d, \"timeline\": {", log->sample_count);
+    for (int field = 0; field < 4; field++) {
+        fprintf(out, "%s\"%s\": [", field ? ", " : "", names[field]);
+        for (int i = 0; i < log->sample_count; i++) {
+            const telemetry_sample_t *s = telemetry_sample_at(log, i);
+            long v = field == 0 ? s->time_ms : field == 1 ? s->cpu_percent : field == 2 ? s->cpu_time_ms : s->memory_kb;
+            fprintf(out, "%ld%s", v, i < log->sample_count - 1 ? "," : "");
+        }
+        fprintf(out, "]");
+    }
+    fprintf(out, "}}\n");
+}
+
+// rlimits apply to the sandbox's init process (the job itself), not to
+// anything it has already forked
+static int control_limit(sbx_handle_t *h, const char *key, long value, FILE *out) {
+    job_spec_t *spec = &h->spec;
+    struct rlimit rl = { (rlim_t)value, (rlim_t)value };
+    int rc = 0;
+
+    if (value <= 0) {
+        rc = -1;
+    } else if (strcmp(key, "time_ms") == 0) {
+        spec->limits.time_ms = value;
+    } else if (strcmp(key, "memory_mb") == 0) {
+        rl.rlim_cur = rl.rlim_max = (rlim_t)value * 1024 * 1024;
+        if (!spec->mem_soft) rc = prlimit(h->pid, RLIMIT_AS, &rl, NULL);
+        if (rc == 0 && h->own_cgroup) {
+            char bytes[32];
+            snprintf(bytes, sizeof(bytes), "%ld", value * 1024 * 1024);
+            cgroup_write_file(h->job_cgroup, "memory.max", bytes);
+        }
+        if (rc == 0) spec->limits.memory_mb = value;
+    } else if (strcmp(key, "nofile") == 0) {
+        rc = prlimit(h->pid, RLIMIT_NOFILE, &rl, NULL);
+        if (rc == 0) spec->limits.nofile = (int)value;
+    } else if (strcmp(key, "nproc") == 0) {
+        if (spec->nproc_cgroup) {
+            char pids[32];
+            snprintf(pids, sizeof(pids), "%ld", value);
+            rc = cgroup_write_file(h->job_cgroup, "pids.max", pids);
+        } else {
+            rc = prlimit(h->pid, RLIMIT_NPROC, &rl, NULL);
+        }
+        if (rc == 0) spec->limits.nproc = (int)value;
+    } else {
+        fprintf(out, "{\"ok\": false, \"error\": \"unknown limit %s\"}\n", key);
+        return -1;
+    }
+
+    if (rc != 0) {
+        fprintf(out, "{\"ok\": false, \"error\": \"%s=%ld: %s\"}\n", key, value,
+                value <= 0 ? "must be positive" : strerror(errno));
+    } else {
+        fprintf(out, "{\"ok\": true, \"%s\": %ld}\n", key, value);
+    }
+    return rc;
+}
+
+static void control_command(sbx_handle_t *h, control_client_t *c, char *line) {
+    char *reply = NULL;
+    size_t len = 0;
+    FILE *out = open_memstream(&reply, &len);
+    if (!out) return;
+
+    char cmd[32] = "", arg[64] = "";
+    sscanf(line, "%31s %63s", cmd, arg);
+    job_spec_t *spec = &h->spec;
+
+    if (strcmp(cmd, "snapshot") == 0) {
+        control_snapshot(h, out);
+    } else if (strcmp(cmd, "period") == 0) {
+        long ms = atol(arg);
+        if (ms >= 10 && ms <= 10000) {
+            h->sample_period_ms = ms;
+            fprintf(out, "{\"ok\": true, \"sample_period_ms\": %ld}\n", ms);
+        } else {
+            fprintf(out, "{\"ok\": false, \"error\": \"period must be 10..10000 ms\"}\n");
+        }
+    } else if (strcmp(cmd, "freeze") == 0 || strcmp(cmd, "thaw") == 0) {
+        int freeze = cmd[0] == 'f';
+        if ((freeze ? job_freeze(spec->control) : job_thaw(spec->control)) == 0) {
+            fprintf(out, "{\"ok\": true, \"frozen\": %s}\n", freeze ? "true" : "false");
+        } else {
+            fprintf(out, "{\"ok\": false, \"error\": \"%s failed (already %s?)\"}\n", cmd,
+                    freeze ? "frozen" : "thawed");
+        }
+    } else if (strcmp(cmd, "limit") == 0) {
+        char *eq = strchr(arg, '=');
+        if (eq) {
+            *eq = '\0';
+            control_limit(h, arg, atol(eq + 1), out);
+        } else {
+            fprintf(out, "{\"ok\": false, \"error\": \"usage: limit KEY=VALUE\"}\n");
+        }
+    } else if (strcmp(cmd, "kill") == 0) {
+        // Thaw first so a frozen job can take the signal
+        job_thaw(spec->control);
+        kill(h->pid, SIGKILL);
+        h->monitor_killed = 1;
+        snprintf(h->log_data.exit_reason, sizeof(h->log_data.exit_reason), "KILLED_BY_CONTROL");
+        if (!spec->quiet) printf("[Sandbox-Monitor] Killed through the control socket.\n");
+        fprintf(out, "{\"ok\": true}\n");
+    } else {
+        fprintf(out, "{\"ok\": false, \"error\": \"unknown command '%s'\"}\n", cmd);
+    }
+
+    fclose(out);
+    control_reply(c, reply, len);
+    free(reply);
+}
+
+static void control_read(sbx_handle_t *h, control_client_t *c) {
+    ssize_t got = recv(c->fd, c->buf + c->len, sizeof(c->buf) - 1 - c->len, MSG_DONTWAIT);
+    if (got <= 0) {
+        if (got < 0 && (errno == EAGAIN || errno == EINTR)) return;
+        close(c->fd);
+        c->fd = -1;
+        return;
+    }
+    c->len += got;
+    c->buf[c->len] = '\0';
+
+    char *line = c->buf, *nl;
+    while (c->fd >= 0 && (nl = strchr(line, '\n')) != NULL) {
+        *nl = '\0';
+        control_command(h, c, line);
+        line = nl + 1;
+    }
+    if (c->fd < 0) return;
+    c->len = strlen(line);
+    memmove(c->buf, line, c->len + 1);
+    if (c->len == sizeof(c->buf) - 1) {
+        // No newline in a full buffer: not a client of ours
+        close(c->fd);
+        c->fd = -1;
+    }
+}
+
+// -------------------------------------------------------------
+// OUTPUT CAPTURE (spec.capture_dir)
+// stdout/stderr the caller left to inherit become pipes that the monitor
+// drains with splice() into DIR/run_<pid>.stdout and .stderr, so output
+// never passes through our memory however much the job writes. Past
+// spec.capture_limit bytes a stream is still drained (the job must not
+// block on a full pipe) but spliced into /dev/null, and the file gets a
+// truncation marker at the end. A drain that finds the pipe full adds the
+// time since the previous drain to throttle_ms: the job was (at most that
+// long) blocked writing faster than we could move its output.
+// -------------------------------------------------------------
+
+static int capture_open(sbx_handle_t *h, int child_ends[2]) {
+    job_spec_t *spec = &h->spec;
+    int *fds[2] = { &spec->stdout_fd, &spec->stderr_fd };
+
+    h->devnull = open("/dev/null", O_WRONLY | O_CLOEXEC);
+    if (h->devnull < 0) return -1;
+    for (int i = 0; i < 2; i++) {
+        // The caller redirected this one: it is not captured, but verified
+        // stdout still has to pass through us on its way there
+        if (*fds[i] >= 0 && !(i == 0 && h->verifying)) continue;
+        if (i == 1 && !spec->capture_dir) continue;     // Only verifying stdout
+        int p[2];
+        if (pipe2(p, O_CLOEXEC) != 0) return -1;
+        fcntl(p[0], F_SETFL, O_NONBLOCK);
+        fcntl(p[1], F_SETPIPE_SZ, CAPTURE_PIPE_SIZE);
+        h->capture[i].in = p[0];
+        h->capture[i].forward = *fds[i];
+        h->capture[i].pipe_size = fcntl(p[1], F_GETPIPE_SZ);
+        child_ends[i] = p[1];
+        *fds[i] = p[1];
+    }
+    return 0;
+}
+
+// Output files are named after the child, so they are opened once it exists
+static void capture_start(sbx_handle_t *h) {
+    const char *suffix[2] = { "stdout", "stderr" };
+    telemetry_log_t *log_data = &h->log_data;
+    log_data->capture_limit = h->spec.capture_limit;
+
+    for (int i = 0; i < 2; i++) {
+        capture_stream_t *c = &h->capture[i];
+        if (c->in < 0) continue;
+        c->since_ms = h->start_time;
+        if (!h->spec.capture_dir || c->forward >= 0) continue;     // Verified, not kept
+        snprintf(c->path, sizeof(c->path), "%s/run_%d.%s", h->spec.capture_dir, h->pid, suffix[i]);
+        c->out = open(c->path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (c->out < 0) {
+            // Still drained, so the job does not block on a pipe nobody reads
+            if (!h->spec.quiet) perror(c->path);
+            c->path[0] = '\0';
+            continue;
+        }
+        log_data->capture[i].path = c->path;
+    }
+}
+
+// First mismatch while the job runs: with spec.verify_kill there is no
+// point in letting it finish
+static void verify_failed(sbx_handle_t *h) {
+    if (!h->spec.verify_kill || h->monitor_killed || h->reaped) return;
+    if (!h->spec.quiet) {
+        printf("[Sandbox-Monitor] Output differs from %s at byte %lld. Terminating...\n",
+               h->spec.expected_path, h->verifier.mismatch);
+    }
+    kill(h->pid, SIGKILL);
+    h->monitor_killed = 1;
+    snprintf(h->log_data.exit_reason, sizeof(h->log_data.exit_reason), "WRONG_ANSWER");
+}
+
+static void verify_done(sbx_handle_t *h) {
+    telemetry_log_t *log_data = &h->log_data;
+    int ok = verify_finish(&h->verifier) == 0;
+    log_data->expected_path = h->spec.expected_path;
+    log_data->verify_mode = verify_mode_name(h->verifier.mode);
+    log_data->verdict = ok ? "ACCEPTED" : "WRONG_ANSWER";
+    log_data->mismatch_offset = h->verifier.mismatch;
+    log_data->verified_bytes = h->verifier.offset;
+    if (!h->spec.quiet) {
+        if (ok) {
+            printf("[Sandbox-Parent] Verdict: ACCEPTED (%llu bytes)\n", h->verifier.offset);
+        } else {
+            printf("[Sandbox-Parent] Verdict: WRONG_ANSWER (first difference at byte %lld)\n", h->verifier.mismatch);
+        }
+    }
+}
+
+// All of buf to the caller's fd. It is a file in batch and cached runs; a
+// pipe whose reader stalls stalls us with it, as it would stall the job.
+static void forward_output(int fd, const unsigned char *buf, size_t len) {
+    while (len > 0) {
+        ssize_t n = write(fd, buf, len);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return;     // Reader gone: the job's own write would have failed too
+        buf += n;
+        len -= n;
+    }
+}
+
+// Verified stdout has to be looked at, so it is read rather than spliced;
+// kept output (capture_dir) or the caller's stdout_fd gets it from the same
+// buffer
+static void capture_read(sbx_handle_t *h) {
+    capture_stream_t *c = &h->capture[0];
+    telemetry_capture_t *stats = &h->log_data.capture[0];
+    long limit = h->spec.capture_limit;
+
+    for (;;) {
+        ssize_t n = read(c->in, h->verify_buf, VERIFY_CHUNK);
+        if (n > 0) {
+            if (h->verifier.mismatch < 0 && verify_feed(&h->verifier, h->verify_buf, n) != 0) verify_failed(h);
+            if (c->forward >= 0) forward_output(c->forward, h->verify_buf, n);
+            if (c->out < 0) continue;
+            size_t keep = n;
+            if (limit > 0) {
+                unsigned long long room = stats->bytes < (unsigned long long)limit ? limit - stats->bytes : 0;
+                if (keep > room) keep = room;
+            }
+            if (keep > 0 && write(c->out, h->verify_buf, keep) == (ssize_t)keep) stats->bytes += keep;
+            stats->dropped += n - keep;
+            continue;
+        }
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && errno == EAGAIN) return;
+        close(c->in);
+        c->in = -1;
+        return;
+    }
+}
+
+// Move everything queued without blocking; closes the stream at EOF
+static void capture_drain(sbx_handle_t *h, int i) {
+    capture_stream_t *c = &h->capture[i];
+    telemetry_capture_t *stats = &h->log_data.capture[i];
+    long limit = h->spec.capture_limit;
+    long now = get_current_time_ms();
+
+    int queued = 0;
+    if (ioctl(c->in, FIONREAD, &queued) == 0 && queued >= c->pipe_size) {
+        stats->throttle_ms += now - c->since_ms;
+    }
+    c->since_ms = now;
+
+    if (i == 0 && h->verifying) {
+        capture_read(h);
+        return;
+    }
+
+    for (;;) {
+        size_t len = c->pipe_size;
+        int to = c->out >= 0 ? c->out : h->devnull;
+        if (limit > 0 && stats->bytes >= (unsigned long long)limit) {
+            to = h->devnull;
+        } else if (limit > 0 && stats->bytes + len > (unsigned long long)limit) {
+            len = limit - stats->bytes;
+        }
+
+        ssize_t n = splice(c->in, NULL, to, NULL, len, SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+        if (n > 0) {
+            if (to == c->out) {
+                stats->bytes += n;
+            } else {
+                stats->dropped += n;
+            }
+            continue;
+        }
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && errno == EAGAIN) return;
+        // EOF: every process holding the write end is gone
+        close(c->in);
+        c->in = -1;
+        return;
+    }
+}
+
+static void capture_finish(sbx_handle_t *h) {
+    for (int i = 0; i < 2; i++) {
+        capture_stream_t *c = &h->capture[i];
+        if (c->in >= 0) capture_drain(h, i);
+        if (c->in >= 0) {
+            // A write end outlived the namespace (passed to another process?)
+            close(c->in);
+            c->in = -1;
+        }
+        if (i == 0 && h->verifying) verify_done(h);
+        if (c->out < 0) continue;
+        const telemetry_capture_t *stats = &h->log_data.capture[i];
+        if (stats->dropped > 0) {
+            dprintf(c->out, "\n[sandbox: output truncated at %llu bytes, %llu more dropped]\n",
+                    stats->bytes, stats->dropped);
+        }
+        close(c->out);
+        c->out = -1;
+    }
+}
+
+// -------------------------------------------------------------
+// INPUT (spec.stdin_path)
+// A regular file (memfds included, as /proc/self/fd/N) is opened and
+// handed to the child as is: nothing is copied, and since we share the
+// open file its offset tells us how much the job has read. Anything else
+// (a FIFO, a character device) is streamed into a pipe with splice(). The
+// job has consumed its input once the offset reaches the size, or the
+// source is at EOF and the pipe is empty; both are checked with every
+// sample, so consumed_ms has the sampling period as its resolution.
+// -------------------------------------------------------------
+
+static int stdin_open(sbx_handle_t *h) {
+    job_spec_t *spec = &h->spec;
+    telemetry_log_t *log_data = &h->log_data;
+    int fd = open(spec->stdin_path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return -1;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return -1;
+    }
+    log_data->stdin_path = spec->stdin_path;
+    log_data->stdin_consumed_ms = -1;
+
+    if (S_ISREG(st.st_mode)) {
+        h->stdin_file = fd;
+        spec->stdin_fd = fd;
+        log_data->stdin_mode = "file";
+        log_data->stdin_size = st.st_size;
+        return 0;
+    }
+
+    int p[2];
+    if (pipe2(p, O_CLOEXEC) != 0) {
+        close(fd);
+        return -1;
+    }
+    fcntl(p[1], F_SETFL, O_NONBLOCK);
+    fcntl(p[1], F_SETPIPE_SZ, CAPTURE_PIPE_SIZE);
+    h->stdin_src = fd;
+    h->stdin_pipe = p[1];
+    h->stdin_probe = p[0];
+    spec->stdin_fd = p[0];
+    log_data->stdin_mode = "pipe";
+    log_data->stdin_size = -1;
+    return 0;
+}
+
+static void stdin_close_feed(sbx_handle_t *h) {
+    close(h->stdin_src);
+    close(h->stdin_pipe);
+    h->stdin_src = h->stdin_pipe = -1;
+}
+
+// Move what can move without blocking, then note which side we wait on
+static void stdin_feed(sbx_handle_t *h) {
+    for (;;) {
+        ssize_t n = splice(h->stdin_src, NULL, h->stdin_pipe, NULL, CAPTURE_PIPE_SIZE,
+                           SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+        if (n > 0) {
+            h->stdin_fed += n;
+            continue;
+        }
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && errno == EAGAIN) {
+            int available = 0;
+            h->stdin_wait_in = ioctl(h->stdin_src, FIONREAD, &available) == 0 && available == 0;
+            return;
+        }
+        // EOF: the job sees it once the pipe runs dry
+        if (n < 0 && !h->spec.quiet) perror("stdin splice");
+        stdin_close_feed(h);
+        return;
+    }
+}
+
+static void stdin_check(sbx_handle_t *h, long elapsed) {
+    telemetry_log_t *log_data = &h->log_data;
+    int done;
+    if (h->stdin_file >= 0) {
+        off_t offset = lseek(h->stdin_file, 0, SEEK_CUR);
+        if (offset > 0) log_data->stdin_bytes = offset;
+        done = offset >= log_data->stdin_size;
+    } else {
+        int queued = 0;
+        if (h->stdin_probe < 0 || ioctl(h->stdin_probe, FIONREAD, &queued) != 0) return;
+        log_data->stdin_bytes = h->stdin_fed - queued;
+        done = h->stdin_src < 0 && queued == 0;
+    }
+    if (done && log_data->stdin_consumed_ms < 0) log_data->stdin_consumed_ms = elapsed;
+}
+
+// -------------------------------------------------------------
+// MONITOR WAIT
+// sbx_poll for runs with a control socket, captured output or streamed
+// input: wait up to
+// timeout_ms (-1 = forever) for the child to exit, serving commands and
+// draining output meanwhile. Returns 1 when the child may have exited (or
+// was killed by a command), 0 on timeout.
+// -------------------------------------------------------------
+static int monitor_wait(sbx_handle_t *h, long timeout_ms) {
+    long deadline = get_current_time_ms() + timeout_ms;
+    for (;;) {
+        long left = -1;
+        if (timeout_ms >= 0) {
+            left = deadline - get_current_time_ms();
+            if (left < 0) left = 0;
+        }
+
+        struct pollfd pfd[5 + CONTROL_MAX_CLIENTS];
+        pfd[0] = (struct pollfd){ h->pidfd, POLLIN, 0 };
+        pfd[1] = (struct pollfd){ h->control_fd, POLLIN, 0 };
+        pfd[2] = (struct pollfd){ h->capture[0].in, POLLIN, 0 };
+        pfd[3] = (struct pollfd){ h->capture[1].in, POLLIN, 0 };
+        for (int i = 0; i < CONTROL_MAX_CLIENTS; i++) pfd[4 + i] = (struct pollfd){ h->clients[i].fd, POLLIN, 0 };
+        if (h->stdin_src < 0) {
+            pfd[4 + CONTROL_MAX_CLIENTS] = (struct pollfd){ -1, 0, 0 };
+        } else if (h->stdin_wait_in) {
+            pfd[4 + CONTROL_MAX_CLIENTS] = (struct pollfd){ h->stdin_src, POLLIN, 0 };
+        } else {
+            pfd[4 + CONTROL_MAX_CLIENTS] = (struct pollfd){ h->stdin_pipe, POLLOUT, 0 };
+        }
+
+        // Negative fds are ignored by poll()
+        int ready = poll(pfd, 5 + CONTROL_MAX_CLIENTS, (int)left);
+        if (ready < 0 && errno != EINTR) return 1;
+        if (ready <= 0) {
+            // Without a pidfd, exit is only seen by waitpid()
+            if (left == 0) return h->pidfd < 0;
+            continue;
+        }
+
+        for (int i = 0; i < 2; i++) {
+            if (pfd[2 + i].revents) capture_drain(h, i);
+        }
+        if (pfd[4 + CONTROL_MAX_CLIENTS].revents) stdin_feed(h);
+        if (pfd[0].revents) return 1;       // Exited: the caller reaps it
+        if (h->monitor_killed) return 1;    // kill command: reap now
+
+        for (int i = 0; i < CONTROL_MAX_CLIENTS; i++) {
+            if (pfd[4 + i].revents) control_read(h, &h->clients[i]);
+        }
+        if (h->monitor_killed) return 1;
+        if (pfd[1].revents & POLLIN) {
+            int fd = accept4(h->control_fd, NULL, NULL, SOCK_CLOEXEC | SOCK_NONBLOCK);
+            int slot = -1;
+            for (int i = 0; fd >= 0 && i < CONTROL_MAX_CLIENTS && slot < 0; i++) {
+                if (h->clients[i].fd < 0) slot = i;
+            }
+            if (slot >= 0) {
+                h->clients[slot].fd = fd;
+                h->clients[slot].len = 0;
+            } else if (fd >= 0) {
+                close(fd);
+            }
+        }
+        // A job writing nonstop keeps poll() busy: still return on time for the next sample
+        if (timeout_ms >= 0 && get_current_time_ms() >= deadline) return h->pidfd < 0;
+    }
+}
+
+// Monitor the job to completion (if the caller has not), write its log and
+// free the handle. Returns 0 once the log is written.
+int sbx_wait(sbx_handle_t *h, sbx_result_t *result) {
+    // Sample first so even short jobs get one reading; the pidfd wakes us the
+    // moment the child exits instead of at the next interval
+    while (!h->reaped) {
+        if (sbx_sample(h, NULL) != 0) break;
+        sbx_poll(h, h->sample_period_ms);
+    }
+
+    job_spec_t *spec = &h->spec;
+    telemetry_log_t *log_data = &h->log_data;
+    pid_t child_pid = h->pid;
+    int status = h->status;
+
+    // Unpublish before the pid can be reused; a pending freeze is undone
+    if (spec->control) {
+        job_thaw(spec->control);
+        pthread_mutex_lock(&spec->control->lock);
+        spec->control->pid = 0;
+        log_data->frozen_ms = spec->control->frozen_ms;
+        pthread_mutex_unlock(&spec->control->lock);
+    }
+
+    long end_time = get_current_time_ms();
+    log_data->runtime_ms = end_time - h->start_time - log_data->frozen_ms;
+    SBX_PROBE(child__exit, child_pid, status, log_data->runtime_ms);
+
+    // The namespace died with the child: whatever is queued is all there is
+    capture_finish(h);
+    if (log_data->stdin_path) stdin_check(h, log_data->runtime_ms);
+
+    // Counters survive the child, so take a final reading for the summary
+    if (h->have_reclaim) {
+        sample_reclaim(h->cgroup_path, &h->reclaim_base, &log_data->reclaim_total);
+    }
+
+    // The child is reaped: its cgroup can go and its cores can be reused
+    if (h->own_cgroup) cgroup_remove(h->job_cgroup);
+    if (spec->cores) core_release(spec->cores, &h->reserved);
+    // Its /tmp is unreachable now; the slot gets a fresh tmpfs for the next job
+    if (h->scratch_slot >= 0) scratch_release(spec->scratch_pool, h->scratch_slot);
+
+    // Calculate CPU Usage %
+    // total_ticks / CLK_TCK = CPU seconds
+    // runtime_ms / 1000 = Wall seconds
+    if (log_data->runtime_ms > 0) {
+        double cpu_seconds = (double)h->total_ticks / sysconf(_SC_CLK_TCK);
+        double wall_seconds = (double)log_data->runtime_ms / 1000.0;
+        if (wall_seconds > 0) {
+            log_data->cpu_usage_percent = (int)((cpu_seconds / wall_seconds) * 100.0);
+        }
+    }
+    log_data->cpu_time_ms = (long)(h->total_ticks * 1000 / sysconf(_SC_CLK_TCK));
+
+
+    if (WIFEXITED(status)) {
+        if (!spec->quiet) printf("[Sandbox-Parent] Child exited with status: %d\n", WEXITSTATUS(status));
+        snprintf(log_data->exit_reason, sizeof(log_data->exit_reason), "EXITED(%d)", WEXITSTATUS(status));
+    } else if (WIFSIGNALED(status)) {
+        int sig = WTERMSIG(status);
+        if (!spec->quiet) printf("[Sandbox-Parent] Child killed by signal: %d\n", sig);
+        snprintf(log_data->termination_signal, sizeof(log_data->termination_signal), "SIG%d", sig);
+
+        if (h->monitor_killed) {
+             // exit_reason already records why the monitor killed it
+        } else if (sig == SIGSYS) {
+             if (!spec->quiet) printf("[Sandbox-Parent] DETECTED ILLEGAL SYSCALL (Seccomp Blocked)\n");
+             snprintf(log_data->exit_reason, sizeof(log_data->exit_reason), "SECURITY_VIOLATION");
+             // In a real audit setup, we'd read audit log to find WHICH syscall.
+             // Here we assume based on context or store "Unknown"
+             snprintf(log_data->blocked_syscall, sizeof(log_data->blocked_syscall), "Unknown(SIGSYS)");
+        } else if (sig == SIGKILL) {
+             snprintf(log_data->exit_reason, sizeof(log_data->exit_reason), "KILLED_BY_OS");
+        } else {
+             snprintf(log_data->exit_reason, sizeof(log_data->exit_reason), "SIGNALED");
+        }
+    }
+
+    if (result) {
+        result->pid = child_pid;
+        result->runtime_ms = log_data->runtime_ms;
+        result->cpu_usage_percent = log_data->cpu_usage_percent;
+        result->memory_peak_kb = log_data->memory_peak_kb;
+        result->peak_rss_kb = log_data->peak_rss_kb;
+        result->frozen_ms = log_data->frozen_ms;
+        result->cpu_time_ms = log_data->cpu_time_ms;
+        result->mem_gb_seconds = log_data->mem_gb_seconds;
+        result->collector_us = h->collector_ns / 1000;
+        result->samples = h->samples_taken;
+        snprintf(result->verdict, sizeof(result->verdict), "%s", log_data->verdict ? log_data->verdict : "");
+        snprintf(result->exit_reason, sizeof(result->exit_reason), "%s", log_data->exit_reason);
+    }
+
+    // Generate Log Filename with PID for uniqueness
+    char filename[128];
+    snprintf(filename, sizeof(filename), "logs/run_%d_%ld.json", child_pid, time(NULL));
+    log_telemetry(filename, log_data, child_pid);
+    SBX_PROBE(log__written, child_pid, filename);
+    if (result) {
+        snprintf(result->log_path, sizeof(result->log_path), "%s", filename);
+    }
+
+    free_handle(h);
+    return 0;
+}
+
+// Launch one sandboxed program, monitor it to completion and write its log.
+// Returns 0 once the log is written, -1 if the sandbox could not be created.
+int job_run(const job_spec_t *spec, job_result_t *result) {
+    sbx_handle_t *h = sbx_spawn(spec);
+    if (!h) return -1;
+    return sbx_wait(h, result);
+}
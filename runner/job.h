@@ -0,0 +1,135 @@
+#ifndef JOB_H
+#define JOB_H
+
+#include <sys/types.h>
+#include <pthread.h>
+#include <linux/filter.h>
+#include "telemetry.h"
+#include "policy.h"
+#include "cpuset.h"
+#include "predict.h"
+#include "verify.h"
+#include "scratch.h"
+
+// Per-job resource limits (setrlimit fallbacks + wall clock)
+typedef struct {
+    long memory_mb;     // RLIMIT_AS (default 128)
+    int nproc;          // RLIMIT_NPROC (default 20)
+    int nofile;         // RLIMIT_NOFILE (default 64)
+    long time_ms;       // Wall-clock limit, 0 = none
+} job_limits_t;
+
+// Scheduling class: interactive jobs (someone is waiting on the verdict)
+// may preempt batch jobs by freezing them
+typedef enum {
+    PRIORITY_BATCH,
+    PRIORITY_INTERACTIVE
+} job_priority_t;
+
+// Live handle on a running job, shared with a supervisor that may freeze it
+typedef struct {
+    pthread_mutex_t lock;
+    pid_t pid;                  // 0 when no child is running
+    char cgroup[512];           // Job cgroup ("" = none, SIGSTOP/SIGCONT instead)
+    int frozen;
+    long frozen_since_ms;
+    long frozen_ms;             // Completed freezes
+} job_control_t;
+
+// Everything needed to launch one sandboxed program
+typedef struct {
+    char id[64];
+    char *binary_path;
+    char **args;
+    sandbox_profile_t profile;
+    const char *profile_name;
+    policy_config_t policy;
+    job_limits_t limits;
+    long cpu_quota_us;  // cpu.max of the job cgroup, per 100 ms period (0 = copied from ours)
+    int mem_soft;       // memory.high throttling replaces the RLIMIT_AS hard cap
+    int quiet;          // No progress output (batch mode streams results instead)
+    const char *stdin_path;     // Input file: passed on if regular, else streamed through a pipe (NULL = stdin_fd)
+    int stdin_fd;       // Redirect child stdin/stdout/stderr (-1 = inherit)
+    int stdout_fd;
+    int stderr_fd;
+    const struct sock_fprog *filter;   // Precompiled seccomp program (NULL = compile per job)
+
+    // CPU placement
+    cpuset_mode_t cpuset_mode;
+    int cpuset_cores;           // Exclusive cores requested (default 1)
+    int idle_siblings;          // Leave SMT siblings of exclusive cores idle
+    core_allocator_t *cores;    // Shared by all jobs of this launcher
+    int sync_fd;                // Internal: child waits on this until placed
+    int sync_wfd;               // Internal: the parent's write end, closed by the child before it waits
+    int child_quiet;            // Internal: stdout is captured, keep the child's progress lines out of it
+
+    long queue_wait_ms;         // Time spent queued for admission (supervisor mode)
+    char tenant[32];            // Owning tenant ("" = none, flat sandbox_project/<run>)
+    const char *cgroup;         // Existing cgroup to run in, owned by the caller (NULL = per-job or inherited)
+    job_priority_t priority;
+    job_control_t *control;     // Published while running (NULL = not preemptible)
+
+    char binary_hash[17];       // Content hash (computed by job_run if empty)
+    job_prediction_t prediction;    // From run history (samples == 0: none)
+
+    // Called from the monitor loop with every sample (sandboxd streams them)
+    void (*on_sample)(void *ctx, const telemetry_sample_t *sample);
+    void *sample_ctx;
+
+    long window_ms;             // Service mode: append a telemetry window this often (0 = one log at exit)
+    const char *control_path;   // Per-run control socket, served by sbx_poll; %d = sandbox pid (NULL = none, "" = logs/control_%d.sock)
+
+    // Output capture: stdout/stderr left to inherit go through pipes the
+    // launcher drains with splice() into DIR/run_<pid>.stdout|.stderr
+    const char *capture_dir;    // NULL = no capture
+    long capture_limit;         // Bytes kept per stream, the rest is dropped (0 = unlimited)
+
+    // Streaming verification: stdout (when left to inherit) is compared with
+    // this file as it is produced (verify.h)
+    const char *expected_path;  // NULL = not verified
+    verify_mode_t verify_mode;
+    int verify_kill;            // Kill the job at the first mismatch (exit_reason WRONG_ANSWER)
+
+    // Writable /tmp: a tmpfs capped in size and inodes (scratch.h)
+    long scratch_mb;            // 0 = none, /tmp stays read-only
+    long scratch_inodes;
+    scratch_pool_t *scratch_pool;   // Pre-mounted slots shared by all jobs (NULL = the child mounts its own)
+    char scratch_path[256];     // Internal: pool slot bound at /tmp ("" = own mount)
+    uid_t scratch_uid;          // Internal: own mount, the child runs as these (mapped by the parent)
+    gid_t scratch_gid;
+    int nproc_cgroup;           // Internal: pids.max of the job cgroup stands in for RLIMIT_NPROC
+} job_spec_t;
+
+// Outcome of one job (the summary part of its telemetry log)
+typedef struct {
+    pid_t pid;
+    long runtime_ms;
+    int cpu_usage_percent;
+    long memory_peak_kb;        // VmPeak
+    long peak_rss_kb;           // VmHWM
+    long frozen_ms;
+    long cpu_time_ms;
+    double mem_gb_seconds;
+    long collector_us;          // Monitoring cost: time spent sampling /proc
+    long samples;
+    char verdict[16];           // "ACCEPTED" / "WRONG_ANSWER" with expected_path, else ""
+    char exit_reason[32];
+    char log_path[128];
+} job_result_t;
+
+// Function prototypes
+void job_spec_init(job_spec_t *spec);
+int job_parse_profile(const char *name, sandbox_profile_t *profile, const char **profile_name);
+int job_parse_cpuset(const char *value, cpuset_mode_t *mode, int *cores);
+int job_compile_filter(sandbox_profile_t profile, struct sock_fprog *prog);
+int job_run(const job_spec_t *spec, job_result_t *result);
+void job_enter_sandbox(const job_spec_t *spec);
+void job_exec(const job_spec_t *spec) __attribute__((noreturn));
+int job_parse_priority(const char *value, job_priority_t *priority);
+int job_parse_tenant(const char *value, char *tenant, size_t len);
+void job_control_init(job_control_t *ctl);
+int job_freeze(job_control_t *ctl);
+int job_thaw(job_control_t *ctl);
+long job_frozen_ms(job_control_t *ctl);
+
+#endif
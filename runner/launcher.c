@@ -2,121 +2,91 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <unistd.h>
-#include <sched.h>
-#include <sys/wait.h>
-#include <sys/resource.h>
-#include <sys/mount.h>
 #include <string.h>
-#include <errno.h>
-#include <fcntl.h>
-#include <time.h>
-#include "../policies/seccomp_rules.h"
 #include "telemetry.h"
-
-// Stack size for cloned child
-#define STACK_SIZE (1024 * 1024)
+#include "policy.h"
+#include "job.h"
+#include "libsandbox.h"
+#include "batch.h"
+#include "sandboxd.h"
+#include "testset.h"
+#include "pipeline.h"
+#include "cache.h"
+#include "bench.h"
+#include "metrics.h"
+#include "tenant.h"
+#include "cgroup.h"
 
 /**
  * STRUCTURE:
- * 1. Parse Arguments (Binary to run)
- * 2. Setup Resources (RLIMIT)
- * 3. Isolate (Namespaces) - handled via 'unshare' or 'clone' logic
- * 4. Apply Seccomp
- * 5. Execve
+ * 1. Parse Arguments (Binary to run, or a batch manifest)
+ * 2. Setup Resources (RLIMIT)                     -> libsandbox (job.c)
+ * 3. Isolate (Namespaces) - handled via 'clone'   -> libsandbox (job.c)
+ * 4. Apply Seccomp                                -> libsandbox (job.c)
+ * 5. Execve                                       -> libsandbox (job.c)
  */
 
-struct container_config {
-    char *binary_path;
-    char **args;
-    sandbox_profile_t profile;
-};
-
-// Child process function
-int child_fn(void *arg) {
-    struct container_config *config = (struct container_config *)arg;
-
-    printf("[Sandbox-Child] PID: %d inside new namespace\n", getpid());
-
-    // -------------------------------------------------------------
-    // F. INTERPROCESS COMMUNICATION (IPC)
-    // Mechanism: IPC Isolation via Namespace
-    // The child is in a new IPC namespace, so it cannot see host semaphores/shm.
-    // -------------------------------------------------------------
-    
-    // -------------------------------------------------------------
-    // E. FILE SYSTEM MANAGEMENT
-    // Mechanism: Mount Namespace + Read-Only Root
-    // -------------------------------------------------------------
-    // 1. make mount setting private
-    if (mount(NULL, "/", NULL, MS_PRIVATE | MS_REC, NULL) != 0) {
-        perror("mount / private");
-    }
-    
-    // 2. Remount / as Read-Only
-    // This prevents the untrusted process from modifying ANY file in the system
-    // unless we explicitly mount a writable tmpfs (which we skip for strict sandbox).
-    if (mount(NULL, "/", NULL, MS_REMOUNT | MS_BIND | MS_RDONLY, NULL) != 0) {
-       perror("mount / read-only");
-       // Non-fatal for demo if unprivileged, but critical for security.
-    } else {
-       printf("[Sandbox-Child] Filesystem locked (Read-Only Root Enforced).\n");
-    }
-    
-    // -------------------------------------------------------------
-    // B. MEMORY MANAGEMENT (Soft Limits)
-    // Mechanism: setrlimit() for Stack and Data
-    // Hard limits are enforced by Cgroups v2 in the Python runner (or here if Resource Aware).
-    // -------------------------------------------------------------
-    if (config->profile == PROFILE_RESOURCE_AWARE) {
-         // Tighter limits or specific ones for Resource Aware
-         printf("[Sandbox-Child] Applying RESOURCE-AWARE limits...\n");
-    }
-
-    struct rlimit rl;
-    // Limit stack to 8MB
-    rl.rlim_cur = 8 * 1024 * 1024;
-    rl.rlim_max = 8 * 1024 * 1024;
-    setrlimit(RLIMIT_STACK, &rl);
-
-    // Limit File Descriptors
-    rl.rlim_cur = 64;
-    rl.rlim_max = 64;
-    setrlimit(RLIMIT_NOFILE, &rl);
-
-    // B. MEMORY MANAGEMENT (Fallback if Cgroups fail)
-    // Limit Address Space to 128MB
-    rl.rlim_cur = 128 * 1024 * 1024;
-    rl.rlim_max = 128 * 1024 * 1024;
-    setrlimit(RLIMIT_AS, &rl);
-    
-    // C. PROCESS MANAGEMENT (Fallback)
-    // Limit number of processes (Fork Bomb protection)
-    // Note: In unprivileged UserNS, this limits processes in this namespace.
-    rl.rlim_cur = 20;
-    rl.rlim_max = 20;
-    setrlimit(RLIMIT_NPROC, &rl);
-
-    // -------------------------------------------------------------
-    // D. SYSTEM CALL HANDLING
-    // Mechanism: Seccomp BPF
-    // -------------------------------------------------------------
-    install_syscall_filter(config->profile);
-
-    // -------------------------------------------------------------
-    // C. PROCESS MANAGEMENT
-    // Mechanism: execv()
-    // Replaces the current process image with the untrusted code.
-    // -------------------------------------------------------------
-    printf("[Sandbox-Child] Executing untrusted binary: %s\n", config->binary_path);
-    execv(config->binary_path, config->args);
-
-    // If execv returns, it failed
-    perror("execv failed");
-    return 1;
-}
-
 void print_usage(const char *prog) {
-    fprintf(stderr, "Usage: %s [--profile=STRICT|RESOURCE-AWARE|LEARNING] <executable> [args...]\n", prog);
+    fprintf(stderr, "Usage: %s [--profile=STRICT|RESOURCE-AWARE|LEARNING] [--policy=SPEC] [--mem-soft] <executable> [args...]\n", prog);
+    fprintf(stderr, "       %s --batch jobs.jsonl [--jobs N] [options]\n", prog);
+    fprintf(stderr, "       %s --daemon SOCKET [--jobs N] [options]\n", prog);
+    fprintf(stderr, "       %s --submit SOCKET [options] <executable> [args...]\n", prog);
+    fprintf(stderr, "       %s --tests DIR [--jobs N] [options] <executable> [args...]\n", prog);
+    fprintf(stderr, "       %s --bench N [--bench-warmup=K] [--bench-precision=PCT] [options] <executable> [args...]\n", prog);
+    fprintf(stderr, "       %s --overhead N [options] <executable> [args...]\n", prog);
+    fprintf(stderr, "       %s --pipeline \"prog args | prog args | ...\" [--pipe-size=BYTES] [options]\n", prog);
+    fprintf(stderr, "  --policy=SPEC LEARNING thresholds, e.g. \"tight:cpu_ms=1500,majflt=500,mem_kb=65536\"\n");
+    fprintf(stderr, "  --mem-soft   Use the cgroup's memory.high (throttle + reclaim) instead of the RLIMIT_AS cap\n");
+    fprintf(stderr, "  --control[=PATH]  Serve a control socket for the run (default logs/control_%%d.sock, %%d is\n");
+    fprintf(stderr, "               the sandbox pid and required in PATH for batch, daemon and pipeline runs):\n");
+    fprintf(stderr, "               snapshot, period MS, freeze, thaw, limit KEY=VALUE, kill (one per line)\n");
+    fprintf(stderr, "  --stdin FILE Job input: a regular file is passed as is, anything else streamed with splice()\n");
+    fprintf(stderr, "  --expect=FILE  Verify stdout against FILE while it is produced; the verdict and the offset\n");
+    fprintf(stderr, "               of the first difference go in the run log\n");
+    fprintf(stderr, "  --expect-mode=exact|whitespace|tokens  Comparison (default exact)\n");
+    fprintf(stderr, "  --expect-kill  Kill the job at the first mismatch (exit reason WRONG_ANSWER)\n");
+    fprintf(stderr, "  --capture[=DIR]  Capture the job's stdout/stderr with splice() into DIR/run_<pid>.stdout|.stderr\n");
+    fprintf(stderr, "               (default logs); bytes and throttle time go in the run log\n");
+    fprintf(stderr, "  --capture-limit=BYTES  Bytes kept per stream, the rest dropped (default 1048576, 0 = all)\n");
+    fprintf(stderr, "  --scratch-mb=N  Writable /tmp: a tmpfs of N MB (default none, /tmp read-only). Batch and\n");
+    fprintf(stderr, "               daemon mode pre-mount them under scratch/ and recycle used ones in the\n");
+    fprintf(stderr, "               background. Usage goes in the run log's timeline. Not with --tests/--bench\n");
+    fprintf(stderr, "  --scratch-inodes=N  Files and directories allowed in the scratch /tmp (default 4096)\n");
+    fprintf(stderr, "  --service[=SECONDS]  Long-running service: append a telemetry window (samples + rolling\n");
+    fprintf(stderr, "               summary) to logs/service_<pid>_<t>.jsonl every SECONDS (default 60)\n");
+    fprintf(stderr, "  --batch FILE Run every job of a JSONL manifest, streaming one result line per job\n");
+    fprintf(stderr, "  --jobs N     Batch/daemon concurrency (default: one worker per online core);\n");
+    fprintf(stderr, "               testcases run at a time with --tests (default 1)\n");
+    fprintf(stderr, "  --tests DIR  Run the executable once per DIR/*.in (as stdin) in one prepared sandbox\n");
+    fprintf(stderr, "  --pipeline SPEC  Run every stage in its own sandbox, piped together through the launcher\n");
+    fprintf(stderr, "  --pipe-size=BYTES  Pipeline pipe capacity (F_SETPIPE_SZ, default 1 MiB)\n");
+    fprintf(stderr, "  --bench N    Run the executable up to N times pinned in one sandbox and report median,\n");
+    fprintf(stderr, "               MAD, min and 95%% CI of wall time, CPU time and peak RSS\n");
+    fprintf(stderr, "  --bench-warmup=K     Discarded runs before measuring (default 2)\n");
+    fprintf(stderr, "  --bench-precision=PCT  Stop once the median's CI is within +-PCT%% (default 1)\n");
+    fprintf(stderr, "  --overhead N Run the executable N times each unsandboxed and under every profile,\n");
+    fprintf(stderr, "               interleaved, and report what the sandbox adds to wall, CPU and system time\n");
+    fprintf(stderr, "  --cache[=DIR]  Reuse the result of an identical earlier run (binary, args, stdin, profile,\n");
+    fprintf(stderr, "               limits, expected output) from DIR (default ./cache) instead of launching\n");
+    fprintf(stderr, "  --cache-budget-mb=N  Disk budget of the cache, least recently used entries go first (default 1024)\n");
+    fprintf(stderr, "  --cache-verify=RATE  Re-execute this fraction of cache hits to catch nondeterministic jobs\n");
+    fprintf(stderr, "  --daemon SOCKET  Stay resident (sandboxd) and run jobs submitted on a Unix socket\n");
+    fprintf(stderr, "  --metrics=SOCKET  Batch/daemon: serve OpenMetrics (launches, exits by reason, latency,\n");
+    fprintf(stderr, "               runtime and peak RSS histograms, collector cost) on a Unix socket\n");
+    fprintf(stderr, "  --submit SOCKET  Run the job through a running sandboxd instead of locally\n");
+    fprintf(stderr, "  --cpuset=shared|exclusive[:N]  Pin to the shared pool, or to N cores of our own\n");
+    fprintf(stderr, "  --exclusive-cpus=LIST  CPUs reserved for exclusive jobs (e.g. 4-7); the rest are shared.\n");
+    fprintf(stderr, "               Exclusive only among the sandboxes of this launcher: other launchers and\n");
+    fprintf(stderr, "               host processes are not kept off these CPUs (no cpuset.cpus.partition)\n");
+    fprintf(stderr, "  --smt-idle   Keep SMT siblings of exclusive cores idle\n");
+    fprintf(stderr, "  --admit-psi=PCT     Batch: start jobs only while PSI some avg10 (cpu/memory/io) is below PCT\n");
+    fprintf(stderr, "  --admit-mem-mb=N    Batch: start jobs only while MemAvailable is at least N MB\n");
+    fprintf(stderr, "  --pack       Batch: pack jobs onto cores and memory by predictions from logs/\n");
+    fprintf(stderr, "  --pack-margin=F     Safety margin on predictions (default 0.2 = +20%%)\n");
+    fprintf(stderr, "  --predict-quantile=Q  History quantile used as the prediction (default 0.9)\n");
+    fprintf(stderr, "  --tenant=NAME[:weight=W,mem=SIZE,pids=N]  Run under sandbox_project/NAME with these\n");
+    fprintf(stderr, "               cgroup limits; in batch and daemon mode, defines a tenant (repeatable);\n");
+    fprintf(stderr, "               with --submit, NAME only (the daemon sets the limits)\n");
 }
 
 int main(int argc, char *argv[]) {
@@ -126,199 +96,289 @@ int main(int argc, char *argv[]) {
     }
 
     // Default profile
-    sandbox_profile_t profile = PROFILE_STRICT;
-    char *profile_str = "STRICT";
-    
+    sbx_config_t spec;
+    sbx_config_init(&spec);
+
+    const char *batch_manifest = NULL;
+    const char *daemon_socket = NULL;
+    const char *submit_socket = NULL;
+    const char *tests_dir = NULL;
+    const char *pipeline_spec = NULL;
+    int pipe_size = 0;
+    cache_config_t cache = { NULL, 1024 * 1024, 0 };
+    bench_config_t bench = { 0, 2, 0.01 };
+    int overhead_rounds = 0;
+    const char *metrics_socket = NULL;
+    const char *policy_spec = NULL;
+    int batch_workers = 0;
+    const char *exclusive_cpus = NULL;
+    static core_allocator_t cores;
+    static scratch_pool_t scratch;
+    admission_config_t admit;
+    admission_config_init(&admit);
+    static tenant_t tenants[MAX_TENANTS];
+    int tenant_count = 0;
+    int pack = 0;
+    double pack_margin = 0.2;
+    double quantile = 0.9;
+
     int bin_index = 1;
-    if (strncmp(argv[1], "--profile=", 10) == 0) {
-        char *pinfo = argv[1] + 10;
-        if (strcmp(pinfo, "STRICT") == 0) {
-            profile = PROFILE_STRICT;
-            profile_str = "STRICT";
-        } else if (strcmp(pinfo, "RESOURCE-AWARE") == 0) {
-            profile = PROFILE_RESOURCE_AWARE;
-            profile_str = "RESOURCE-AWARE";
-        } else if (strcmp(pinfo, "LEARNING") == 0) {
-            profile = PROFILE_LEARNING;
-            profile_str = "LEARNING";
+    while (bin_index < argc && strncmp(argv[bin_index], "--", 2) == 0) {
+        if (strncmp(argv[bin_index], "--profile=", 10) == 0) {
+            char *pinfo = argv[bin_index] + 10;
+            if (job_parse_profile(pinfo, &spec.profile, &spec.profile_name) != 0) {
+                 fprintf(stderr, "Unknown profile: %s. Using STRICT.\n", pinfo);
+            }
+        } else if (strncmp(argv[bin_index], "--policy=", 9) == 0) {
+            if (policy_parse(argv[bin_index] + 9, &spec.policy) != 0) {
+                fprintf(stderr, "Invalid policy spec: %s\n", argv[bin_index] + 9);
+                return 1;
+            }
+            policy_spec = argv[bin_index] + 9;
+        } else if (strcmp(argv[bin_index], "--mem-soft") == 0) {
+            spec.mem_soft = 1;
+        } else if (strcmp(argv[bin_index], "--control") == 0) {
+            spec.control_path = "";
+        } else if (strncmp(argv[bin_index], "--control=", 10) == 0) {
+            spec.control_path = argv[bin_index] + 10;
+        } else if (strcmp(argv[bin_index], "--stdin") == 0 && bin_index + 1 < argc) {
+            spec.stdin_path = argv[++bin_index];
+        } else if (strncmp(argv[bin_index], "--stdin=", 8) == 0) {
+            spec.stdin_path = argv[bin_index] + 8;
+        } else if (strncmp(argv[bin_index], "--expect=", 9) == 0) {
+            spec.expected_path = argv[bin_index] + 9;
+        } else if (strncmp(argv[bin_index], "--expect-mode=", 14) == 0) {
+            if (verify_parse_mode(argv[bin_index] + 14, &spec.verify_mode) != 0) {
+                fprintf(stderr, "Invalid comparison mode: %s\n", argv[bin_index] + 14);
+                return 1;
+            }
+        } else if (strcmp(argv[bin_index], "--expect-kill") == 0) {
+            spec.verify_kill = 1;
+        } else if (strcmp(argv[bin_index], "--capture") == 0) {
+            spec.capture_dir = "logs";
+        } else if (strncmp(argv[bin_index], "--capture=", 10) == 0) {
+            spec.capture_dir = argv[bin_index] + 10;
+        } else if (strncmp(argv[bin_index], "--capture-limit=", 16) == 0) {
+            spec.capture_limit = atol(argv[bin_index] + 16);
+            if (spec.capture_limit < 0) {
+                fprintf(stderr, "Invalid capture limit: %s\n", argv[bin_index] + 16);
+                return 1;
+            }
+        } else if (strncmp(argv[bin_index], "--scratch-mb=", 13) == 0) {
+            spec.scratch_mb = atol(argv[bin_index] + 13);
+            if (spec.scratch_mb < 0) {
+                fprintf(stderr, "Invalid scratch size: %s\n", argv[bin_index] + 13);
+                return 1;
+            }
+        } else if (strncmp(argv[bin_index], "--scratch-inodes=", 17) == 0) {
+            spec.scratch_inodes = atol(argv[bin_index] + 17);
+            if (spec.scratch_inodes <= 0) {
+                fprintf(stderr, "Invalid scratch inode count: %s\n", argv[bin_index] + 17);
+                return 1;
+            }
+        } else if (strcmp(argv[bin_index], "--service") == 0) {
+            spec.window_ms = 60 * 1000;
+        } else if (strncmp(argv[bin_index], "--service=", 10) == 0) {
+            spec.window_ms = atol(argv[bin_index] + 10) * 1000;
+            if (spec.window_ms <= 0) {
+                fprintf(stderr, "Invalid service window: %s\n", argv[bin_index] + 10);
+                return 1;
+            }
+        } else if (strncmp(argv[bin_index], "--cpuset=", 9) == 0) {
+            if (job_parse_cpuset(argv[bin_index] + 9, &spec.cpuset_mode, &spec.cpuset_cores) != 0) {
+                fprintf(stderr, "Invalid cpuset mode: %s\n", argv[bin_index] + 9);
+                return 1;
+            }
+        } else if (strncmp(argv[bin_index], "--exclusive-cpus=", 17) == 0) {
+            exclusive_cpus = argv[bin_index] + 17;
+        } else if (strcmp(argv[bin_index], "--smt-idle") == 0) {
+            spec.idle_siblings = 1;
+        } else if (strncmp(argv[bin_index], "--admit-psi=", 12) == 0) {
+            admit.psi_some_max = atof(argv[bin_index] + 12);
+        } else if (strncmp(argv[bin_index], "--admit-mem-mb=", 15) == 0) {
+            admit.mem_free_min_kb = atol(argv[bin_index] + 15) * 1024;
+        } else if (strcmp(argv[bin_index], "--pack") == 0) {
+            pack = 1;
+        } else if (strncmp(argv[bin_index], "--pack-margin=", 14) == 0) {
+            pack_margin = atof(argv[bin_index] + 14);
+        } else if (strncmp(argv[bin_index], "--predict-quantile=", 19) == 0) {
+            quantile = atof(argv[bin_index] + 19);
+            if (quantile <= 0 || quantile > 1) {
+                fprintf(stderr, "Invalid quantile: %s\n", argv[bin_index] + 19);
+                return 1;
+            }
+        } else if (strncmp(argv[bin_index], "--tenant=", 9) == 0) {
+            if (tenant_count == MAX_TENANTS || tenant_parse(argv[bin_index] + 9, &tenants[tenant_count]) != 0) {
+                fprintf(stderr, "Invalid tenant spec: %s\n", argv[bin_index] + 9);
+                return 1;
+            }
+            tenant_count++;
+        } else if (strncmp(argv[bin_index], "--metrics=", 10) == 0) {
+            metrics_socket = argv[bin_index] + 10;
+        } else if (strcmp(argv[bin_index], "--daemon") == 0 && bin_index + 1 < argc) {
+            daemon_socket = argv[++bin_index];
+        } else if (strcmp(argv[bin_index], "--submit") == 0 && bin_index + 1 < argc) {
+            submit_socket = argv[++bin_index];
+        } else if (strcmp(argv[bin_index], "--pipeline") == 0 && bin_index + 1 < argc) {
+            pipeline_spec = argv[++bin_index];
+        } else if (strncmp(argv[bin_index], "--pipe-size=", 12) == 0) {
+            pipe_size = atoi(argv[bin_index] + 12);
+        } else if (strcmp(argv[bin_index], "--tests") == 0 && bin_index + 1 < argc) {
+            tests_dir = argv[++bin_index];
+        } else if (strcmp(argv[bin_index], "--bench") == 0 && bin_index + 1 < argc) {
+            bench.iterations = atoi(argv[++bin_index]);
+            if (bench.iterations <= 0) {
+                fprintf(stderr, "Invalid iteration count: %s\n", argv[bin_index]);
+                return 1;
+            }
+        } else if (strcmp(argv[bin_index], "--overhead") == 0 && bin_index + 1 < argc) {
+            overhead_rounds = atoi(argv[++bin_index]);
+            if (overhead_rounds <= 0) {
+                fprintf(stderr, "Invalid round count: %s\n", argv[bin_index]);
+                return 1;
+            }
+        } else if (strncmp(argv[bin_index], "--bench-warmup=", 15) == 0) {
+            bench.warmup = atoi(argv[bin_index] + 15);
+        } else if (strncmp(argv[bin_index], "--bench-precision=", 18) == 0) {
+            bench.precision = atof(argv[bin_index] + 18) / 100.0;
+        } else if (strcmp(argv[bin_index], "--cache") == 0) {
+            cache.dir = "cache";
+        } else if (strncmp(argv[bin_index], "--cache=", 8) == 0) {
+            cache.dir = argv[bin_index] + 8;
+        } else if (strncmp(argv[bin_index], "--cache-budget-mb=", 18) == 0) {
+            cache.budget_kb = atol(argv[bin_index] + 18) * 1024;
+        } else if (strncmp(argv[bin_index], "--cache-verify=", 15) == 0) {
+            cache.verify_rate = atof(argv[bin_index] + 15);
+        } else if (strcmp(argv[bin_index], "--batch") == 0 && bin_index + 1 < argc) {
+            batch_manifest = argv[++bin_index];
+        } else if (strcmp(argv[bin_index], "--jobs") == 0 && bin_index + 1 < argc) {
+            batch_workers = atoi(argv[++bin_index]);
         } else {
-             fprintf(stderr, "Unknown profile: %s. Using STRICT.\n", pinfo);
+            fprintf(stderr, "Unknown option: %s\n", argv[bin_index]);
+            print_usage(argv[0]);
+            return 1;
         }
         bin_index++;
     }
 
-    if (bin_index >= argc) {
-        print_usage(argv[0]);
+    // One core allocator for every sandbox this launcher starts
+    if (core_allocator_init(&cores, exclusive_cpus) != 0) {
         return 1;
     }
+    spec.cores = &cores;
 
-    printf("[Sandbox-Parent] Preparing execution environment (Profile: %s)...\n", profile_str);
-    
-    // Ensure logs directory exists
-    ensure_logs_directory();
+    // Concurrent sandboxes can't share one socket path
+    if ((batch_manifest || daemon_socket || pipeline_spec) && spec.control_path && spec.control_path[0] &&
+        !strstr(spec.control_path, "%d")) {
+        fprintf(stderr, "--control=%s: batch, daemon and pipeline runs need a per-job path with %%d (the pid)\n",
+                spec.control_path);
+        return 1;
+    }
 
-    // Prepare child stack
-    char *stack = malloc(STACK_SIZE);
-    if (!stack) {
-        perror("malloc stack");
-        exit(1);
+    // Supervisor modes: fleet metrics for the whole run
+    if ((batch_manifest || daemon_socket) && metrics_socket && metrics_serve(metrics_socket) != 0) {
+        return 1;
     }
-    
-    // Setup config
-    struct container_config config;
-    config.binary_path = argv[bin_index];
-    config.args = &argv[bin_index]; // Pass the executable + its args
-    config.profile = profile;
 
-    // -------------------------------------------------------------
-    // C. PROCESS MANAGEMENT & E. FILESYSTEM
-    // Mechanism: clone() with CLONE_NEW* flags
-    // Creating a new process in new namespaces (PID, IPC, UTS, MOUNT).
-    // SIGCHLD tells the kernel to notify us when child dies.
-    // -------------------------------------------------------------
-    // Note: Creating User Namespaces (CLONE_NEWUSER) allows unprivileged users 
-    // to usage other namespaces. Required for WSL2 often.
-    
-    int flags = CLONE_NEWNS | CLONE_NEWPID | CLONE_NEWIPC | CLONE_NEWUTS | CLONE_NEWUSER | SIGCHLD;
-    
-    long start_time = get_current_time_ms();
-    
-    pid_t child_pid = clone(child_fn, stack + STACK_SIZE, flags, &config);
+    // Scratch /tmp: supervisor modes pre-mount a pool for their workers;
+    // single runs and pipelines have each sandbox mount its own. The prepared
+    // sandboxes of --tests and --bench run every testcase or iteration in
+    // one mount namespace, so they get none.
+    if (spec.scratch_mb > 0 && (tests_dir || bench.iterations > 0 || overhead_rounds > 0)) {
+        fprintf(stderr, "[Scratch] --scratch-mb is not supported with --tests, --bench or --overhead. Ignoring.\n");
+        spec.scratch_mb = 0;
+    }
+    if (spec.scratch_mb > 0 && (batch_manifest || daemon_socket)) {
+        int workers = batch_workers > 0 ? batch_workers : (int)sysconf(_SC_NPROCESSORS_ONLN);
+        if (scratch_pool_init(&scratch, "scratch", workers, spec.scratch_mb, spec.scratch_inodes) == 0) {
+            spec.scratch_pool = &scratch;
+        } else {
+            fprintf(stderr, "[Scratch] Cannot pre-mount scratch areas under scratch/ (%d ready). "
+                            "Each sandbox mounts its own.\n", scratch.count);
+            scratch_pool_destroy(&scratch);
+        }
+    }
 
-    
-    if (child_pid == -1) {
-        perror("clone failed (Trying fallback to simple fork without namespaces if unprivileged)");
-        exit(1);
+    if (batch_manifest) {
+        batch_config_t config = { batch_workers, &spec, admit, tenants, tenant_count, pack, pack_margin, quantile };
+        int rc = batch_run(batch_manifest, &config);
+        metrics_close();
+        if (spec.scratch_pool) scratch_pool_destroy(&scratch);
+        return rc;
     }
 
-    printf("[Sandbox-Parent] Child launched with PID: %d\n", child_pid);
+    if (daemon_socket) {
+        sandboxd_config_t config = { batch_workers, &spec, tenants, tenant_count };
+        int rc = sandboxd_run(daemon_socket, &config);
+        metrics_close();
+        if (spec.scratch_pool) scratch_pool_destroy(&scratch);
+        return rc;
+    }
 
-    // -------------------------------------------------------------
-    // H. TIME MANAGEMENT & TELEMETRY
-    // Mechanism: waitpid(WNOHANG) + Polling
-    // -------------------------------------------------------------
-    int status;
-    int child_running = 1;
-    
-    telemetry_log_t log_data = {0};
-    log_data.program_name = config.binary_path;
-    log_data.profile_name = profile_str;
-    log_data.cpu_usage_percent = 0;
-    log_data.memory_peak_kb = 0;
-    log_data.minflt = 0;
-    log_data.majflt = 0;
-    log_data.samples = NULL;
-    log_data.sample_count = 0;
-    
-    unsigned long long total_ticks = 0;
+    if (pipeline_spec) {
+        ensure_logs_directory();
+        return pipeline_run(pipeline_spec, &spec, pipe_size);
+    }
 
+    if (bin_index >= argc) {
+        print_usage(argv[0]);
+        return 1;
+    }
 
-    // Monitoring Loop
-    while (child_running) {
-        pid_t result = waitpid(child_pid, &status, WNOHANG);
-        
-        if (result == 0) {
-            // Child still running, collect metrics
-            long current_mem = get_memory_peak(child_pid);
-            if (current_mem > log_data.memory_peak_kb) {
-                log_data.memory_peak_kb = current_mem;
-            }
-            
-            // Capure CPU ticks and Faults
-            unsigned long minflt = 0, majflt = 0;
-            unsigned long long current_ticks = get_process_metrics(child_pid, &minflt, &majflt);
-            if (current_ticks > total_ticks) {
-                total_ticks = current_ticks;
-            }
-            // Update faults (they are cumulative in stat, so just take latest)
-            log_data.minflt = minflt;
-            log_data.majflt = majflt;
-            
-            // Add time-series sample
-            long elapsed = get_current_time_ms() - start_time;
-            double cpu_seconds = (double)current_ticks / sysconf(_SC_CLK_TCK);
-            double wall_seconds = (double)elapsed / 1000.0;
-            int current_cpu_percent = (wall_seconds > 0) ? (int)((cpu_seconds / wall_seconds) * 100.0) : 0;
-            add_sample(&log_data, elapsed, current_cpu_percent, current_mem);
+    if (submit_socket) {
+        spec.binary_path = argv[bin_index];
+        spec.args = &argv[bin_index];
+        // The daemon owns tenant limits (its own --tenant options)
+        if (tenant_count > 1 || (tenant_count == 1 && (tenants[0].weight != 100 ||
+            strcmp(tenants[0].memory_max, "max") != 0 || strcmp(tenants[0].pids_max, "max") != 0))) {
+            fprintf(stderr, "--submit takes one --tenant=NAME; tenant limits are set on the daemon\n");
+            return 1;
+        }
+        if (tenant_count > 0) snprintf(spec.tenant, sizeof(spec.tenant), "%s", tenants[0].name);
+        return sandboxd_submit(submit_socket, &spec, policy_spec);
+    }
 
-            // -------------------------------------------------------------
-            // DYNAMIC POLICY ADAPTATION (Phase 5)
-            // OS Concept: Runtime Enforcement based on Behavioral Analysis
-            // -------------------------------------------------------------
-            if (config.profile == PROFILE_LEARNING) {
-                // Heuristic: If CPU ticks > Threshold or Faults > Threshold
-                // In a real system, this would be more complex or use eBPF data
-                
-                // Thresholds (Arbitrary for demo)
-                unsigned long long cpu_threshold_ticks = sysconf(_SC_CLK_TCK) * 2; // ~2 seconds of full CPU
-                unsigned long fault_threshold = 1000;
-                
-                if (current_ticks > cpu_threshold_ticks || majflt > fault_threshold) {
-                     printf("\n[Sandbox-Monitor] ⚠️ RISK DETECTED in Learning Mode!\n");
-                     printf("[Sandbox-Monitor] Reason: usage (%llu ticks) or faults (%lu) > threshold.\n", current_ticks, majflt);
-                     printf("[Sandbox-Monitor] 🔄 ADAPTING POLICY: Switching to STRICT enforcement (Terminating Process)...\n");
-                     
-                     kill(child_pid, SIGKILL);
-                     child_running = 0;
-                     
-                     snprintf(log_data.exit_reason, sizeof(log_data.exit_reason), "POLICY_ADAPATION_KILL");
-                }
-            }
+    printf("[Sandbox-Parent] Preparing execution environment (Profile: %s)...\n", spec.profile_name);
 
+    // Ensure logs directory exists
+    ensure_logs_directory();
 
-            
-            usleep(100000); // 100ms sample rate
-        } else if (result == -1) {
-            perror("waitpid");
-            child_running = 0;
-        } else {
-            // Child exited
-            child_running = 0;
-        }
-    }
-    
-    long end_time = get_current_time_ms();
-    log_data.runtime_ms = end_time - start_time;
+    // Setup config
+    spec.binary_path = argv[bin_index];
+    spec.args = &argv[bin_index]; // Pass the executable + its args
 
-    // Calculate CPU Usage %
-    // total_ticks / CLK_TCK = CPU seconds
-    // runtime_ms / 1000 = Wall seconds
-    if (log_data.runtime_ms > 0) {
-        double cpu_seconds = (double)total_ticks / sysconf(_SC_CLK_TCK);
-        double wall_seconds = (double)log_data.runtime_ms / 1000.0;
-        if (wall_seconds > 0) {
-            log_data.cpu_usage_percent = (int)((cpu_seconds / wall_seconds) * 100.0);
-        }
+    if (overhead_rounds > 0) {
+        return bench_overhead(&spec, overhead_rounds);
     }
 
+    if (bench.iterations > 0) {
+        return bench_run(&spec, &bench);
+    }
 
-    if (WIFEXITED(status)) {
-        printf("[Sandbox-Parent] Child exited with status: %d\n", WEXITSTATUS(status));
-        snprintf(log_data.exit_reason, sizeof(log_data.exit_reason), "EXITED(%d)", WEXITSTATUS(status));
-    } else if (WIFSIGNALED(status)) {
-        int sig = WTERMSIG(status);
-        printf("[Sandbox-Parent] Child killed by signal: %d\n", sig);
-        snprintf(log_data.termination_signal, sizeof(log_data.termination_signal), "SIG%d", sig);
-        
-        if (sig == SIGSYS) {
-             printf("[Sandbox-Parent] DETECTED ILLEGAL SYSCALL (Seccomp Blocked)\n");
-             snprintf(log_data.exit_reason, sizeof(log_data.exit_reason), "SECURITY_VIOLATION");
-             // In a real audit setup, we'd read audit log to find WHICH syscall. 
-             // Here we assume based on context or store "Unknown"
-             snprintf(log_data.blocked_syscall, sizeof(log_data.blocked_syscall), "Unknown(SIGSYS)");
-        } else if (sig == SIGKILL) {
-             snprintf(log_data.exit_reason, sizeof(log_data.exit_reason), "KILLED_BY_OS");
-        } else {
-             snprintf(log_data.exit_reason, sizeof(log_data.exit_reason), "SIGNALED");
+    // A single run or a test set belongs to the first --tenant given
+    if (tenant_count > 0) {
+        snprintf(spec.tenant, sizeof(spec.tenant), "%s", tenants[0].name);
+        if (tenant_setup_cgroup(&tenants[0]) != 0) {
+            printf("[Sandbox-Parent] WARNING: could not apply cgroup limits for tenant '%s'.\n", tenants[0].name);
         }
     }
-    
-    // Generate Log Filename with PID for uniqueness
-    char filename[128];
-    snprintf(filename, sizeof(filename), "logs/run_%d_%ld.json", child_pid, time(NULL));
-    log_telemetry(filename, &log_data, child_pid);
 
-    free(stack);
+    if (tests_dir) {
+        int tests_rc = testset_run(tests_dir, &spec, batch_workers);
+        if (tenant_count > 0 && tenants[0].cgroup[0]) cgroup_remove(tenants[0].cgroup);
+        return tests_rc;
+    }
+
+    int rc;
+    if (cache.dir) {
+        rc = cache_run(&cache, &spec);
+    } else {
+        sbx_handle_t *sandbox = sbx_spawn(&spec);
+        rc = sandbox ? sbx_wait(sandbox, NULL) : -1;
+    }
+    if (tenant_count > 0 && tenants[0].cgroup[0]) cgroup_remove(tenants[0].cgroup);
+    if (rc != 0) {
+        exit(1);
+    }
     return 0;
 }
-
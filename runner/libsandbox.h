@@ -0,0 +1,48 @@
+#ifndef LIBSANDBOX_H
+#define LIBSANDBOX_H
+
+#include "job.h"
+
+/**
+ * LIBSANDBOX (embeddable sandbox API)
+ *
+ * The launcher, batch mode and sandboxd all run jobs through this API; other
+ * programs can link libsandbox.a / libsandbox.so and do the same without
+ * exec-ing the launcher. A handle owns one sandboxed child:
+ *
+ *   sbx_config_t cfg;
+ *   sbx_config_init(&cfg);
+ *   cfg.binary_path = path; cfg.args = argv;
+ *   sbx_handle_t *h = sbx_spawn(&cfg);
+ *   while (sbx_poll(h, SBX_SAMPLE_MS) == 0) sbx_sample(h, NULL);
+ *   sbx_wait(h, &result);          // reaps, writes logs/run_<pid>_<t>.json
+ *
+ * Callers running many sandboxes poll the pidfds themselves (sbx_pidfd) and
+ * call sbx_sample on their own timer; a readable pidfd means sbx_wait will
+ * not block. Handles are independent: different threads may drive different
+ * handles. Where pidfd_open() is unavailable (Linux < 5.3) sbx_pidfd returns
+ * -1 and sbx_poll falls back to waitpid(WNOHANG) polling. A control socket
+ * (cfg.control_path) is served, and captured or verified output
+ * (cfg.capture_dir, cfg.expected_path) is drained, only inside sbx_poll
+ * (which sbx_wait calls); callers with their own loop must keep calling it.
+ * A writable /tmp (cfg.scratch_mb) is bound from cfg.scratch_pool, one pool
+ * shared by every handle (scratch.h), or mounted by the child without one.
+ */
+
+// Monitoring interval used by sbx_wait (and the launcher)
+#define SBX_SAMPLE_MS 100
+
+typedef job_spec_t sbx_config_t;
+typedef job_result_t sbx_result_t;
+typedef struct sbx_handle sbx_handle_t;
+
+// Function prototypes
+void sbx_config_init(sbx_config_t *config);
+sbx_handle_t *sbx_spawn(const sbx_config_t *config);
+int sbx_pidfd(const sbx_handle_t *h);
+pid_t sbx_pid(const sbx_handle_t *h);
+int sbx_poll(sbx_handle_t *h, int timeout_ms);
+int sbx_sample(sbx_handle_t *h, telemetry_sample_t *out);
+int sbx_wait(sbx_handle_t *h, sbx_result_t *result);
+
+#endif
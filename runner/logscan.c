@@ -0,0 +1,98 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include "logscan.h"
+
+/**
+ * LOG SCANNER (Shared by predict.c and policy-sim)
+ *
+ * Both read back thousands of telemetry logs, so this is a scan with strstr
+ * over the file held in memory rather than a JSON parser.
+ */
+
+// Whole file, NUL-terminated (free() it), or NULL if unreadable or empty
+char *logscan_load(const char *path) {
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return NULL;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        close(fd);
+        return NULL;
+    }
+
+    char *buf = malloc(st.st_size + 1);
+    ssize_t got = buf ? read(fd, buf, st.st_size) : -1;
+    close(fd);
+    if (got != st.st_size) {
+        free(buf);
+        return NULL;
+    }
+    buf[got] = '\0';
+    return buf;
+}
+
+// Pointer to the value following "key": at or after 'from', or NULL
+const char *logscan_find(const char *from, const char *key) {
+    char pattern[64];
+    snprintf(pattern, sizeof(pattern), "\"%s\"", key);
+
+    const char *p = strstr(from, pattern);
+    if (!p) return NULL;
+    p += strlen(pattern);
+    while (*p == ' ' || *p == ':') p++;
+    return p;
+}
+
+// String value with json_escape()'s escapes undone ("" if absent)
+void logscan_string(const char *from, const char *key, char *out, size_t len) {
+    out[0] = '\0';
+    const char *p = logscan_find(from, key);
+    if (!p || *p != '"') return;
+    p++;
+
+    size_t n = 0;
+    for (; *p && *p != '"' && n < len - 1; p++) {
+        char c = *p;
+        if (c == '\\' && p[1]) {
+            c = *++p;
+            if (c == 'n') c = '\n';
+            else if (c == 'r') c = '\r';
+            else if (c == 't') c = '\t';
+            else if (c == 'u' && strlen(p) >= 5) {
+                char hex[5] = { p[1], p[2], p[3], p[4], '\0' };
+                c = (char)strtol(hex, NULL, 16);
+                p += 4;
+            }
+        }
+        out[n++] = c;
+    }
+    out[n] = '\0';
+}
+
+long logscan_long(const char *from, const char *key, long fallback) {
+    const char *p = logscan_find(from, key);
+    return p ? strtol(p, NULL, 10) : fallback;
+}
+
+// Parse an integer array into out[0..max); returns count, or -1 if absent
+int logscan_array(const char *from, const char *key, long *out, int max) {
+    const char *p = logscan_find(from, key);
+    if (!p || *p != '[') return -1;
+    p++;
+
+    int n = 0;
+    while (*p && *p != ']') {
+        char *end;
+        long value = strtol(p, &end, 10);
+        if (end == p) break;
+        if (n < max) out[n++] = value;
+        p = end;
+        while (*p == ',' || *p == ' ') p++;
+    }
+    return n;
+}
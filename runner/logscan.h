@@ -0,0 +1,17 @@
+#ifndef LOGSCAN_H
+#define LOGSCAN_H
+
+#include <stddef.h>
+
+// Minimal reader for the launcher's own log format (log_telemetry): keys are
+// found by name, nesting is not tracked. Callers narrow the search by starting
+// from a section ("timeline", "summary") found with strstr.
+
+// Function prototypes
+char *logscan_load(const char *path);
+const char *logscan_find(const char *from, const char *key);
+void logscan_string(const char *from, const char *key, char *out, size_t len);
+long logscan_long(const char *from, const char *key, long fallback);
+int logscan_array(const char *from, const char *key, long *out, int max);
+
+#endif
@@ -0,0 +1,327 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <time.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include "metrics.h"
+#include "libsandbox.h"
+
+/**
+ * FLEET METRICS (--metrics=SOCKET, batch and daemon mode)
+ *
+ * Supervisor workers run jobs through metrics_run_job(), which counts
+ * launches, exits by reason and collector (sampling) cost, and feeds the
+ * launch latency, runtime and peak RSS histograms. Every thread updates a
+ * shard of its own with relaxed atomic adds, so the hot path takes no lock
+ * and shares no cache line; a scrape sums the shards.
+ *
+ * Batch mode also registers its admission queue, exported as gauges (depth,
+ * mean wait so far, gate state) and counters read at scrape time.
+ *
+ * The endpoint is a Unix socket answering any request with an HTTP/1.0
+ * response carrying OpenMetrics text, e.g.
+ *   curl --unix-socket logs/metrics.sock http://localhost/metrics
+ */
+
+#define LAUNCH_BUCKETS 9
+#define RUNTIME_BUCKETS 10
+#define RSS_BUCKETS 7
+
+static const double launch_bounds[LAUNCH_BUCKETS] = {   // Seconds
+    0.0005, 0.001, 0.002, 0.005, 0.01, 0.02, 0.05, 0.1, 0.25
+};
+static const double runtime_bounds[RUNTIME_BUCKETS] = { // Seconds
+    0.01, 0.05, 0.1, 0.5, 1, 5, 10, 30, 60, 300
+};
+static const double rss_bounds[RSS_BUCKETS] = {         // Bytes
+    1048576, 4194304, 16777216, 67108864, 268435456, 1073741824, 4294967296
+};
+
+// Exit reasons as job.c reports them (EXITED(n) counts as EXITED)
+static const char *exit_reasons[] = {
+    "EXITED", "TIME_LIMIT_EXCEEDED", "POLICY_ADAPATION_KILL", "SECURITY_VIOLATION",
+    "KILLED_BY_OS", "KILLED_BY_CONTROL", "WRONG_ANSWER", "SIGNALED", "OTHER"
+};
+#define EXIT_REASONS (int)(sizeof(exit_reasons) / sizeof(exit_reasons[0]))
+
+// Histogram: cumulative buckets are built at scrape time
+typedef struct {
+    atomic_ulong buckets[RUNTIME_BUCKETS + 1];  // Per bucket (last = +Inf); sized for the largest
+    atomic_ulong count;
+    atomic_ulong sum;                            // Sum in 1/scale of the unit (see observe)
+} histogram_t;
+
+typedef struct {
+    atomic_ulong launches;
+    atomic_ulong launch_failures;
+    atomic_ulong finished;
+    atomic_ulong exits[EXIT_REASONS];
+    atomic_ulong collector_us;
+    atomic_ulong samples;
+    histogram_t launch_latency;
+    histogram_t runtime;
+    histogram_t peak_rss;
+} __attribute__((aligned(64))) metrics_shard_t;
+
+static metrics_shard_t shards[METRICS_MAX_SHARDS + 1];     // Last: shared overflow
+static atomic_int shard_count;
+static __thread metrics_shard_t *my_shard;
+
+static int listen_fd = -1;
+static char listen_path[108];
+
+static pthread_mutex_t watch_lock = PTHREAD_MUTEX_INITIALIZER;
+static admission_t *watched;        // Batch admission queue (NULL = none)
+
+static metrics_shard_t *shard(void) {
+    if (!my_shard) {
+        int index = atomic_fetch_add_explicit(&shard_count, 1, memory_order_relaxed);
+        my_shard = &shards[index < METRICS_MAX_SHARDS ? index : METRICS_MAX_SHARDS];
+    }
+    return my_shard;
+}
+
+static void add(atomic_ulong *counter, unsigned long n) {
+    atomic_fetch_add_explicit(counter, n, memory_order_relaxed);
+}
+
+// The sum is kept in integer 1/scale units: microseconds for the seconds
+// histograms, whole bytes for peak RSS (a 64-bit sum of bytes in millionths
+// would wrap after about a hundred thousand 100 MB jobs)
+#define SECONDS_SCALE 1000000
+#define BYTES_SCALE 1
+
+static void observe(histogram_t *h, const double *bounds, int nbounds, unsigned long scale, double value) {
+    int b = 0;
+    while (b < nbounds && value > bounds[b]) b++;
+    add(&h->buckets[b], 1);
+    add(&h->count, 1);
+    add(&h->sum, (unsigned long)(value * scale));
+}
+
+static int exit_reason_index(const char *reason) {
+    if (strncmp(reason, "EXITED(", 7) == 0) return 0;
+    for (int i = 1; i < EXIT_REASONS - 1; i++) {
+        if (strcmp(reason, exit_reasons[i]) == 0) return i;
+    }
+    return EXIT_REASONS - 1;
+}
+
+// job_run() with accounting
+int metrics_run_job(const job_spec_t *spec, job_result_t *result) {
+    metrics_shard_t *s = shard();
+
+    struct timespec t0, t1;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    sbx_handle_t *h = sbx_spawn(spec);
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    if (!h) {
+        add(&s->launch_failures, 1);
+        return -1;
+    }
+    add(&s->launches, 1);
+    observe(&s->launch_latency, launch_bounds, LAUNCH_BUCKETS, SECONDS_SCALE,
+            (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9);
+
+    int rc = sbx_wait(h, result);
+    add(&s->finished, 1);
+    add(&s->exits[exit_reason_index(result->exit_reason)], 1);
+    add(&s->collector_us, result->collector_us);
+    add(&s->samples, result->samples);
+    observe(&s->runtime, runtime_bounds, RUNTIME_BUCKETS, SECONDS_SCALE, result->runtime_ms / 1000.0);
+    observe(&s->peak_rss, rss_bounds, RSS_BUCKETS, BYTES_SCALE, result->peak_rss_kb * 1024.0);
+    return rc;
+}
+
+// Export adm's queue from now on; NULL before it is destroyed
+void metrics_watch_admission(admission_t *adm) {
+    pthread_mutex_lock(&watch_lock);
+    watched = adm;
+    pthread_mutex_unlock(&watch_lock);
+}
+
+// -------------------------------------------------------------
+// Scrape
+// -------------------------------------------------------------
+
+static unsigned long sum_of(size_t offset) {
+    unsigned long total = 0;
+    int n = atomic_load_explicit(&shard_count, memory_order_relaxed);
+    if (n > METRICS_MAX_SHARDS) n = METRICS_MAX_SHARDS + 1;
+    for (int i = 0; i < n; i++) {
+        total += atomic_load_explicit((atomic_ulong *)((char *)&shards[i] + offset), memory_order_relaxed);
+    }
+    return total;
+}
+
+#define SUM(field) sum_of(offsetof(metrics_shard_t, field))
+
+static void write_counter(FILE *out, const char *name, const char *help, unsigned long value) {
+    fprintf(out, "# TYPE %s counter\n# HELP %s %s\n%s_total %lu\n", name, name, help, name, value);
+}
+
+static void write_gauge(FILE *out, const char *name, const char *unit, const char *help, double value) {
+    fprintf(out, "# TYPE %s gauge\n", name);
+    if (unit) fprintf(out, "# UNIT %s %s\n", name, unit);
+    fprintf(out, "# HELP %s %s\n%s %g\n", name, help, name, value);
+}
+
+static void write_admission(FILE *out) {
+    admission_stats_t st;
+    pthread_mutex_lock(&watch_lock);
+    if (watched) admission_stats(watched, &st);
+    pthread_mutex_unlock(&watch_lock);
+    if (!watched) return;
+
+    write_gauge(out, "sandbox_admission_queue_depth", NULL, "Jobs submitted and not started yet", st.depth);
+    write_gauge(out, "sandbox_admission_queue_depth_max", NULL, "Highest queue depth so far", st.max_depth);
+    write_gauge(out, "sandbox_admission_queue_wait_seconds", "seconds",
+                "Mean time the queued jobs have waited so far", st.waiting_mean_ms / 1000.0);
+    write_gauge(out, "sandbox_admission_holding", NULL, "1 while host pressure holds batch jobs", st.holding);
+    write_counter(out, "sandbox_admission_admitted", "Jobs taken out of the queue", st.admitted);
+    write_counter(out, "sandbox_admission_held", "Admitted jobs that had been held by host pressure", st.held);
+    write_counter(out, "sandbox_admission_bypassed", "Interactive jobs started past a closed gate", st.bypassed);
+    fprintf(out, "# TYPE sandbox_admission_wait_seconds counter\n# UNIT sandbox_admission_wait_seconds seconds\n"
+                 "# HELP sandbox_admission_wait_seconds Queue wait of admitted jobs\n");
+    fprintf(out, "sandbox_admission_wait_seconds_total %.3f\n", st.wait_sum_ms / 1000.0);
+}
+
+static void write_histogram(FILE *out, const char *name, const char *unit, const char *help, size_t offset,
+                            const double *bounds, int nbounds, unsigned long scale) {
+    fprintf(out, "# TYPE %s histogram\n# UNIT %s %s\n# HELP %s %s\n", name, name, unit, name, help);
+    unsigned long cumulative = 0;
+    for (int b = 0; b <= nbounds; b++) {
+        cumulative += sum_of(offset + offsetof(histogram_t, buckets) + b * sizeof(atomic_ulong));
+        if (b < nbounds) {
+            fprintf(out, "%s_bucket{le=\"%g\"} %lu\n", name, bounds[b], cumulative);
+        } else {
+            fprintf(out, "%s_bucket{le=\"+Inf\"} %lu\n", name, cumulative);
+        }
+    }
+    fprintf(out, "%s_count %lu\n", name, sum_of(offset + offsetof(histogram_t, count)));
+    fprintf(out, "%s_sum %.6f\n", name, (double)sum_of(offset + offsetof(histogram_t, sum)) / scale);
+}
+
+static char *render(size_t *len) {
+    char *text = NULL;
+    FILE *out = open_memstream(&text, len);
+    if (!out) return NULL;
+
+    unsigned long launches = SUM(launches), finished = SUM(finished);
+    write_counter(out, "sandbox_launches", "Sandboxes started", launches);
+    write_counter(out, "sandbox_launch_failures", "Sandboxes that could not be created", SUM(launch_failures));
+    fprintf(out, "# TYPE sandbox_active gauge\n# HELP sandbox_active Sandboxes running now\n");
+    fprintf(out, "sandbox_active %lu\n", launches > finished ? launches - finished : 0);
+
+    fprintf(out, "# TYPE sandbox_exits counter\n# HELP sandbox_exits Finished sandboxes by exit reason\n");
+    for (int i = 0; i < EXIT_REASONS; i++) {
+        fprintf(out, "sandbox_exits_total{reason=\"%s\"} %lu\n", exit_reasons[i],
+                sum_of(offsetof(metrics_shard_t, exits) + i * sizeof(atomic_ulong)));
+    }
+
+    fprintf(out, "# TYPE sandbox_collector_seconds counter\n# UNIT sandbox_collector_seconds seconds\n"
+                 "# HELP sandbox_collector_seconds Time spent sampling /proc for running sandboxes\n");
+    fprintf(out, "sandbox_collector_seconds_total %.6f\n", SUM(collector_us) / 1e6);
+    write_counter(out, "sandbox_samples", "Monitoring samples taken", SUM(samples));
+
+    write_histogram(out, "sandbox_launch_latency_seconds", "seconds", "sbx_spawn() to child running",
+                    offsetof(metrics_shard_t, launch_latency), launch_bounds, LAUNCH_BUCKETS, SECONDS_SCALE);
+    write_histogram(out, "sandbox_runtime_seconds", "seconds", "Wall time of finished sandboxes",
+                    offsetof(metrics_shard_t, runtime), runtime_bounds, RUNTIME_BUCKETS, SECONDS_SCALE);
+    write_histogram(out, "sandbox_peak_rss_bytes", "bytes", "Resident high-water mark (VmHWM) of finished sandboxes",
+                    offsetof(metrics_shard_t, peak_rss), rss_bounds, RSS_BUCKETS, BYTES_SCALE);
+    write_admission(out);
+    fprintf(out, "# EOF\n");
+    fclose(out);
+    return text;
+}
+
+static void *serve_main(void *arg) {
+    (void)arg;
+    for (;;) {
+        int fd = accept4(listen_fd, NULL, NULL, SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) continue;
+            break;      // metrics_close()
+        }
+
+        // The request itself does not matter; give the client a moment to send it
+        char request[1024];
+        struct pollfd pfd = { fd, POLLIN, 0 };
+        if (poll(&pfd, 1, 200) > 0) {
+            ssize_t ignored = recv(fd, request, sizeof(request), MSG_DONTWAIT);
+            (void)ignored;
+        }
+
+        size_t len = 0;
+        char *body = render(&len);
+        if (body) {
+            char header[160];
+            int hlen = snprintf(header, sizeof(header),
+                                "HTTP/1.0 200 OK\r\nContent-Type: application/openmetrics-text; version=1.0.0; "
+                                "charset=utf-8\r\nContent-Length: %zu\r\n\r\n", len);
+            if (send(fd, header, hlen, MSG_NOSIGNAL) == hlen) {
+                ssize_t ignored = send(fd, body, len, MSG_NOSIGNAL);
+                (void)ignored;
+            }
+            free(body);
+        }
+        close(fd);
+    }
+    return NULL;
+}
+
+// Serve scrapes on a Unix socket from a thread of its own
+int metrics_serve(const char *socket_path) {
+    struct sockaddr_un addr = { .sun_family = AF_UNIX };
+    if (strlen(socket_path) >= sizeof(addr.sun_path)) {
+        fprintf(stderr, "[Metrics] Socket path too long: %s\n", socket_path);
+        return -1;
+    }
+    snprintf(addr.sun_path, sizeof(addr.sun_path), "%s", socket_path);
+
+    listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (listen_fd < 0) {
+        perror("metrics socket");
+        return -1;
+    }
+    unlink(socket_path);
+    if (bind(listen_fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 || listen(listen_fd, 16) != 0) {
+        perror(socket_path);
+        close(listen_fd);
+        listen_fd = -1;
+        return -1;
+    }
+    snprintf(listen_path, sizeof(listen_path), "%s", socket_path);
+
+    pthread_t thread;
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    int rc = pthread_create(&thread, &attr, serve_main, NULL);
+    pthread_attr_destroy(&attr);
+    if (rc != 0) {
+        metrics_close();
+        return -1;
+    }
+    fprintf(stderr, "[Metrics] OpenMetrics endpoint on %s\n", socket_path);
+    return 0;
+}
+
+void metrics_close(void) {
+    if (listen_fd < 0) return;
+    // Wakes the server thread out of accept()
+    shutdown(listen_fd, SHUT_RDWR);
+    close(listen_fd);
+    listen_fd = -1;
+    unlink(listen_path);
+}
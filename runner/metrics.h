@@ -0,0 +1,15 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include "job.h"
+#include "admission.h"
+
+#define METRICS_MAX_SHARDS 128      // Threads with a shard of their own; later ones share one
+
+// Function prototypes
+int metrics_run_job(const job_spec_t *spec, job_result_t *result);
+int metrics_serve(const char *socket_path);
+void metrics_close(void);
+void metrics_watch_admission(admission_t *adm);
+
+#endif
@@ -0,0 +1,303 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <time.h>
+#include <sys/ioctl.h>
+#include "pipeline.h"
+#include "libsandbox.h"
+#include "telemetry.h"
+
+/**
+ * SANDBOXED PIPELINES (--pipeline "a | b | c")
+ *
+ * Every stage runs in its own sandbox (libsandbox). Stages are not joined
+ * directly: stage i writes into one pipe, stage i+1 reads from another, and
+ * the launcher moves data from the first to the second with splice(), which
+ * never copies it through user space. Sitting in the middle lets us count
+ * the bytes on every link and time how long each link was
+ *   - full:    data queued, downstream not reading (the upstream stage
+ *              blocks once its pipe fills), or
+ *   - starved: nothing to move (the downstream stage waits for input).
+ * Both pipes of a link are sized with F_SETPIPE_SZ.
+ */
+
+#define MAX_ARGS 64
+#define DEFAULT_PIPE_SIZE (1024 * 1024)     // pipe-max-size for unprivileged users
+
+typedef enum {
+    LINK_WAIT_IN,       // Upstream pipe empty
+    LINK_WAIT_OUT,      // Downstream pipe full
+    LINK_DONE
+} link_state_t;
+
+// Data path from stage i to stage i+1
+typedef struct {
+    int in;             // Read end of stage i's stdout
+    int out;            // Write end of stage i+1's stdin
+    link_state_t state;
+    long since_ms;
+    unsigned long long bytes;
+    long full_ms;
+    long starved_ms;
+} link_t;
+
+typedef struct {
+    char *argv[MAX_ARGS + 1];
+    sbx_handle_t *handle;       // NULL once waited
+    sbx_result_t result;
+    int stdin_fd;               // Child ends, closed once it is spawned
+    int stdout_fd;
+} stage_t;
+
+// Split "a x | b y" into stages; 'buf' is modified and must outlive them
+static int parse_stages(char *buf, stage_t *stages) {
+    int count = 0;
+    char *save_stage;
+    for (char *part = strtok_r(buf, "|", &save_stage); part; part = strtok_r(NULL, "|", &save_stage)) {
+        if (count == MAX_STAGES) return -1;
+        stage_t *st = &stages[count];
+        int argc = 0;
+        char *save_arg;
+        for (char *arg = strtok_r(part, " \t", &save_arg); arg; arg = strtok_r(NULL, " \t", &save_arg)) {
+            if (argc == MAX_ARGS) return -1;
+            st->argv[argc++] = arg;
+        }
+        if (argc == 0) return -1;
+        st->argv[argc] = NULL;
+        count++;
+    }
+    return count;
+}
+
+// Grow the pipe; the kernel keeps the default where it refuses
+static int set_pipe_size(int fd, int size) {
+    fcntl(fd, F_SETPIPE_SZ, size);
+    return fcntl(fd, F_GETPIPE_SZ);
+}
+
+static void close_link(link_t *l) {
+    close(l->in);
+    close(l->out);
+    l->state = LINK_DONE;
+}
+
+// Move everything that can move without blocking, then record what the
+// link is waiting for
+static void relay(link_t *l, long now) {
+    if (l->state == LINK_WAIT_IN) {
+        l->starved_ms += now - l->since_ms;
+    } else {
+        l->full_ms += now - l->since_ms;
+    }
+    l->since_ms = now;
+
+    for (;;) {
+        ssize_t n = splice(l->in, NULL, l->out, NULL, DEFAULT_PIPE_SIZE, SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+        if (n > 0) {
+            l->bytes += n;
+            continue;
+        }
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && errno == EAGAIN) {
+            int queued = 0;
+            ioctl(l->in, FIONREAD, &queued);
+            l->state = queued > 0 ? LINK_WAIT_OUT : LINK_WAIT_IN;
+            return;
+        }
+        // EOF from upstream (passed on by closing downstream's stdin), or
+        // EPIPE: downstream exited, so upstream's writes fail next
+        close_link(l);
+        return;
+    }
+}
+
+static int write_log(const char *path, const stage_t *stages, const link_t *links, int count, int pipe_size,
+                     long total_ms, int bottleneck) {
+    FILE *fp = fopen(path, "w");
+    if (!fp) {
+        perror("fopen pipeline log");
+        return -1;
+    }
+
+    fprintf(fp, "{\n  \"pipe_size\": %d,\n  \"total_ms\": %ld,\n  \"bottleneck_stage\": %d,\n  \"stages\": [\n",
+            pipe_size, total_ms, bottleneck);
+    for (int i = 0; i < count; i++) {
+        const sbx_result_t *r = &stages[i].result;
+        const link_t *up = i > 0 ? &links[i - 1] : NULL;
+        const link_t *down = i < count - 1 ? &links[i] : NULL;
+        char program[JSON_STR_MAX], log[JSON_STR_MAX];
+        fprintf(fp, "    {\"index\": %d, \"program\": \"%s\", \"exit_reason\": \"%s\", \"runtime_ms\": %ld, "
+                    "\"cpu_time_ms\": %ld, \"peak_memory_kb\": %ld, \"log\": \"%s\", "
+                    "\"bytes_in\": %llu, \"waiting_input_ms\": %ld, \"bytes_out\": %llu, \"blocked_output_ms\": %ld}%s\n",
+                i, json_escape(stages[i].argv[0], program, sizeof(program)), r->exit_reason, r->runtime_ms,
+                r->cpu_time_ms, r->memory_peak_kb, json_escape(r->log_path, log, sizeof(log)),
+                up ? up->bytes : 0ULL, up ? up->starved_ms : 0L, down ? down->bytes : 0ULL, down ? down->full_ms : 0L,
+                i < count - 1 ? "," : "");
+    }
+    fprintf(fp, "  ]\n}\n");
+    fclose(fp);
+    return 0;
+}
+
+int pipeline_run(const char *pipeline_spec, const job_spec_t *defaults, int pipe_size) {
+    static stage_t stages[MAX_STAGES];
+    link_t links[MAX_STAGES - 1];
+    char *buf = strdup(pipeline_spec);
+    int count = parse_stages(buf, stages);
+    if (count < 1) {
+        fprintf(stderr, "[Pipeline] Invalid pipeline: %s\n", pipeline_spec);
+        free(buf);
+        return 1;
+    }
+    if (pipe_size <= 0) pipe_size = DEFAULT_PIPE_SIZE;
+
+    // Two pipes per link: stage i -> launcher -> stage i+1
+    int actual_size = pipe_size;
+    for (int i = 0; i < count; i++) {
+        stages[i].stdin_fd = -1;
+        stages[i].stdout_fd = -1;
+    }
+    for (int i = 0; i < count - 1; i++) {
+        int up[2], down[2];
+        if (pipe2(up, O_CLOEXEC) != 0 || pipe2(down, O_CLOEXEC) != 0) {
+            perror("pipe");
+            free(buf);
+            return 1;
+        }
+        int got_up = set_pipe_size(up[1], pipe_size);
+        int got_down = set_pipe_size(down[1], pipe_size);
+        if (got_up < actual_size) actual_size = got_up;
+        if (got_down < actual_size) actual_size = got_down;
+
+        stages[i].stdout_fd = up[1];
+        stages[i + 1].stdin_fd = down[0];
+        links[i] = (link_t){ up[0], down[1], LINK_WAIT_IN, 0, 0, 0, 0 };
+    }
+
+    // A stage exiting early must not take the launcher down with it
+    signal(SIGPIPE, SIG_IGN);
+
+    long start = get_current_time_ms();
+    int running = 0;
+    for (int i = 0; i < count; i++) {
+        job_spec_t spec = *defaults;
+        spec.quiet = 1;
+        spec.binary_path = stages[i].argv[0];
+        spec.args = stages[i].argv;
+        spec.stdin_fd = stages[i].stdin_fd;
+        spec.stdout_fd = stages[i].stdout_fd;
+        snprintf(spec.id, sizeof(spec.id), "stage%d", i);
+
+        stages[i].handle = sbx_spawn(&spec);
+        if (stages[i].stdin_fd >= 0) close(stages[i].stdin_fd);
+        if (stages[i].stdout_fd >= 0) close(stages[i].stdout_fd);
+        if (!stages[i].handle) {
+            fprintf(stderr, "[Pipeline] Could not start stage %d (%s)\n", i, stages[i].argv[0]);
+            snprintf(stages[i].result.exit_reason, sizeof(stages[i].result.exit_reason), "NOT_STARTED");
+            continue;
+        }
+        running++;
+    }
+    for (int i = 0; i < count - 1; i++) links[i].since_ms = get_current_time_ms();
+
+    fprintf(stderr, "[Pipeline] %d stage(s) running, %d-byte pipes\n", count, actual_size);
+
+    // One loop drives the links (splice) and the sandboxes (pidfd + samples)
+    long next_sample = get_current_time_ms() + SBX_SAMPLE_MS;
+    int open_links = count - 1;
+    while (running > 0 || open_links > 0) {
+        struct pollfd pfd[2 * MAX_STAGES];
+        int owner[2 * MAX_STAGES];      // >= 0: link index, < 0: -(stage + 1)
+        int n = 0;
+        for (int i = 0; i < count - 1; i++) {
+            if (links[i].state == LINK_DONE) continue;
+            pfd[n] = (struct pollfd){ links[i].state == LINK_WAIT_IN ? links[i].in : links[i].out,
+                                      links[i].state == LINK_WAIT_IN ? POLLIN : POLLOUT, 0 };
+            owner[n++] = i;
+        }
+        for (int i = 0; i < count; i++) {
+            if (!stages[i].handle || sbx_pidfd(stages[i].handle) < 0) continue;
+            pfd[n] = (struct pollfd){ sbx_pidfd(stages[i].handle), POLLIN, 0 };
+            owner[n++] = -(i + 1);
+        }
+
+        long now = get_current_time_ms();
+        int timeout = next_sample > now ? (int)(next_sample - now) : 0;
+        if (poll(pfd, n, timeout) < 0 && errno != EINTR) {
+            perror("poll");
+            break;
+        }
+        now = get_current_time_ms();
+
+        for (int k = 0; k < n; k++) {
+            if (!pfd[k].revents || owner[k] < 0) continue;
+            relay(&links[owner[k]], now);
+            if (links[owner[k]].state == LINK_DONE) open_links--;
+        }
+
+        int tick = now >= next_sample;
+        if (tick) next_sample = now + SBX_SAMPLE_MS;
+        for (int i = 0; i < count; i++) {
+            stage_t *st = &stages[i];
+            if (!st->handle) continue;
+            int ended = sbx_poll(st->handle, 0);
+            if (!ended && tick) ended = sbx_sample(st->handle, NULL) != 0;
+            if (!ended) continue;
+            sbx_wait(st->handle, &st->result);
+            st->handle = NULL;
+            running--;
+        }
+
+        // Nobody left to read or write the links: pass on what is queued, drop the rest
+        if (running == 0) {
+            for (int i = 0; i < count - 1; i++) {
+                if (links[i].state == LINK_DONE) continue;
+                relay(&links[i], now);
+                if (links[i].state != LINK_DONE) close_link(&links[i]);
+                open_links--;
+            }
+        }
+    }
+    long total_ms = get_current_time_ms() - start;
+
+    // The slowest stage is the one its neighbours wait on: its input link
+    // backs up and its output link runs dry
+    int bottleneck = 0;
+    long worst = -1;
+    int ok = 0;
+    for (int i = 0; i < count; i++) {
+        const sbx_result_t *r = &stages[i].result;
+        long up_full = i > 0 ? links[i - 1].full_ms : 0;
+        long down_starved = i < count - 1 ? links[i].starved_ms : 0;
+        if (count > 1 && up_full + down_starved > worst) {
+            worst = up_full + down_starved;
+            bottleneck = i;
+        }
+        ok += strcmp(r->exit_reason, "EXITED(0)") == 0;
+
+        fprintf(stderr, "[Pipeline] stage %d %-20s %-20s %6ld ms %6ld ms CPU %8ld KB", i, stages[i].argv[0],
+                r->exit_reason, r->runtime_ms, r->cpu_time_ms, r->memory_peak_kb);
+        if (i > 0) fprintf(stderr, " | in %llu B, waited %ld ms", links[i - 1].bytes, links[i - 1].starved_ms);
+        if (i < count - 1) fprintf(stderr, " | out %llu B, blocked %ld ms", links[i].bytes, links[i].full_ms);
+        fprintf(stderr, "\n");
+    }
+    if (count > 1) {
+        fprintf(stderr, "[Pipeline] Bottleneck: stage %d (%s), %ld ms of waiting around it; total %ld ms\n",
+                bottleneck, stages[bottleneck].argv[0], worst, total_ms);
+    }
+
+    char log_path[128];
+    snprintf(log_path, sizeof(log_path), "logs/pipeline_%d_%ld.json", getpid(), (long)time(NULL));
+    if (write_log(log_path, stages, links, count, actual_size, total_ms, count > 1 ? bottleneck : -1) == 0) {
+        fprintf(stderr, "[Pipeline] Log written to %s\n", log_path);
+    }
+
+    free(buf);
+    return ok == count ? 0 : 1;
+}
@@ -0,0 +1,11 @@
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include "job.h"
+
+#define MAX_STAGES 16
+
+// Run "prog args | prog args | ..." with every stage in its own sandbox
+int pipeline_run(const char *pipeline_spec, const job_spec_t *defaults, int pipe_size);
+
+#endif
@@ -0,0 +1,69 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "policy.h"
+
+// Thresholds the launcher has always used (Arbitrary for demo):
+// ~2 seconds of full CPU, or more than 1000 major faults.
+void policy_default(policy_config_t *cfg) {
+    memset(cfg, 0, sizeof(*cfg));
+    snprintf(cfg->name, sizeof(cfg->name), "default");
+    cfg->cpu_ms_threshold = 2000;
+    cfg->majflt_threshold = 1000;
+    cfg->memory_kb_threshold = 0;
+}
+
+// Parse "name:cpu_ms=1500,majflt=500,mem_kb=65536".
+// The name prefix is optional; omitted keys keep their default values.
+int policy_parse(const char *spec, policy_config_t *cfg) {
+    policy_default(cfg);
+
+    char buf[256];
+    snprintf(buf, sizeof(buf), "%s", spec);
+
+    char *body = buf;
+    char *colon = strchr(buf, ':');
+    if (colon) {
+        *colon = '\0';
+        snprintf(cfg->name, sizeof(cfg->name), "%.31s", buf);
+        body = colon + 1;
+    } else if (!strchr(buf, '=')) {
+        snprintf(cfg->name, sizeof(cfg->name), "%.31s", buf);
+        return 0;
+    } else {
+        snprintf(cfg->name, sizeof(cfg->name), "%.31s", spec);
+    }
+
+    char *saveptr = NULL;
+    for (char *tok = strtok_r(body, ",", &saveptr); tok; tok = strtok_r(NULL, ",", &saveptr)) {
+        char *eq = strchr(tok, '=');
+        if (!eq) return -1;
+        *eq = '\0';
+        char *end;
+        long value = strtol(eq + 1, &end, 10);
+        if (*end != '\0' || value < 0) return -1;
+
+        if (strcmp(tok, "cpu_ms") == 0) {
+            cfg->cpu_ms_threshold = value;
+        } else if (strcmp(tok, "majflt") == 0) {
+            cfg->majflt_threshold = (unsigned long)value;
+        } else if (strcmp(tok, "mem_kb") == 0) {
+            cfg->memory_kb_threshold = value;
+        } else {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+// Returns the first threshold crossed, or NULL if the sample is acceptable
+const char *policy_kill_reason(const policy_config_t *cfg, const policy_input_t *in) {
+    if (cfg->cpu_ms_threshold > 0 && in->cpu_ms > cfg->cpu_ms_threshold) return "cpu";
+    if (cfg->majflt_threshold > 0 && in->majflt > cfg->majflt_threshold) return "majflt";
+    if (cfg->memory_kb_threshold > 0 && in->memory_kb > cfg->memory_kb_threshold) return "memory";
+    return NULL;
+}
+
+policy_action_t policy_evaluate(const policy_config_t *cfg, const policy_input_t *in) {
+    return policy_kill_reason(cfg, in) ? POLICY_KILL : POLICY_ALLOW;
+}
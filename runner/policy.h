@@ -0,0 +1,37 @@
+#ifndef POLICY_H
+#define POLICY_H
+
+// -------------------------------------------------------------
+// DYNAMIC POLICY ADAPTATION (shared by launcher and policy-sim)
+// The launcher evaluates the policy on every live sample; policy-sim
+// replays recorded timelines through the exact same function.
+// -------------------------------------------------------------
+
+typedef enum {
+    POLICY_ALLOW,
+    POLICY_KILL
+} policy_action_t;
+
+// Thresholds of a LEARNING-mode policy. A threshold of 0 disables the check.
+typedef struct {
+    char name[32];
+    long cpu_ms_threshold;          // Cumulative CPU time (utime + stime)
+    unsigned long majflt_threshold; // Cumulative major page faults
+    long memory_kb_threshold;       // VmPeak
+} policy_config_t;
+
+// What the policy sees at one sample tick (all values cumulative)
+typedef struct {
+    long time_ms;
+    long cpu_ms;
+    unsigned long majflt;
+    long memory_kb;
+} policy_input_t;
+
+// Function prototypes
+void policy_default(policy_config_t *cfg);
+int policy_parse(const char *spec, policy_config_t *cfg);
+policy_action_t policy_evaluate(const policy_config_t *cfg, const policy_input_t *in);
+const char *policy_kill_reason(const policy_config_t *cfg, const policy_input_t *in);
+
+#endif
@@ -0,0 +1,332 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <time.h>
+#include <sys/stat.h>
+#include "policy.h"
+#include "logscan.h"
+
+/**
+ * OFFLINE POLICY SIMULATOR
+ *
+ * Loads the telemetry corpus (the JSON files in logs/) once, then replays every
+ * timeline through policy_evaluate() from policy.c - the same code the
+ * launcher runs live - for each candidate policy.
+ *
+ * Reports, per policy, which runs would have been killed and at which
+ * sample, plus false positives against benign labels.
+ */
+
+#define MAX_POLICIES 256
+
+typedef enum {
+    LABEL_UNKNOWN,
+    LABEL_BENIGN,
+    LABEL_MALICIOUS
+} run_label_t;
+
+// One recorded run, reduced to the policy inputs
+typedef struct {
+    char file[512];
+    char program[256];
+    char profile[32];
+    char exit_reason[32];
+    run_label_t label;
+    int sample_count;
+    policy_input_t *samples;
+} sim_run_t;
+
+// Program -> label overrides from --labels
+typedef struct {
+    char program[256];
+    run_label_t label;
+} label_entry_t;
+
+static const char *label_name(run_label_t label) {
+    switch (label) {
+        case LABEL_BENIGN: return "benign";
+        case LABEL_MALICIOUS: return "malicious";
+        default: return "unknown";
+    }
+}
+
+static double now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+static run_label_t label_from_exit(const char *exit_reason) {
+    // Mirrors the auto-labeling in dashboard/ml_model.py
+    if (strstr(exit_reason, "VIOLATION")) return LABEL_MALICIOUS;
+    if (strstr(exit_reason, "KILL") || strstr(exit_reason, "ADAPATION")) return LABEL_MALICIOUS;
+    if (strcmp(exit_reason, "EXITED(0)") == 0) return LABEL_BENIGN;
+    return LABEL_UNKNOWN;
+}
+
+static int load_run(const char *path, sim_run_t *run) {
+    char *buf = logscan_load(path);
+    if (!buf) return -1;
+    // A cache hit repeats an earlier run's timeline; replay that run once
+    if (strstr(buf, "\"cached\": true")) {
+        free(buf);
+        return -1;
+    }
+
+    memset(run, 0, sizeof(*run));
+    snprintf(run->file, sizeof(run->file), "%s", path);
+    logscan_string(buf, "program", run->program, sizeof(run->program));
+    logscan_string(buf, "profile", run->profile, sizeof(run->profile));
+
+    const char *timeline = strstr(buf, "\"timeline\"");
+    const char *summary = strstr(buf, "\"summary\"");
+    if (!timeline || !summary) {
+        free(buf);
+        return -1;
+    }
+    logscan_string(summary, "exit_reason", run->exit_reason, sizeof(run->exit_reason));
+    run->label = label_from_exit(run->exit_reason);
+
+    // Timeline arrays are at most MAX_SAMPLES long (see telemetry.h)
+    static long cols[1000 * 5];
+    long *time_ms = cols, *cpu_pct = cols + 1000, *cpu_ms = cols + 2000;
+    long *majflt = cols + 3000, *mem_kb = cols + 4000;
+
+    int n = logscan_array(timeline, "time_ms", time_ms, 1000);
+    int n_cpu_ms = logscan_array(timeline, "cpu_time_ms", cpu_ms, 1000);
+    int n_majflt = logscan_array(timeline, "page_faults_major", majflt, 1000);
+    int n_pct = logscan_array(timeline, "cpu_percent", cpu_pct, 1000);
+    int n_mem = logscan_array(timeline, "memory_kb", mem_kb, 1000);
+
+    if (n <= 0) {
+        free(buf);
+        return n == 0 ? 0 : -1;
+    }
+
+    // Logs written before cpu_time_ms/page_faults_major existed: rebuild
+    // CPU time from the cumulative cpu_percent, and apply the final fault
+    // count from the summary at the last sample.
+    long summary_majflt = logscan_long(summary, "page_faults_major", 0);
+
+    run->samples = malloc(sizeof(policy_input_t) * n);
+    run->sample_count = n;
+    for (int i = 0; i < n; i++) {
+        policy_input_t *s = &run->samples[i];
+        s->time_ms = time_ms[i];
+        if (n_cpu_ms > i) {
+            s->cpu_ms = cpu_ms[i];
+        } else {
+            s->cpu_ms = (n_pct > i) ? cpu_pct[i] * time_ms[i] / 100 : 0;
+        }
+        if (n_majflt > i) {
+            s->majflt = (unsigned long)majflt[i];
+        } else {
+            s->majflt = (i == n - 1) ? (unsigned long)summary_majflt : 0;
+        }
+        s->memory_kb = (n_mem > i) ? mem_kb[i] : 0;
+    }
+
+    free(buf);
+    return 0;
+}
+
+static int load_labels(const char *path, label_entry_t **out, int *count) {
+    FILE *fp = fopen(path, "r");
+    if (!fp) {
+        perror("fopen labels");
+        return -1;
+    }
+
+    int cap = 64;
+    *out = malloc(sizeof(label_entry_t) * cap);
+    *count = 0;
+
+    char program[256], label[32];
+    while (fscanf(fp, "%255s %31s", program, label) == 2) {
+        if (*count == cap) {
+            cap *= 2;
+            *out = realloc(*out, sizeof(label_entry_t) * cap);
+        }
+        label_entry_t *e = &(*out)[(*count)++];
+        snprintf(e->program, sizeof(e->program), "%s", program);
+        e->label = strcmp(label, "benign") == 0 ? LABEL_BENIGN :
+                   strcmp(label, "malicious") == 0 ? LABEL_MALICIOUS : LABEL_UNKNOWN;
+    }
+    fclose(fp);
+    return 0;
+}
+
+// Label lookup matches the full program path or its basename
+static void apply_labels(sim_run_t *runs, int run_count, const label_entry_t *labels, int label_count) {
+    for (int i = 0; i < run_count; i++) {
+        const char *base = strrchr(runs[i].program, '/');
+        base = base ? base + 1 : runs[i].program;
+        for (int j = 0; j < label_count; j++) {
+            if (strcmp(labels[j].program, runs[i].program) == 0 || strcmp(labels[j].program, base) == 0) {
+                runs[i].label = labels[j].label;
+                break;
+            }
+        }
+    }
+}
+
+// Expand "key=start:stop:step" into policies based on the defaults
+static int expand_sweep(const char *sweep, policy_config_t *policies, int count) {
+    char key[32];
+    long start, stop, step;
+    if (sscanf(sweep, "%31[^=]=%ld:%ld:%ld", key, &start, &stop, &step) != 4 || step <= 0) {
+        fprintf(stderr, "Invalid sweep: %s (expected key=start:stop:step)\n", sweep);
+        return -1;
+    }
+
+    for (long v = start; v <= stop && count < MAX_POLICIES; v += step) {
+        char spec[96];
+        snprintf(spec, sizeof(spec), "%s=%ld", key, v);
+        if (policy_parse(spec, &policies[count]) != 0) {
+            fprintf(stderr, "Invalid sweep key: %s\n", key);
+            return -1;
+        }
+        count++;
+    }
+    return count;
+}
+
+static void print_usage(const char *prog) {
+    fprintf(stderr, "Usage: %s [--logs DIR] [--labels FILE] [--profile NAME] [--quiet]\n", prog);
+    fprintf(stderr, "          [--policy SPEC]... [--sweep key=start:stop:step]...\n");
+    fprintf(stderr, "  SPEC uses the launcher's --policy syntax, e.g. \"tight:cpu_ms=1500,majflt=500\"\n");
+    fprintf(stderr, "  Labels file: one \"<program> benign|malicious\" per line (default: from exit_reason)\n");
+}
+
+int main(int argc, char *argv[]) {
+    const char *log_dir = "logs";
+    const char *labels_path = NULL;
+    const char *profile_filter = NULL;
+    int quiet = 0;
+
+    policy_config_t *policies = calloc(MAX_POLICIES, sizeof(policy_config_t));
+    int policy_count = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--logs") == 0 && i + 1 < argc) {
+            log_dir = argv[++i];
+        } else if (strcmp(argv[i], "--labels") == 0 && i + 1 < argc) {
+            labels_path = argv[++i];
+        } else if (strcmp(argv[i], "--profile") == 0 && i + 1 < argc) {
+            profile_filter = argv[++i];
+        } else if (strcmp(argv[i], "--quiet") == 0) {
+            quiet = 1;
+        } else if (strcmp(argv[i], "--policy") == 0 && i + 1 < argc && policy_count < MAX_POLICIES) {
+            if (policy_parse(argv[++i], &policies[policy_count]) != 0) {
+                fprintf(stderr, "Invalid policy spec: %s\n", argv[i]);
+                return 1;
+            }
+            policy_count++;
+        } else if (strcmp(argv[i], "--sweep") == 0 && i + 1 < argc) {
+            policy_count = expand_sweep(argv[++i], policies, policy_count);
+            if (policy_count < 0) return 1;
+        } else {
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (policy_count == 0) {
+        policy_default(&policies[policy_count++]);
+    }
+
+    // 1. Load corpus
+    double load_start = now_ms();
+
+    DIR *dir = opendir(log_dir);
+    if (!dir) {
+        perror("opendir logs");
+        return 1;
+    }
+
+    int cap = 1024, run_count = 0;
+    sim_run_t *runs = malloc(sizeof(sim_run_t) * cap);
+    struct dirent *ent;
+    while ((ent = readdir(dir)) != NULL) {
+        size_t len = strlen(ent->d_name);
+        if (len < 5 || strcmp(ent->d_name + len - 5, ".json") != 0) continue;
+
+        if (run_count == cap) {
+            cap *= 2;
+            runs = realloc(runs, sizeof(sim_run_t) * cap);
+        }
+
+        char path[512];
+        snprintf(path, sizeof(path), "%s/%s", log_dir, ent->d_name);
+        if (load_run(path, &runs[run_count]) != 0) continue;
+        if (profile_filter && strcmp(runs[run_count].profile, profile_filter) != 0) {
+            free(runs[run_count].samples);
+            continue;
+        }
+        run_count++;
+    }
+    closedir(dir);
+
+    if (labels_path) {
+        label_entry_t *labels = NULL;
+        int label_count = 0;
+        if (load_labels(labels_path, &labels, &label_count) != 0) return 1;
+        apply_labels(runs, run_count, labels, label_count);
+        free(labels);
+    }
+
+    double load_ms = now_ms() - load_start;
+    printf("[Policy-Sim] Loaded %d runs from %s/ in %.1f ms\n", run_count, log_dir, load_ms);
+
+    // 2. Replay every run through every candidate policy
+    double replay_start = now_ms();
+    printf("\n%-24s | %10s %8s %10s | %6s %6s %6s %6s\n",
+           "Policy", "cpu_ms", "majflt", "mem_kb", "Killed", "TP", "FP", "Missed");
+
+    for (int p = 0; p < policy_count; p++) {
+        const policy_config_t *policy = &policies[p];
+        int killed = 0, true_pos = 0, false_pos = 0, missed = 0;
+
+        for (int r = 0; r < run_count; r++) {
+            const sim_run_t *run = &runs[r];
+            int kill_at = -1;
+            for (int i = 0; i < run->sample_count; i++) {
+                if (policy_evaluate(policy, &run->samples[i]) == POLICY_KILL) {
+                    kill_at = i;
+                    break;
+                }
+            }
+
+            if (kill_at >= 0) {
+                killed++;
+                if (run->label == LABEL_BENIGN) false_pos++;
+                if (run->label == LABEL_MALICIOUS) true_pos++;
+                if (!quiet) {
+                    printf("  KILL %-40s %-24s at %6ld ms (%s) [%s]\n", run->file, run->program,
+                           run->samples[kill_at].time_ms,
+                           policy_kill_reason(policy, &run->samples[kill_at]), label_name(run->label));
+                }
+            } else if (run->label == LABEL_MALICIOUS) {
+                missed++;
+            }
+        }
+
+        printf("%-24s | %10ld %8lu %10ld | %6d %6d %6d %6d\n", policy->name,
+               policy->cpu_ms_threshold, policy->majflt_threshold, policy->memory_kb_threshold,
+               killed, true_pos, false_pos, missed);
+    }
+
+    double replay_ms = now_ms() - replay_start;
+    double replays = (double)run_count * policy_count;
+    printf("\n[Policy-Sim] Replayed %d runs x %d policies in %.1f ms (%.0f runs/s)\n",
+           run_count, policy_count, replay_ms, replay_ms > 0 ? replays / (replay_ms / 1000.0) : replays);
+
+    for (int r = 0; r < run_count; r++) free(runs[r].samples);
+    free(runs);
+    free(policies);
+    return 0;
+}
@@ -0,0 +1,209 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include "predict.h"
+#include "logscan.h"
+
+/**
+ * RESOURCE PREDICTION (History of earlier runs)
+ *
+ * Every telemetry log records the program and a hash of its contents.
+ * sandbox.py compiles each submission to a fresh /tmp path, so the hash is
+ * what ties runs of the same program together; the path is the fallback for
+ * logs written before hashes existed. Estimates are quantiles over the runs
+ * that exited normally (a run killed by a limit says little about what the
+ * program needs).
+ */
+
+// sbx_spawn hashes every binary it launches, and a batch or daemon launches
+// the same few over and over: hashes are remembered by file identity (a
+// rewrite changes mtime/ctime, a replacement the inode)
+#define HASH_CACHE_SIZE 64
+
+typedef struct {
+    dev_t dev;
+    ino_t ino;
+    off_t size;
+    struct timespec mtime;
+    struct timespec ctime;
+    char hash[17];              // "" = empty slot
+} hash_cache_entry_t;
+
+static hash_cache_entry_t hash_cache[HASH_CACHE_SIZE];
+static pthread_mutex_t hash_cache_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static int hash_cached(const hash_cache_entry_t *e, const struct stat *st) {
+    return e->hash[0] && e->dev == st->st_dev && e->ino == st->st_ino && e->size == st->st_size &&
+           e->mtime.tv_sec == st->st_mtim.tv_sec && e->mtime.tv_nsec == st->st_mtim.tv_nsec &&
+           e->ctime.tv_sec == st->st_ctim.tv_sec && e->ctime.tv_nsec == st->st_ctim.tv_nsec;
+}
+
+// 64-bit FNV-1a of the file contents, as 16 hex digits
+int predict_hash_file(const char *path, char *out, size_t len) {
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return -1;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return -1;
+    }
+    hash_cache_entry_t *slot = &hash_cache[(st.st_ino ^ st.st_dev) % HASH_CACHE_SIZE];
+    pthread_mutex_lock(&hash_cache_lock);
+    if (hash_cached(slot, &st)) {
+        snprintf(out, len, "%s", slot->hash);
+        pthread_mutex_unlock(&hash_cache_lock);
+        close(fd);
+        return 0;
+    }
+    pthread_mutex_unlock(&hash_cache_lock);
+
+    uint64_t hash = 1469598103934665603ULL;
+    unsigned char buf[65536];
+    ssize_t got;
+    while ((got = read(fd, buf, sizeof(buf))) > 0) {
+        for (ssize_t i = 0; i < got; i++) {
+            hash ^= buf[i];
+            hash *= 1099511628211ULL;
+        }
+    }
+    close(fd);
+    if (got < 0) return -1;
+
+    snprintf(out, len, "%016llx", (unsigned long long)hash);
+
+    pthread_mutex_lock(&hash_cache_lock);
+    slot->dev = st.st_dev;
+    slot->ino = st.st_ino;
+    slot->size = st.st_size;
+    slot->mtime = st.st_mtim;
+    slot->ctime = st.st_ctim;
+    snprintf(slot->hash, sizeof(slot->hash), "%016llx", (unsigned long long)hash);
+    pthread_mutex_unlock(&hash_cache_lock);
+    return 0;
+}
+
+static int load_run(const char *path, history_run_t *run) {
+    char *buf = logscan_load(path);
+    if (!buf) return -1;
+
+    int ok = 0;
+    const char *summary = strstr(buf, "\"summary\"");
+    char exit_reason[32];
+    // A cache hit repeats an earlier run's figures; count that run once
+    if (summary && !strstr(buf, "\"cached\": true")) {
+        logscan_string(summary, "exit_reason", exit_reason, sizeof(exit_reason));
+        ok = strncmp(exit_reason, "EXITED(", 7) == 0;
+    }
+
+    if (ok) {
+        memset(run, 0, sizeof(*run));
+        logscan_string(buf, "binary_hash", run->hash, sizeof(run->hash));
+        logscan_string(buf, "program", run->program, sizeof(run->program));
+        run->runtime_ms = logscan_long(summary, "runtime_ms", 0);
+        run->cpu_percent = logscan_long(summary, "peak_cpu", 0);
+        // Resident memory is what packing reserves; logs older than
+        // peak_rss_kb only have VmPeak, an upper bound
+        run->peak_rss_kb = logscan_long(summary, "peak_rss_kb", logscan_long(summary, "peak_memory_kb", 0));
+        // Older logs have no cpu_time_ms: rebuild it from the average CPU%
+        run->cpu_time_ms = logscan_long(summary, "cpu_time_ms", run->cpu_percent * run->runtime_ms / 100);
+    }
+    free(buf);
+    return ok ? 0 : -1;
+}
+
+int history_load(const char *log_dir, run_history_t *history) {
+    memset(history, 0, sizeof(*history));
+
+    DIR *dir = opendir(log_dir);
+    if (!dir) return -1;
+
+    int cap = 256;
+    history->runs = malloc(sizeof(history_run_t) * cap);
+    struct dirent *ent;
+    while ((ent = readdir(dir)) != NULL) {
+        size_t len = strlen(ent->d_name);
+        if (strncmp(ent->d_name, "run_", 4) != 0 || len < 5 || strcmp(ent->d_name + len - 5, ".json") != 0) {
+            continue;
+        }
+
+        if (history->count == cap) {
+            cap *= 2;
+            history->runs = realloc(history->runs, sizeof(history_run_t) * cap);
+        }
+
+        char path[512];
+        snprintf(path, sizeof(path), "%s/%s", log_dir, ent->d_name);
+        if (load_run(path, &history->runs[history->count]) == 0) history->count++;
+    }
+    closedir(dir);
+    return 0;
+}
+
+void history_free(run_history_t *history) {
+    free(history->runs);
+    memset(history, 0, sizeof(*history));
+}
+
+static int compare_long(const void *a, const void *b) {
+    long x = *(const long *)a, y = *(const long *)b;
+    return (x > y) - (x < y);
+}
+
+// Nearest-rank quantile (sorts values in place)
+static long quantile_of(long *values, int n, double q) {
+    qsort(values, n, sizeof(long), compare_long);
+    int rank = (int)(q * n + 0.999999);
+    if (rank < 1) rank = 1;
+    if (rank > n) rank = n;
+    return values[rank - 1];
+}
+
+// Estimate from runs with the same hash, or failing that the same path.
+// Returns 0 with out filled, -1 if fewer than min_samples runs match.
+int predict_job(const run_history_t *history, const char *hash, const char *program,
+                double quantile, int min_samples, job_prediction_t *out) {
+    memset(out, 0, sizeof(*out));
+    if (history->count == 0) return -1;
+
+    long *cols = malloc(sizeof(long) * history->count * 4);
+    long *cpu = cols, *mem = cols + history->count;
+    long *runtime = cols + 2 * history->count, *cpu_ms = cols + 3 * history->count;
+
+    int n = 0;
+    for (int pass = 0; pass < 2 && n < min_samples; pass++) {
+        n = 0;
+        for (int i = 0; i < history->count; i++) {
+            const history_run_t *run = &history->runs[i];
+            int match = (pass == 0) ? (hash && hash[0] && strcmp(run->hash, hash) == 0)
+                                    : (program && strcmp(run->program, program) == 0);
+            if (!match) continue;
+            cpu[n] = run->cpu_percent;
+            mem[n] = run->peak_rss_kb;
+            runtime[n] = run->runtime_ms;
+            cpu_ms[n] = run->cpu_time_ms;
+            n++;
+        }
+    }
+
+    if (n < min_samples || n == 0) {
+        free(cols);
+        return -1;
+    }
+
+    out->samples = n;
+    out->quantile = quantile;
+    out->cpu_percent = quantile_of(cpu, n, quantile);
+    out->peak_rss_kb = quantile_of(mem, n, quantile);
+    out->runtime_ms = quantile_of(runtime, n, quantile);
+    out->cpu_time_ms = quantile_of(cpu_ms, n, quantile);
+    free(cols);
+    return 0;
+}
@@ -0,0 +1,38 @@
+#ifndef PREDICT_H
+#define PREDICT_H
+
+#include <stddef.h>
+
+// Resource estimate for one job from earlier runs of the same program
+typedef struct {
+    int samples;                // History runs behind the estimate (0 = none)
+    double quantile;
+    long cpu_percent;
+    long peak_rss_kb;           // Resident (VmHWM), what packing reserves
+    long runtime_ms;
+    long cpu_time_ms;
+} job_prediction_t;
+
+// One finished run, as read back from its telemetry log
+typedef struct {
+    char hash[17];              // Binary content hash ("" in older logs)
+    char program[256];
+    long cpu_percent;
+    long peak_rss_kb;
+    long runtime_ms;
+    long cpu_time_ms;
+} history_run_t;
+
+typedef struct {
+    history_run_t *runs;
+    int count;
+} run_history_t;
+
+// Function prototypes
+int predict_hash_file(const char *path, char *out, size_t len);
+int history_load(const char *log_dir, run_history_t *history);
+void history_free(run_history_t *history);
+int predict_job(const run_history_t *history, const char *hash, const char *program,
+                double quantile, int min_samples, job_prediction_t *out);
+
+#endif
@@ -0,0 +1,38 @@
+#ifndef PROBES_H
+#define PROBES_H
+
+/**
+ * USDT TRACEPOINTS (provider "sandbox")
+ *
+ * Built in when <sys/sdt.h> is available (systemtap-sdt-dev); the Makefile
+ * then defines HAVE_SYS_SDT_H. A probe site is a single nop until a tracer
+ * attaches, so they stay in release builds. List and use them with e.g.
+ *   bpftrace -l 'usdt:runner/launcher:sandbox:*'
+ *   bpftrace -e 'usdt:runner/launcher:sandbox:clone__start { @t[tid] = nsecs; }
+ *                usdt:runner/launcher:sandbox:clone__end /@t[tid]/ {
+ *                    @clone_us = hist((nsecs - @t[tid]) / 1000); delete(@t[tid]); }'
+ *
+ * Probes carry no timestamps: the tracer has its own clock, and an
+ * untraced run should not pay for reading one.
+ *
+ *   clone__start()                              parent, before clone()
+ *   clone__end(pid)                             parent, child created (-1: clone failed)
+ *   child__setup(phase)                         child: "sync", "mounts", "rlimits"
+ *   seccomp__load(ok)                           child, filter loaded (1) or refused (0)
+ *   exec(binary)                                child, about to execv()
+ *   sample(pid, time_ms, cpu_percent, cpu_time_ms, memory_kb, majflt)
+ *   policy__decision(pid, kill, reason)         LEARNING profile, every sample
+ *   child__exit(pid, status, runtime_ms)        parent, child reaped
+ *   log__written(pid, path)                     parent, run log on disk
+ *
+ * Child probes fire inside the new namespaces; pid arguments are host pids.
+ */
+
+#ifdef HAVE_SYS_SDT_H
+#include <sys/sdt.h>
+#define SBX_PROBE(name, ...) STAP_PROBEV(sandbox, name, ##__VA_ARGS__)
+#else
+#define SBX_PROBE(name, ...) do { } while (0)
+#endif
+
+#endif
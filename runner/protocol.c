@@ -0,0 +1,121 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/uio.h>
+#include "protocol.h"
+
+// Write all of iov, retrying short writes and EINTR
+static int write_all(int fd, struct iovec *iov, int count) {
+    while (count > 0) {
+        ssize_t n = writev(fd, iov, count);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        while (count > 0 && (size_t)n >= iov->iov_len) {
+            n -= iov->iov_len;
+            iov++;
+            count--;
+        }
+        if (count > 0) {
+            iov->iov_base = (char *)iov->iov_base + n;
+            iov->iov_len -= n;
+        }
+    }
+    return 0;
+}
+
+static int read_all(int fd, void *buf, size_t len) {
+    size_t done = 0;
+    while (done < len) {
+        ssize_t n = read(fd, (char *)buf + done, len - done);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return -1;
+        done += n;
+    }
+    return 0;
+}
+
+// Header and payload go out in one writev so frames never interleave
+// between threads that share the fd under a lock.
+int proto_write_frame(int fd, uint16_t type, uint32_t job_tag, const void *payload, uint32_t length) {
+    proto_header_t hdr = { PROTO_MAGIC, type, job_tag, length };
+    struct iovec iov[2] = {
+        { &hdr, sizeof(hdr) },
+        { (void *)payload, length }
+    };
+    return write_all(fd, iov, length ? 2 : 1);
+}
+
+// Returns 0 with the payload in 'payload', -1 on EOF, error or a bad frame
+int proto_read_frame(int fd, proto_header_t *hdr, void *payload, size_t cap) {
+    if (read_all(fd, hdr, sizeof(*hdr)) != 0) return -1;
+    if (hdr->magic != PROTO_MAGIC || hdr->length > cap) return -1;
+    return hdr->length ? read_all(fd, payload, hdr->length) : 0;
+}
+
+// -------------------------------------------------------------
+// TLV fields: u16 tag, u16 length, value
+// -------------------------------------------------------------
+
+void proto_buf_init(proto_buf_t *b) {
+    b->len = 0;
+    b->overflow = 0;
+}
+
+void proto_put(proto_buf_t *b, uint16_t tag, const void *value, uint16_t len) {
+    if (b->len + 4 + len > sizeof(b->buf)) {
+        b->overflow = 1;
+        return;
+    }
+    memcpy(b->buf + b->len, &tag, 2);
+    memcpy(b->buf + b->len + 2, &len, 2);
+    memcpy(b->buf + b->len + 4, value, len);
+    b->len += 4 + len;
+}
+
+void proto_put_str(proto_buf_t *b, uint16_t tag, const char *value) {
+    size_t len = strlen(value);
+    proto_put(b, tag, value, len > 0xffff ? 0xffff : (uint16_t)len);
+}
+
+void proto_put_u32(proto_buf_t *b, uint16_t tag, uint32_t value) {
+    proto_put(b, tag, &value, sizeof(value));
+}
+
+void proto_put_i64(proto_buf_t *b, uint16_t tag, int64_t value) {
+    proto_put(b, tag, &value, sizeof(value));
+}
+
+// Iterate fields: returns 1 with the next field, 0 at the end, -1 if truncated
+int proto_next(const uint8_t *payload, size_t length, size_t *offset, uint16_t *tag,
+               const uint8_t **value, uint16_t *len) {
+    if (*offset == length) return 0;
+    if (length - *offset < 4) return -1;
+    memcpy(tag, payload + *offset, 2);
+    memcpy(len, payload + *offset + 2, 2);
+    if (length - *offset - 4 < *len) return -1;
+    *value = payload + *offset + 4;
+    *offset += 4 + *len;
+    return 1;
+}
+
+void proto_get_str(const uint8_t *value, uint16_t len, char *out, size_t cap) {
+    size_t n = len < cap - 1 ? len : cap - 1;
+    memcpy(out, value, n);
+    out[n] = '\0';
+}
+
+uint32_t proto_get_u32(const uint8_t *value, uint16_t len) {
+    uint32_t v = 0;
+    if (len == sizeof(v)) memcpy(&v, value, sizeof(v));
+    return v;
+}
+
+int64_t proto_get_i64(const uint8_t *value, uint16_t len) {
+    int64_t v = 0;
+    if (len == sizeof(v)) memcpy(&v, value, sizeof(v));
+    return v;
+}
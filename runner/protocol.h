@@ -0,0 +1,100 @@
+#ifndef PROTOCOL_H
+#define PROTOCOL_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * SANDBOXD WIRE PROTOCOL (Unix domain socket, SOCK_STREAM)
+ *
+ * Every message is a frame: a fixed header followed by 'length' payload
+ * bytes. Integers are in host byte order; both ends are on the same machine.
+ * SUBMIT and RESULT payloads are TLV fields (tag, length, value) so either
+ * side can add fields without breaking the other; SAMPLE is a fixed struct
+ * because there are many of them.
+ *
+ *   client -> sandboxd   SUBMIT  (job tag chosen by the client)
+ *   sandboxd -> client   SAMPLE* (one per monitoring sample, best effort)
+ *                        RESULT  (or ERROR)
+ *
+ * A client may pipeline any number of SUBMITs; replies carry the job tag.
+ */
+
+#define PROTO_MAGIC 0x5342u          // "SB"
+#define PROTO_MAX_PAYLOAD (64 * 1024)
+
+typedef enum {
+    MSG_SUBMIT = 1,
+    MSG_SAMPLE = 2,
+    MSG_RESULT = 3,
+    MSG_ERROR  = 4
+} proto_msg_t;
+
+typedef struct {
+    uint16_t magic;
+    uint16_t type;
+    uint32_t job_tag;
+    uint32_t length;
+} proto_header_t;
+
+// TLV tags: strings are not NUL-terminated on the wire
+typedef enum {
+    // SUBMIT
+    TAG_BINARY = 1,         // string
+    TAG_ARG,                // string, repeatable (argv[1..])
+    TAG_PROFILE,            // string: STRICT | RESOURCE-AWARE | LEARNING
+    TAG_POLICY,             // string: --policy syntax
+    TAG_TENANT,             // string
+    TAG_PRIORITY,           // string: interactive | batch
+    TAG_MEMORY_MB,          // u32
+    TAG_NPROC,              // u32
+    TAG_NOFILE,             // u32
+    TAG_TIME_MS,            // u32
+    TAG_MEM_SOFT,           // u32 (0/1)
+    TAG_ID,                 // string
+    TAG_CPU_QUOTA_US,       // u32: cpu.max quota per 100 ms period in the job's cgroup (0 = inherited)
+
+    // RESULT
+    TAG_PID = 32,           // u32
+    TAG_EXIT_REASON,        // string
+    TAG_RUNTIME_MS,         // i64
+    TAG_PEAK_CPU,           // u32
+    TAG_PEAK_MEMORY_KB,     // i64
+    TAG_CPU_TIME_MS,        // i64
+    TAG_LOG_PATH,           // string
+    TAG_QUEUE_WAIT_MS,      // i64
+    TAG_SAMPLES_DROPPED     // i64: SAMPLE frames not sent because the client fell behind
+} proto_tag_t;
+
+// One monitoring sample, streamed while the job runs
+typedef struct {
+    int64_t time_ms;
+    int64_t cpu_time_ms;
+    int64_t memory_kb;
+    uint64_t majflt;
+    int32_t cpu_percent;
+    int32_t cpu;
+} proto_sample_t;
+
+// Payload under construction
+typedef struct {
+    uint8_t buf[PROTO_MAX_PAYLOAD];
+    size_t len;
+    int overflow;
+} proto_buf_t;
+
+// Function prototypes
+int proto_write_frame(int fd, uint16_t type, uint32_t job_tag, const void *payload, uint32_t length);
+int proto_read_frame(int fd, proto_header_t *hdr, void *payload, size_t cap);
+void proto_buf_init(proto_buf_t *b);
+void proto_put(proto_buf_t *b, uint16_t tag, const void *value, uint16_t len);
+void proto_put_str(proto_buf_t *b, uint16_t tag, const char *value);
+void proto_put_u32(proto_buf_t *b, uint16_t tag, uint32_t value);
+void proto_put_i64(proto_buf_t *b, uint16_t tag, int64_t value);
+int proto_next(const uint8_t *payload, size_t length, size_t *offset, uint16_t *tag,
+               const uint8_t **value, uint16_t *len);
+void proto_get_str(const uint8_t *value, uint16_t len, char *out, size_t cap);
+uint32_t proto_get_u32(const uint8_t *value, uint16_t len);
+int64_t proto_get_i64(const uint8_t *value, uint16_t len);
+
+#endif
@@ -1,5 +1,6 @@
 
 import os
+import re
 import sys
 import subprocess
 import uuid
@@ -7,30 +8,329 @@ import shutil
 import time
 import argparse
 import signal
+import socket
+import struct
+import tempfile
+import fcntl
+import hashlib
+import stat
 from pathlib import Path
 
+try:
+    import _sandbox # In-process sandboxes through libsandbox (make python)
+except ImportError:
+    _sandbox = None
+
 # -------------------------------------------------------------
 # CONSTANTS & CONFIGURATION
 # -------------------------------------------------------------
 CGROUP_ROOT = "/sys/fs/cgroup"
 SANDBOX_CGROUP_PARENT = "sandbox_project"
+DEFAULT_TENANT = "default"
+TENANT_NAME = re.compile(r"[A-Za-z0-9_.-]+")
 LAUNCHER_BIN = "./runner/launcher"
+COMPILE_CACHE_DIR = "/var/cache/sandbox_compile_cache"
+COMPILE_CACHE_BUDGET = "512M"
+OUTPUT_LIMIT = "1M" # Per stream; the launcher drops the rest (--capture-limit)
 UID_MAP_OFFSET = 100000 
 GID_MAP_OFFSET = 100000
 
+def parse_size(value):
+    """
+    Converts cgroup-style sizes ("64M", "1G", "4096") to bytes.
+    """
+    units = {"K": 1024, "M": 1024 ** 2, "G": 1024 ** 3}
+    value = str(value).strip().upper()
+    if value and value[-1] in units:
+        return int(float(value[:-1]) * units[value[-1]])
+    return int(value)
+
+# -------------------------------------------------------------
+# SANDBOXD CLIENT (see runner/protocol.h for the wire format)
+# -------------------------------------------------------------
+PROTO_MAGIC = 0x5342
+PROTO_HEADER = struct.Struct("=HHII")        # magic, type, job_tag, length
+PROTO_SAMPLE = struct.Struct("=qqqQii")      # time_ms, cpu_time_ms, memory_kb, majflt, cpu_percent, cpu
+MSG_SUBMIT, MSG_SAMPLE, MSG_RESULT, MSG_ERROR = 1, 2, 3, 4
+TAG_BINARY, TAG_ARG, TAG_PROFILE, TAG_TENANT = 1, 2, 3, 5
+TAG_MEMORY_MB, TAG_NPROC, TAG_NOFILE, TAG_TIME_MS, TAG_MEM_SOFT = 7, 8, 9, 10, 11
+TAG_CPU_QUOTA_US = 13
+RESULT_TAGS = {32: ("pid", "u32"), 33: ("exit_reason", "str"), 34: ("runtime_ms", "i64"),
+               35: ("peak_cpu", "u32"), 36: ("peak_memory_kb", "i64"), 37: ("cpu_time_ms", "i64"),
+               38: ("log", "str"), 39: ("queue_wait_ms", "i64"), 40: ("samples_dropped", "i64")}
+
+def _tlv(tag, value):
+    if isinstance(value, str):
+        value = value.encode()
+    elif isinstance(value, int):
+        value = struct.pack("=I", value)
+    return struct.pack("=HH", tag, len(value)) + value
+
+def _recv_exact(sock, n):
+    data = b""
+    while len(data) < n:
+        chunk = sock.recv(n - len(data))
+        if not chunk:
+            raise ConnectionError("sandboxd closed the connection")
+        data += chunk
+    return data
+
+def submit_to_daemon(socket_path, binary, args=(), profile="STRICT", tenant=None, mem_soft=False,
+                     memory_mb=None, nproc=None, time_ms=None, cpu_quota_us=None):
+    """
+    Runs one job through a resident sandboxd. Returns (result dict, samples list).
+    Limits left as None take the daemon's defaults.
+    """
+    payload = _tlv(TAG_BINARY, binary) + b"".join(_tlv(TAG_ARG, a) for a in args)
+    payload += _tlv(TAG_PROFILE, profile)
+    if tenant:
+        payload += _tlv(TAG_TENANT, tenant)
+    if mem_soft:
+        payload += _tlv(TAG_MEM_SOFT, 1)
+    for tag, value in ((TAG_MEMORY_MB, memory_mb), (TAG_NPROC, nproc), (TAG_TIME_MS, time_ms),
+                       (TAG_CPU_QUOTA_US, cpu_quota_us)):
+        if value is not None:
+            payload += _tlv(tag, int(value))
+
+    samples = []
+    with socket.socket(socket.AF_UNIX, socket.SOCK_STREAM) as sock:
+        sock.connect(socket_path)
+        sock.sendall(PROTO_HEADER.pack(PROTO_MAGIC, MSG_SUBMIT, 1, len(payload)) + payload)
+        while True:
+            magic, msg_type, _, length = PROTO_HEADER.unpack(_recv_exact(sock, PROTO_HEADER.size))
+            body = _recv_exact(sock, length) if length else b""
+            if magic != PROTO_MAGIC:
+                raise ConnectionError("bad frame from sandboxd")
+            if msg_type == MSG_SAMPLE:
+                samples.append(dict(zip(("time_ms", "cpu_time_ms", "memory_kb", "majflt", "cpu_percent", "cpu"),
+                                        PROTO_SAMPLE.unpack(body))))
+            elif msg_type == MSG_ERROR:
+                raise RuntimeError(f"sandboxd: {body.decode(errors='replace')}")
+            elif msg_type == MSG_RESULT:
+                result, offset = {}, 0
+                while offset + 4 <= len(body):
+                    tag, size = struct.unpack_from("=HH", body, offset)
+                    value = body[offset + 4:offset + 4 + size]
+                    offset += 4 + size
+                    if tag in RESULT_TAGS:
+                        name, kind = RESULT_TAGS[tag]
+                        result[name] = (value.decode(errors="replace") if kind == "str"
+                                        else struct.unpack("=I" if kind == "u32" else "=q", value)[0])
+                return result, samples
+
+def enable_controllers(cgroup_path):
+    """
+    Delegates the controllers we limit to the children of cgroup_path.
+    """
+    for controller in ("+cpu", "+memory", "+pids"):
+        try:
+            with open(os.path.join(cgroup_path, "cgroup.subtree_control"), "w") as f:
+                f.write(controller)
+        except OSError:
+            pass
+
+# -------------------------------------------------------------
+# COMPILATION CACHE
+# Artifacts live at <root>/<key[:2]>/<key>, keyed by the SHA-256 of the
+# source, the compiler version and the flags. A per-key flock makes
+# concurrent submissions of the same source wait for one compile; an
+# artifact's mtime is its LRU stamp for size-bounded eviction.
+# The controller runs as root and executes what it finds here, so every
+# directory must be ours and closed to everyone else (0700), and files are
+# opened without following symlinks.
+# -------------------------------------------------------------
+def _private_dir(path):
+    """
+    Creates path (0700) if missing and refuses one that is a symlink, not
+    ours, or open to group/other: anything else could hold planted artifacts.
+    """
+    try:
+        os.mkdir(path, 0o700)
+    except FileExistsError:
+        pass
+    st = os.lstat(path)
+    if not stat.S_ISDIR(st.st_mode) or st.st_uid != os.geteuid() or st.st_mode & 0o077:
+        raise PermissionError(f"compile cache directory {path} must be a 0700 directory owned by uid {os.geteuid()}")
+
+def _open_lock(path):
+    return os.fdopen(os.open(path, os.O_RDWR | os.O_CREAT | os.O_NOFOLLOW | os.O_CLOEXEC, 0o600), "r+")
+
+class CompileCache:
+    def __init__(self, root=COMPILE_CACHE_DIR, budget=COMPILE_CACHE_BUDGET, compiler="gcc"):
+        self.root = root
+        self.budget = parse_size(budget)
+        self.compiler = compiler
+        self._version = None
+
+    def compiler_version(self):
+        if self._version is None:
+            result = subprocess.run([self.compiler, "--version"], capture_output=True)
+            self._version = result.stdout
+        return self._version
+
+    def key(self, source_path, flags):
+        digest = hashlib.sha256()
+        with open(source_path, "rb") as f:
+            digest.update(f.read())
+        digest.update(b"\0" + self.compiler_version() + b"\0")
+        digest.update("\0".join(flags).encode())
+        return digest.hexdigest()
+
+    def compile(self, source_path, exec_path, flags=()):
+        """
+        Places the binary for source_path at exec_path (a hard link into the
+        cache, so eviction can't pull it from under a run). Returns
+        (hit, CompletedProcess or None); on a failed compile exec_path is absent.
+        """
+        key = self.key(source_path, flags)
+        shard = os.path.join(self.root, key[:2])
+        artifact = os.path.join(shard, key)
+        os.makedirs(os.path.dirname(self.root), exist_ok=True)
+        _private_dir(self.root)
+        _private_dir(shard)
+
+        with _open_lock(artifact + ".lock") as lock:
+            fcntl.flock(lock, fcntl.LOCK_EX)
+            hit = os.path.exists(artifact)
+            result = None
+            if not hit:
+                tmp = f"{artifact}.tmp{os.getpid()}"
+                if os.path.lexists(tmp):
+                    os.remove(tmp)
+                result = subprocess.run([self.compiler, source_path, "-o", tmp, *flags], capture_output=True)
+                if result.returncode != 0:
+                    return False, result
+                os.rename(tmp, artifact)
+            os.utime(artifact)
+            self._place(artifact, exec_path)
+
+        if not hit:
+            self.evict()
+        return hit, result
+
+    def _place(self, artifact, exec_path):
+        if os.path.exists(exec_path):
+            os.remove(exec_path)
+        try:
+            os.link(artifact, exec_path)
+        except OSError:
+            shutil.copy2(artifact, exec_path)
+
+    def evict(self):
+        """
+        Drops least recently used artifacts until the store fits its budget,
+        with their lock files, and the lock files of failed compiles.
+        One evictor at a time; the others skip it. A key someone holds the
+        lock of is in use and stays.
+        """
+        with _open_lock(os.path.join(self.root, ".evict.lock")) as lock:
+            try:
+                fcntl.flock(lock, fcntl.LOCK_EX | fcntl.LOCK_NB)
+            except BlockingIOError:
+                return
+            artifacts = []
+            orphans = []
+            for entry in os.scandir(self.root):
+                if not entry.is_dir(follow_symlinks=False):
+                    continue
+                for f in os.scandir(entry.path):
+                    if f.name.endswith(".lock"):
+                        if not os.path.lexists(f.path[:-len(".lock")]):
+                            orphans.append(f.path[:-len(".lock")])
+                        continue
+                    if ".tmp" in f.name:
+                        continue
+                    st = f.stat(follow_symlinks=False)
+                    artifacts.append((st.st_mtime, st.st_blocks * 512, f.path))
+            total = sum(size for _, size, _ in artifacts)
+            for path in orphans:
+                self._remove_key(path)
+            for _, size, path in sorted(artifacts):
+                if total <= self.budget:
+                    break
+                if self._remove_key(path):
+                    total -= size
+
+    def _remove_key(self, artifact):
+        """
+        Removes an artifact and its lock file unless a compile holds the lock.
+        """
+        try:
+            lock = _open_lock(artifact + ".lock")
+        except OSError:
+            return False
+        with lock:
+            try:
+                fcntl.flock(lock, fcntl.LOCK_EX | fcntl.LOCK_NB)
+            except BlockingIOError:
+                return False
+            for path in (artifact, artifact + ".lock"):
+                try:
+                    os.remove(path)
+                except FileNotFoundError:
+                    pass
+        return True
+
+class TenantCgroup:
+    """
+    Tenant level of the hierarchy: sandbox_project/<tenant>/<run>.
+    Its cpu.weight, memory.max and pids.max bound all of the tenant's runs together.
+    """
+    def __init__(self, name=DEFAULT_TENANT, weight=100, memory="max", pids="max"):
+        # Same rule as job_parse_tenant() in job.c: [A-Za-z0-9_.-], not hidden
+        if not TENANT_NAME.fullmatch(name or "") or name.startswith(".") or len(name) > 31:
+            raise ValueError(f"invalid tenant name: {name!r}")
+        self.name = name
+        self.weight = str(weight)
+        self.memory_limit = memory
+        self.pids_limit = str(pids)
+        self.cgroup_path = os.path.join(CGROUP_ROOT, SANDBOX_CGROUP_PARENT, name)
+
+    def setup(self):
+        parent = os.path.join(CGROUP_ROOT, SANDBOX_CGROUP_PARENT)
+        os.makedirs(self.cgroup_path, exist_ok=True)
+        enable_controllers(parent)
+        enable_controllers(self.cgroup_path)
+
+        for name, value in (("cpu.weight", self.weight), ("memory.max", self.memory_limit),
+                            ("pids.max", self.pids_limit)):
+            with open(os.path.join(self.cgroup_path, name), "w") as f:
+                f.write(value)
+
+    def cleanup(self):
+        # Other runs of the same tenant may still be inside; rmdir fails then
+        try:
+            os.rmdir(self.cgroup_path)
+        except OSError:
+            pass
+
 class SandboxController:
-    def __init__(self, cpus=0.5, memory="128M", pids=20, time_limit=5):
+    def __init__(self, cpus=0.5, memory="128M", pids=20, time_limit=5, memory_high=None, tenant=None,
+                 daemon_socket=None, compile_cache=None, output_limit=OUTPUT_LIMIT):
         self.run_id = str(uuid.uuid4())[:8]
-        self.cgroup_path = os.path.join(CGROUP_ROOT, SANDBOX_CGROUP_PARENT, self.run_id)
+        self.daemon_socket = daemon_socket # Submit to a resident sandboxd instead of exec'ing the launcher
+        self.tenant = tenant or TenantCgroup()
+        self.cgroup_path = os.path.join(self.tenant.cgroup_path, self.run_id)
         
         # Resource Limits
         self.cpu_quota = int(cpus * 100000) # CFS Quota (us) per 100ms period
         self.memory_limit = memory
+        self.memory_high = memory_high # Soft limit: throttle + reclaim above this
         self.pids_limit = str(pids)
         self.time_limit = time_limit
+        self.output_limit = parse_size(output_limit)
         
         # Paths
         self.exec_path = None
+        self.compile_cache = compile_cache # CompileCache, or None to compile every time
+
+    def memory_mb(self):
+        """
+        --mem in MiB for the launcher's RLIMIT_AS, None for "max".
+        """
+        if self.memory_limit == "max":
+            return None
+        return max(1, parse_size(self.memory_limit) // (1024 * 1024))
 
     def setup_cgroups(self):
         """
@@ -40,6 +340,7 @@ class SandboxController:
         """
         print(f"[Controller] Creating Cgroup: {self.cgroup_path}")
         try:
+            self.tenant.setup()
             os.makedirs(self.cgroup_path, exist_ok=True)
             
             # Enforce CPU Quota (CFS)
@@ -50,6 +351,15 @@ class SandboxController:
             # Enforce Memory Limit
             with open(os.path.join(self.cgroup_path, "memory.max"), "w") as f:
                 f.write(self.memory_limit)
+
+            # Soft Memory Limit (memory.high below memory.max)
+            # Above memory.high the kernel throttles and reclaims instead of
+            # failing allocations; memory.max stays as the hard OOM boundary.
+            if self.memory_high:
+                if self.memory_limit != "max" and parse_size(self.memory_high) >= parse_size(self.memory_limit):
+                    print(f"WARNING: memory.high ({self.memory_high}) should be below memory.max ({self.memory_limit}).")
+                with open(os.path.join(self.cgroup_path, "memory.high"), "w") as f:
+                    f.write(self.memory_high)
                 
             # Enforce PID Limit (Fork Bomb Protection)
             with open(os.path.join(self.cgroup_path, "pids.max"), "w") as f:
@@ -76,6 +386,7 @@ class SandboxController:
             except OSError:
                 # Often fails if processes are still zombie; wait logic handles this usually
                 pass
+        self.tenant.cleanup()
         
         if self.exec_path and os.path.exists(self.exec_path):
             os.remove(self.exec_path)
@@ -90,9 +401,14 @@ class SandboxController:
 
         print(f"[Controller] Compiling {source_path}...")
         self.exec_path = f"/tmp/sandbox_exec_{self.run_id}"
-        
-        cmd = ["gcc", source_path, "-o", self.exec_path]
-        result = subprocess.run(cmd, capture_output=True)
+        if self.compile_cache:
+            hit, result = self.compile_cache.compile(source_path, self.exec_path)
+            if hit:
+                print("[Controller] Compile cache hit.")
+                return
+        else:
+            cmd = ["gcc", source_path, "-o", self.exec_path]
+            result = subprocess.run(cmd, capture_output=True)
         
         if result.returncode != 0:
             print(f"Compilation Failed:\n{result.stderr.decode()}")
@@ -104,6 +420,23 @@ class SandboxController:
         """
         Executes the sandbox.
         """
+        if self.daemon_socket:
+            start_time = time.time()
+            try:
+                result, samples = submit_to_daemon(
+                    self.daemon_socket, self.exec_path, tenant=self.tenant.name, mem_soft=bool(self.memory_high),
+                    memory_mb=self.memory_mb(), nproc=int(self.pids_limit), time_ms=int(self.time_limit * 1000),
+                    cpu_quota_us=self.cpu_quota)
+                print(f"[Controller] sandboxd result ({len(samples)} samples, "
+                      f"{(time.time() - start_time) * 1000:.0f} ms submit-to-result): {result}")
+            except (OSError, RuntimeError) as e:
+                print(f"Execution Error: {e}")
+            return
+
+        if _sandbox:
+            self.run_in_process()
+            return
+
         print(f"[Controller] Launching Process Isolation Wrapper...")
         
         # We start the wrapper using subprocess
@@ -123,7 +456,13 @@ class SandboxController:
                 
         start_time = time.time()
         
-        cmd = [LAUNCHER_BIN, self.exec_path]
+        # The job's own output is captured by the launcher (splice into capped
+        # files), so only the launcher's few status lines come through our pipes
+        capture_dir = tempfile.mkdtemp(prefix=f"sandbox_output_{self.run_id}_")
+        cmd = [LAUNCHER_BIN, f"--capture={capture_dir}", f"--capture-limit={self.output_limit}"]
+        if self.memory_high:
+            cmd.append("--mem-soft")
+        cmd.append(self.exec_path)
         
         try:
             # Running the C wrapper
@@ -135,11 +474,13 @@ class SandboxController:
             )
             
             try:
-                stdout, stderr = process.communicate(timeout=self.time_limit)
+                status, errors = process.communicate(timeout=self.time_limit)
+                print(status.decode(errors='replace'), end="")
+                print(errors.decode(errors='replace'), end="")
                 print("\n--- SANDBOX OUTPUT ---")
-                print(stdout.decode(errors='replace'))
+                print(self.read_capture(capture_dir, ".stdout"))
                 print("--- SANDBOX ERRORS ---")
-                print(stderr.decode(errors='replace'))
+                print(self.read_capture(capture_dir, ".stderr"))
                 
                 if process.returncode != 0:
                     print(f"Process exited with code {process.returncode}")
@@ -153,6 +494,61 @@ class SandboxController:
                 
         except Exception as e:
             print(f"Execution Error: {e}")
+        finally:
+            shutil.rmtree(capture_dir, ignore_errors=True)
+
+    @staticmethod
+    def read_capture(capture_dir, suffix):
+        """
+        Returns one captured stream of the run (at most --capture-limit bytes
+        plus the launcher's truncation marker).
+        """
+        for name in os.listdir(capture_dir):
+            if name.endswith(suffix):
+                with open(os.path.join(capture_dir, name), "rb") as f:
+                    return f.read().decode(errors='replace')
+        return ""
+
+    def run_in_process(self):
+        """
+        Executes the sandbox through the _sandbox extension: no launcher
+        process, and the result comes back as Python objects.
+        """
+        print(f"[Controller] Spawning sandbox in-process (libsandbox)...")
+        # The child joins our run cgroup directly (Demo Mode: none)
+        cgroup = self.cgroup_path if os.path.exists(os.path.join(self.cgroup_path, "cgroup.procs")) else None
+
+        # Same capped capture as the launcher path: a job flooding its output
+        # can't fill the disk or our memory
+        capture_dir = tempfile.mkdtemp(prefix=f"sandbox_output_{self.run_id}_")
+        try:
+            try:
+                limits = {"nproc": int(self.pids_limit)}
+                if self.memory_mb() is not None:
+                    limits["memory_mb"] = self.memory_mb()
+                sandbox = _sandbox.spawn(self.exec_path, time_ms=int(self.time_limit * 1000), **limits,
+                                         mem_soft=bool(self.memory_high), cgroup=cgroup,
+                                         capture_dir=capture_dir, capture_limit=self.output_limit)
+            except (OSError, ValueError) as e:
+                print(f"Execution Error: {e}")
+                return
+            result = sandbox.wait()
+
+            print("\n--- SANDBOX OUTPUT ---")
+            print(self.read_capture(capture_dir, ".stdout"))
+            print("--- SANDBOX ERRORS ---")
+            print(self.read_capture(capture_dir, ".stderr"))
+        finally:
+            shutil.rmtree(capture_dir, ignore_errors=True)
+
+        if result["exit_reason"] == "TIME_LIMIT_EXCEEDED":
+            print(f"\n[Controller] TIMEOUT ({self.time_limit}s) EXCEEDED! Process terminated.")
+        elif result["exit_reason"] != "EXITED(0)":
+            print(f"Process ended: {result['exit_reason']}")
+        else:
+            print("Execution completed successfully.")
+        print(f"[Controller] {result['runtime_ms']} ms, peak {result['memory_peak_kb']} KB, "
+              f"{len(result['samples'])} samples (log: {result['log_path']})")
 
 if __name__ == "__main__":
     if os.getuid() != 0:
@@ -163,11 +559,29 @@ if __name__ == "__main__":
     parser.add_argument('source', help='Path to source code')
     parser.add_argument('--cpu', type=float, default=0.2, help='CPU Quota (Cores)')
     parser.add_argument('--mem', type=str, default='64M', help='Memory Limit')
+    parser.add_argument('--mem_high', type=str, default=None, help='Soft Memory Limit (memory.high), below --mem')
     parser.add_argument('--pids', type=int, default=20, help='PID Limit')
     parser.add_argument('--time_limit', type=int, default=5, help='Time Limit (seconds)')
+    parser.add_argument('--compile_cache', type=str, default=COMPILE_CACHE_DIR,
+                        help='Compiled artifact store ("none" compiles every submission)')
+    parser.add_argument('--compile_cache_size', type=str, default=COMPILE_CACHE_BUDGET,
+                        help='Compile cache size bound (LRU eviction)')
+    parser.add_argument('--output_limit', type=str, default=OUTPUT_LIMIT,
+                        help='Bytes of stdout/stderr kept per stream (e.g. 1M); the rest is dropped')
+    parser.add_argument('--daemon', type=str, default=None, help='Submit through a running sandboxd socket')
+    parser.add_argument('--tenant', type=str, default=DEFAULT_TENANT, help='Tenant (sandbox_project/<tenant>/<run>)')
+    parser.add_argument('--tenant_weight', type=int, default=100, help='Tenant cpu.weight (1-10000)')
+    parser.add_argument('--tenant_mem', type=str, default='max', help='Tenant memory.max (all runs together)')
+    parser.add_argument('--tenant_pids', type=str, default='max', help='Tenant pids.max (all runs together)')
     args = parser.parse_args()
 
-    sandbox = SandboxController(cpus=args.cpu, memory=args.mem, pids=args.pids, time_limit=args.time_limit)
+    tenant = TenantCgroup(args.tenant, weight=args.tenant_weight, memory=args.tenant_mem, pids=args.tenant_pids)
+    compile_cache = None
+    if args.compile_cache != "none":
+        compile_cache = CompileCache(args.compile_cache, budget=args.compile_cache_size)
+    sandbox = SandboxController(cpus=args.cpu, memory=args.mem, pids=args.pids, time_limit=args.time_limit,
+                             memory_high=args.mem_high, tenant=tenant, daemon_socket=args.daemon,
+                             compile_cache=compile_cache, output_limit=args.output_limit)
     
     try:
         sandbox.setup_cgroups()
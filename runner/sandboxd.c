@@ -0,0 +1,565 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include "sandboxd.h"
+#include "protocol.h"
+#include "metrics.h"
+#include "cgroup.h"
+
+/**
+ * SANDBOXD (Resident supervisor)
+ *
+ * One long-lived launcher process serves job submissions over a Unix domain
+ * socket, so a job no longer pays for an interpreter start, a launcher exec,
+ * dynamic linking of libseccomp, seccomp compilation or the logs/ check.
+ *
+ * Threads: the main thread accepts connections; one reader thread per
+ * connection decodes SUBMIT frames into a shared FIFO; a fixed pool of
+ * workers runs jobs through metrics_run_job() (job_run(), the same
+ * clone/seccomp/telemetry path as every other mode, plus fleet metrics) and writes SAMPLE and RESULT frames back on the
+ * submitting connection. See protocol.h for the wire format.
+ *
+ * A client that reads slowly must not stall a job's sampling loop: samples
+ * go through a small per-connection queue written without blocking and are
+ * dropped when it is full; only RESULT and ERROR frames wait for the client. *
+ * Tenant limits belong to the daemon: its own --tenant options define them,
+ * and a tenant first named by a submission gets sandbox_project/<tenant>
+ * with default limits. A client only names the tenant.
+ */
+
+#define MAX_JOB_ARGS 64
+#define SAMPLE_FRAME_BYTES (sizeof(proto_header_t) + sizeof(proto_sample_t))
+#define SAMPLE_QUEUE_FRAMES 64      // Samples a connection buffers for a slow client before dropping
+#define SEND_TIMEOUT_SEC 5          // A client that takes no RESULT bytes for this long is dropped
+
+// A client connection, shared by its reader and every job it submitted
+typedef struct {
+    int fd;
+    pthread_mutex_t lock;       // Serialises frames and guards refs and pending
+    int refs;
+    int broken;                 // Peer went away: stop writing
+    uint8_t pending[SAMPLE_QUEUE_FRAMES * SAMPLE_FRAME_BYTES];     // SAMPLE bytes the socket had no room for
+    size_t pending_len;
+} conn_t;
+
+typedef struct daemon_job {
+    conn_t *conn;
+    uint32_t tag;
+    job_spec_t spec;
+    char *argv[MAX_JOB_ARGS + 2];
+    long submitted_ms;
+    long samples_dropped;       // Client too slow or connection busy
+    struct daemon_job *next;
+} daemon_job_t;
+
+static struct {
+    pthread_mutex_t lock;
+    pthread_cond_t ready;
+    daemon_job_t *head;
+    daemon_job_t *tail;
+    int stopping;
+} queue = { PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER, NULL, NULL, 0 };
+
+// Tenants whose sandbox_project/<tenant> cgroup has been set up
+static struct {
+    pthread_mutex_t lock;
+    tenant_t list[MAX_TENANTS];
+    int count;
+} tenants = { .lock = PTHREAD_MUTEX_INITIALIZER };
+
+static struct sock_fprog filters[3];    // Compiled once, shared by all jobs
+static const job_spec_t *defaults;
+static volatile sig_atomic_t stop_requested = 0;
+
+static void handle_stop(int sig) {
+    (void)sig;
+    stop_requested = 1;
+}
+
+// -------------------------------------------------------------
+// Connections
+// -------------------------------------------------------------
+
+static void conn_release(conn_t *conn) {
+    pthread_mutex_lock(&conn->lock);
+    int last = --conn->refs == 0;
+    pthread_mutex_unlock(&conn->lock);
+    if (last) {
+        close(conn->fd);
+        pthread_mutex_destroy(&conn->lock);
+        free(conn);
+    }
+}
+
+// Write out as much of the queued samples as the socket takes, all of them
+// if 'wait' (bounded by SO_SNDTIMEO). Caller holds the lock.
+static void conn_flush(conn_t *conn, int wait) {
+    size_t sent = 0;
+    while (!conn->broken && sent < conn->pending_len) {
+        ssize_t n = send(conn->fd, conn->pending + sent, conn->pending_len - sent,
+                         MSG_NOSIGNAL | (wait ? 0 : MSG_DONTWAIT));
+        if (n > 0) {
+            sent += n;
+        } else if (n < 0 && errno == EINTR) {
+            continue;
+        } else if (n < 0 && !wait && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            break;
+        } else {
+            conn->broken = 1;
+        }
+    }
+    memmove(conn->pending, conn->pending + sent, conn->pending_len - sent);
+    conn->pending_len -= sent;
+}
+
+// RESULT and ERROR frames: never dropped, so they wait for the client,
+// behind the samples queued before them
+static void conn_send(conn_t *conn, uint16_t type, uint32_t tag, const void *payload, uint32_t length) {
+    pthread_mutex_lock(&conn->lock);
+    conn_flush(conn, 1);
+    if (!conn->broken && proto_write_frame(conn->fd, type, tag, payload, length) != 0) {
+        conn->broken = 1;
+    }
+    pthread_mutex_unlock(&conn->lock);
+}
+
+// SAMPLE frames: this runs in the job's sampling loop, so it never waits on
+// the client or on another job's frame. A sample that finds the connection
+// busy or its queue full is dropped and counted.
+static int conn_send_sample(conn_t *conn, uint32_t tag, const proto_sample_t *sample) {
+    if (pthread_mutex_trylock(&conn->lock) != 0) return -1;
+    int queued = 0;
+    if (!conn->broken && conn->pending_len + SAMPLE_FRAME_BYTES <= sizeof(conn->pending)) {
+        proto_header_t hdr = { PROTO_MAGIC, MSG_SAMPLE, tag, sizeof(*sample) };
+        memcpy(conn->pending + conn->pending_len, &hdr, sizeof(hdr));
+        memcpy(conn->pending + conn->pending_len + sizeof(hdr), sample, sizeof(*sample));
+        conn->pending_len += SAMPLE_FRAME_BYTES;
+        queued = 1;
+    }
+    conn_flush(conn, 0);
+    pthread_mutex_unlock(&conn->lock);
+    return queued ? 0 : -1;
+}
+
+static void send_error(conn_t *conn, uint32_t tag, const char *message) {
+    conn_send(conn, MSG_ERROR, tag, message, strlen(message));
+}
+
+static void free_job(daemon_job_t *job) {
+    for (int a = 0; a <= MAX_JOB_ARGS && job->argv[a]; a++) free(job->argv[a]);
+    free(job);
+}
+
+// A string field into str, or an error for one longer than str holds
+static int get_field_str(const uint8_t *value, uint16_t len, char *str, size_t cap, char *err, size_t err_len) {
+    if (len >= cap) {
+        snprintf(err, err_len, "field longer than %zu bytes", cap - 1);
+        return -1;
+    }
+    proto_get_str(value, len, str, cap);
+    return 0;
+}
+
+// Set up the tenant's cgroup the first time a job names it
+static int use_tenant(const char *name) {
+    pthread_mutex_lock(&tenants.lock);
+    int rc = 0;
+    if (!tenant_find(tenants.list, tenants.count, name)) {
+        if (tenants.count == MAX_TENANTS) {
+            rc = -1;
+        } else {
+            tenant_t *t = &tenants.list[tenants.count++];
+            tenant_init(t, name);
+            if (tenant_setup_cgroup(t) != 0) {
+                fprintf(stderr, "[Tenant] WARNING: could not apply cgroup limits for '%s'.\n", name);
+            }
+        }
+    }
+    pthread_mutex_unlock(&tenants.lock);
+    return rc;
+}
+
+// Decode a SUBMIT payload on top of the daemon's defaults
+static daemon_job_t *parse_submit(const uint8_t *payload, size_t length, char *err, size_t err_len) {
+    daemon_job_t *job = calloc(1, sizeof(*job));
+    job->spec = *defaults;
+    job->spec.binary_path = NULL;
+    job->spec.args = NULL;
+    job->spec.quiet = 1;
+
+    int argc = 1;
+    size_t offset = 0;
+    uint16_t tag, len;
+    const uint8_t *value;
+    char str[512];
+    int rc;
+
+    while ((rc = proto_next(payload, length, &offset, &tag, &value, &len)) == 1) {
+        switch (tag) {
+            case TAG_BINARY:
+                if (get_field_str(value, len, str, sizeof(str), err, err_len) != 0) goto fail;
+                free(job->argv[0]);
+                job->argv[0] = strdup(str);
+                break;
+            case TAG_ARG:
+                if (argc > MAX_JOB_ARGS) {
+                    snprintf(err, err_len, "more than %d arguments", MAX_JOB_ARGS);
+                    goto fail;
+                }
+                if (get_field_str(value, len, str, sizeof(str), err, err_len) != 0) goto fail;
+                job->argv[argc++] = strdup(str);
+                break;
+            case TAG_PROFILE:
+                if (get_field_str(value, len, str, sizeof(str), err, err_len) != 0) goto fail;
+                if (job_parse_profile(str, &job->spec.profile, &job->spec.profile_name) != 0) {
+                    snprintf(err, err_len, "unknown profile %.64s", str);
+                    goto fail;
+                }
+                break;
+            case TAG_POLICY:
+                if (get_field_str(value, len, str, sizeof(str), err, err_len) != 0) goto fail;
+                if (policy_parse(str, &job->spec.policy) != 0) {
+                    snprintf(err, err_len, "invalid policy %.64s", str);
+                    goto fail;
+                }
+                break;
+            case TAG_TENANT:
+                if (get_field_str(value, len, str, sizeof(str), err, err_len) != 0) goto fail;
+                if (job_parse_tenant(str, job->spec.tenant, sizeof(job->spec.tenant)) != 0) {
+                    snprintf(err, err_len, "invalid tenant");
+                    goto fail;
+                }
+                if (use_tenant(job->spec.tenant) != 0) {
+                    snprintf(err, err_len, "more than %d tenants", MAX_TENANTS);
+                    goto fail;
+                }
+                break;
+            case TAG_PRIORITY:
+                if (get_field_str(value, len, str, sizeof(str), err, err_len) != 0) goto fail;
+                if (job_parse_priority(str, &job->spec.priority) != 0) {
+                    snprintf(err, err_len, "unknown priority %.64s", str);
+                    goto fail;
+                }
+                break;
+            case TAG_MEMORY_MB: job->spec.limits.memory_mb = proto_get_u32(value, len); break;
+            case TAG_NPROC: job->spec.limits.nproc = (int)proto_get_u32(value, len); break;
+            case TAG_NOFILE: job->spec.limits.nofile = (int)proto_get_u32(value, len); break;
+            case TAG_TIME_MS: job->spec.limits.time_ms = proto_get_u32(value, len); break;
+            case TAG_MEM_SOFT: job->spec.mem_soft = proto_get_u32(value, len) != 0; break;
+            case TAG_CPU_QUOTA_US: job->spec.cpu_quota_us = proto_get_u32(value, len); break;
+            case TAG_ID:
+                if (get_field_str(value, len, str, sizeof(str), err, err_len) != 0) goto fail;
+                snprintf(job->spec.id, sizeof(job->spec.id), "%.63s", str);
+                break;
+            default:
+                break;      // Newer client: ignore fields we do not know
+        }
+    }
+    if (rc < 0) {
+        snprintf(err, err_len, "truncated field");
+        goto fail;
+    }
+    if (!job->argv[0]) {
+        snprintf(err, err_len, "missing binary");
+        goto fail;
+    }
+    job->argv[argc] = NULL;
+    job->spec.binary_path = job->argv[0];
+    job->spec.args = job->argv;
+    return job;
+
+fail:
+    free_job(job);
+    return NULL;
+}
+
+static void *reader_main(void *arg) {
+    conn_t *conn = (conn_t *)arg;
+    static __thread uint8_t payload[PROTO_MAX_PAYLOAD];
+    proto_header_t hdr;
+
+    while (proto_read_frame(conn->fd, &hdr, payload, sizeof(payload)) == 0) {
+        if (hdr.type != MSG_SUBMIT) {
+            send_error(conn, hdr.job_tag, "unexpected message");
+            continue;
+        }
+
+        char err[128];
+        daemon_job_t *job = parse_submit(payload, hdr.length, err, sizeof(err));
+        if (!job) {
+            send_error(conn, hdr.job_tag, err);
+            continue;
+        }
+        job->conn = conn;
+        job->tag = hdr.job_tag;
+        job->submitted_ms = get_current_time_ms();
+
+        pthread_mutex_lock(&conn->lock);
+        conn->refs++;
+        pthread_mutex_unlock(&conn->lock);
+
+        pthread_mutex_lock(&queue.lock);
+        if (queue.tail) queue.tail->next = job; else queue.head = job;
+        queue.tail = job;
+        pthread_cond_signal(&queue.ready);
+        pthread_mutex_unlock(&queue.lock);
+    }
+
+    conn_release(conn);
+    return NULL;
+}
+
+// -------------------------------------------------------------
+// Workers
+// -------------------------------------------------------------
+
+static void stream_sample(void *ctx, const telemetry_sample_t *sample) {
+    daemon_job_t *job = (daemon_job_t *)ctx;
+    proto_sample_t out = {
+        sample->time_ms, sample->cpu_time_ms, sample->memory_kb,
+        sample->majflt, sample->cpu_percent, sample->cpu
+    };
+    if (conn_send_sample(job->conn, job->tag, &out) != 0) job->samples_dropped++;
+}
+
+static void send_result(daemon_job_t *job, const job_result_t *res) {
+    static __thread proto_buf_t b;
+    proto_buf_init(&b);
+    proto_put_u32(&b, TAG_PID, (uint32_t)res->pid);
+    proto_put_str(&b, TAG_EXIT_REASON, res->exit_reason);
+    proto_put_i64(&b, TAG_RUNTIME_MS, res->runtime_ms);
+    proto_put_u32(&b, TAG_PEAK_CPU, (uint32_t)res->cpu_usage_percent);
+    proto_put_i64(&b, TAG_PEAK_MEMORY_KB, res->memory_peak_kb);
+    proto_put_i64(&b, TAG_CPU_TIME_MS, res->cpu_time_ms);
+    proto_put_i64(&b, TAG_QUEUE_WAIT_MS, job->spec.queue_wait_ms);
+    proto_put_str(&b, TAG_LOG_PATH, res->log_path);
+    proto_put_i64(&b, TAG_SAMPLES_DROPPED, job->samples_dropped);
+    conn_send(job->conn, MSG_RESULT, job->tag, b.buf, b.len);
+}
+
+static void *worker_main(void *arg) {
+    (void)arg;
+    for (;;) {
+        pthread_mutex_lock(&queue.lock);
+        while (!queue.head && !queue.stopping) pthread_cond_wait(&queue.ready, &queue.lock);
+        daemon_job_t *job = queue.head;
+        if (job) {
+            queue.head = job->next;
+            if (!queue.head) queue.tail = NULL;
+        }
+        pthread_mutex_unlock(&queue.lock);
+        if (!job) break;    // Stopping and drained
+
+        job->spec.filter = &filters[job->spec.profile];
+        job->spec.queue_wait_ms = get_current_time_ms() - job->submitted_ms;
+        job->spec.on_sample = stream_sample;
+        job->spec.sample_ctx = job;
+
+        job_result_t res = {0};
+        if (metrics_run_job(&job->spec, &res) == 0) {
+            send_result(job, &res);
+        } else {
+            send_error(job->conn, job->tag, "LAUNCH_FAILED");
+        }
+
+        conn_release(job->conn);
+        free_job(job);
+    }
+    return NULL;
+}
+
+// -------------------------------------------------------------
+// Daemon
+// -------------------------------------------------------------
+
+int sandboxd_run(const char *socket_path, const sandboxd_config_t *config) {
+    defaults = config->defaults;
+    int worker_count = config->workers > 0 ? config->workers : (int)sysconf(_SC_NPROCESSORS_ONLN);
+
+    struct sockaddr_un addr = { .sun_family = AF_UNIX };
+    if (strlen(socket_path) >= sizeof(addr.sun_path)) {
+        fprintf(stderr, "[Sandboxd] Socket path too long: %s\n", socket_path);
+        return 1;
+    }
+    snprintf(addr.sun_path, sizeof(addr.sun_path), "%s", socket_path);
+
+    // Everything a one-shot launcher repeats per job happens once, here
+    for (int p = PROFILE_STRICT; p <= PROFILE_LEARNING; p++) {
+        if (job_compile_filter((sandbox_profile_t)p, &filters[p]) != 0) return 1;
+    }
+    ensure_logs_directory();
+
+    // Tenant level of the hierarchy: sandbox_project/<tenant>, with its limits
+    for (int t = 0; t < config->tenant_count && t < MAX_TENANTS; t++) {
+        tenants.list[tenants.count] = config->tenants[t];
+        if (tenant_setup_cgroup(&tenants.list[tenants.count]) != 0) {
+            fprintf(stderr, "[Tenant] WARNING: could not apply cgroup limits for '%s'.\n", config->tenants[t].name);
+        }
+        tenants.count++;
+    }
+
+    int listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (listen_fd < 0) {
+        perror("socket");
+        return 1;
+    }
+    unlink(socket_path);
+    // Owner-only until bound: jobs run with our privileges
+    mode_t old_mask = umask(0177);
+    int bound = bind(listen_fd, (struct sockaddr *)&addr, sizeof(addr));
+    umask(old_mask);
+    if (bound != 0 || listen(listen_fd, 64) != 0) {
+        perror("bind/listen");
+        close(listen_fd);
+        return 1;
+    }
+
+    struct sigaction sa = {0};
+    sa.sa_handler = handle_stop;
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+    signal(SIGPIPE, SIG_IGN);
+
+    pthread_t *workers = calloc(worker_count, sizeof(pthread_t));
+    for (int w = 0; w < worker_count; w++) pthread_create(&workers[w], NULL, worker_main, NULL);
+
+    fprintf(stderr, "[Sandboxd] Listening on %s with %d workers\n", socket_path, worker_count);
+
+    while (!stop_requested) {
+        struct pollfd pfd = { listen_fd, POLLIN, 0 };
+        if (poll(&pfd, 1, 500) <= 0) continue;
+
+        int fd = accept4(listen_fd, NULL, NULL, SOCK_CLOEXEC);
+        if (fd < 0) continue;
+
+        // Bounds how long a worker waits on a client that stopped reading
+        struct timeval timeout = { SEND_TIMEOUT_SEC, 0 };
+        setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+        conn_t *conn = calloc(1, sizeof(*conn));
+        conn->fd = fd;
+        conn->refs = 1;     // The reader's reference
+        pthread_mutex_init(&conn->lock, NULL);
+
+        pthread_t reader;
+        pthread_attr_t attr;
+        pthread_attr_init(&attr);
+        pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+        if (pthread_create(&reader, &attr, reader_main, conn) != 0) conn_release(conn);
+        pthread_attr_destroy(&attr);
+    }
+
+    // Stop accepting, finish what was already submitted
+    fprintf(stderr, "[Sandboxd] Shutting down, draining queue...\n");
+    close(listen_fd);
+    unlink(socket_path);
+
+    pthread_mutex_lock(&queue.lock);
+    queue.stopping = 1;
+    pthread_cond_broadcast(&queue.ready);
+    pthread_mutex_unlock(&queue.lock);
+    for (int w = 0; w < worker_count; w++) pthread_join(workers[w], NULL);
+    free(workers);
+
+    for (int p = PROFILE_STRICT; p <= PROFILE_LEARNING; p++) free(filters[p].filter);
+    // Still in use by another launcher's runs: rmdir fails and it stays
+    for (int t = 0; t < tenants.count; t++) {
+        if (tenants.list[t].cgroup[0]) cgroup_remove(tenants.list[t].cgroup);
+    }
+    return 0;
+}
+
+// -------------------------------------------------------------
+// Client
+// -------------------------------------------------------------
+
+int sandboxd_submit(const char *socket_path, const job_spec_t *spec, const char *policy_spec) {
+    struct sockaddr_un addr = { .sun_family = AF_UNIX };
+    snprintf(addr.sun_path, sizeof(addr.sun_path), "%s", socket_path);
+
+    long start = get_current_time_ms();
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0 || connect(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+        perror("connect sandboxd");
+        if (fd >= 0) close(fd);
+        return 1;
+    }
+
+    static proto_buf_t b;
+    proto_buf_init(&b);
+    if (spec->id[0]) proto_put_str(&b, TAG_ID, spec->id);
+    proto_put_str(&b, TAG_BINARY, spec->binary_path);
+    for (int a = 1; spec->args[a]; a++) proto_put_str(&b, TAG_ARG, spec->args[a]);
+    proto_put_str(&b, TAG_PROFILE, spec->profile_name);
+    if (policy_spec) proto_put_str(&b, TAG_POLICY, policy_spec);
+    if (spec->tenant[0]) proto_put_str(&b, TAG_TENANT, spec->tenant);
+    proto_put_u32(&b, TAG_MEMORY_MB, (uint32_t)spec->limits.memory_mb);
+    proto_put_u32(&b, TAG_NPROC, (uint32_t)spec->limits.nproc);
+    proto_put_u32(&b, TAG_NOFILE, (uint32_t)spec->limits.nofile);
+    proto_put_u32(&b, TAG_TIME_MS, (uint32_t)spec->limits.time_ms);
+    proto_put_u32(&b, TAG_MEM_SOFT, (uint32_t)spec->mem_soft);
+    if (b.overflow || proto_write_frame(fd, MSG_SUBMIT, 1, b.buf, b.len) != 0) {
+        fprintf(stderr, "[Client] Could not send submission\n");
+        close(fd);
+        return 1;
+    }
+
+    static uint8_t payload[PROTO_MAX_PAYLOAD];
+    proto_header_t hdr;
+    int samples = 0, rc = 1;
+    long long dropped = 0;
+    while (proto_read_frame(fd, &hdr, payload, sizeof(payload)) == 0) {
+        if (hdr.type == MSG_SAMPLE) {
+            samples++;
+            continue;
+        }
+        if (hdr.type == MSG_ERROR) {
+            char msg[256];
+            proto_get_str(payload, hdr.length, msg, sizeof(msg));
+            fprintf(stderr, "[Client] sandboxd error: %s\n", msg);
+            break;
+        }
+        if (hdr.type != MSG_RESULT) continue;
+
+        char exit_reason[32] = "", log_path[128] = "", esc[JSON_STR_MAX];
+        long long runtime = 0, mem = 0, cpu_ms = 0, wait_ms = 0;
+        unsigned pid = 0, peak_cpu = 0;
+        size_t offset = 0;
+        uint16_t tag, len;
+        const uint8_t *value;
+        while (proto_next(payload, hdr.length, &offset, &tag, &value, &len) == 1) {
+            switch (tag) {
+                case TAG_PID: pid = proto_get_u32(value, len); break;
+                case TAG_EXIT_REASON: proto_get_str(value, len, exit_reason, sizeof(exit_reason)); break;
+                case TAG_RUNTIME_MS: runtime = proto_get_i64(value, len); break;
+                case TAG_PEAK_CPU: peak_cpu = proto_get_u32(value, len); break;
+                case TAG_PEAK_MEMORY_KB: mem = proto_get_i64(value, len); break;
+                case TAG_CPU_TIME_MS: cpu_ms = proto_get_i64(value, len); break;
+                case TAG_QUEUE_WAIT_MS: wait_ms = proto_get_i64(value, len); break;
+                case TAG_LOG_PATH: proto_get_str(value, len, log_path, sizeof(log_path)); break;
+                case TAG_SAMPLES_DROPPED: dropped = proto_get_i64(value, len); break;
+                default: break;
+            }
+        }
+        printf("{\"pid\": %u, \"exit_reason\": \"%s\", \"runtime_ms\": %lld, \"peak_cpu\": %u, "
+               "\"peak_memory_kb\": %lld, \"cpu_time_ms\": %lld, \"queue_wait_ms\": %lld, \"log\": \"%s\"}\n",
+               pid, exit_reason, runtime, peak_cpu, mem, cpu_ms, wait_ms, json_escape(log_path, esc, sizeof(esc)));
+        rc = 0;
+        break;
+    }
+    close(fd);
+
+    fprintf(stderr, "[Client] Submit-to-result latency: %ld ms (%d samples streamed, %lld dropped)\n",
+            get_current_time_ms() - start, samples, dropped);
+    return rc;
+}
@@ -0,0 +1,21 @@
+#ifndef SANDBOXD_H
+#define SANDBOXD_H
+
+#include "job.h"
+#include "tenant.h"
+
+// Resident supervisor options from the launcher's command line
+typedef struct {
+    int workers;                    // Concurrent jobs (0 = one per online core)
+    const job_spec_t *defaults;     // Submissions start from these
+    const tenant_t *tenants;        // --tenant definitions; others get default limits on first use
+    int tenant_count;
+} sandboxd_config_t;
+
+// Serve job submissions on a Unix socket until SIGINT/SIGTERM
+int sandboxd_run(const char *socket_path, const sandboxd_config_t *config);
+
+// Client side: submit one job, stream its samples, print the result
+int sandboxd_submit(const char *socket_path, const job_spec_t *spec, const char *policy_spec);
+
+#endif
@@ -0,0 +1,413 @@
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include "libsandbox.h"
+
+/**
+ * PYTHON BINDING (_sandbox, built with `make python`)
+ *
+ * Runs sandboxes in-process through libsandbox, so sandbox.py and the
+ * dashboard tooling need neither a launcher process nor its JSON log:
+ *
+ *   s = _sandbox.spawn("/tmp/prog", profile="LEARNING", cgroup=path)
+ *   while not s.poll(100):
+ *       s.sample()                   # dict, or None once the job has ended
+ *   result = s.wait()                # summary fields + "samples"
+ *   view = memoryview(result["samples"])
+ *
+ * Samples are packed records (sample_record_t) exported through the buffer
+ * protocol with format SAMPLE_FORMAT, so numpy.frombuffer() or struct can
+ * read them without a copy. The GIL is released while waiting.
+ */
+
+// One sample as exported to Python (field order matches SAMPLE_FIELDS)
+typedef struct {
+    int64_t time_ms;
+    int64_t cpu_time_ms;
+    int64_t memory_kb;
+    uint64_t majflt;
+    int32_t cpu_percent;
+    int32_t cpu;
+} sample_record_t;
+
+#define SAMPLE_FORMAT "qqqQii"
+
+static const char *sample_fields[] = { "time_ms", "cpu_time_ms", "memory_kb", "majflt", "cpu_percent", "cpu" };
+
+static PyObject *record_tuple(const sample_record_t *r) {
+    return Py_BuildValue("(LLLKii)", (long long)r->time_ms, (long long)r->cpu_time_ms, (long long)r->memory_kb,
+                         (unsigned long long)r->majflt, (int)r->cpu_percent, (int)r->cpu);
+}
+
+// -------------------------------------------------------------
+// Samples: read-only record array (buffer protocol + sequence)
+// -------------------------------------------------------------
+
+typedef struct {
+    PyObject_HEAD
+    sample_record_t *records;
+    Py_ssize_t count;
+} SamplesObject;
+
+static void samples_dealloc(SamplesObject *self) {
+    free(self->records);
+    Py_TYPE(self)->tp_free((PyObject *)self);
+}
+
+static int samples_getbuffer(SamplesObject *self, Py_buffer *view, int flags) {
+    if (PyBuffer_FillInfo(view, (PyObject *)self, self->records, self->count * sizeof(sample_record_t), 1, flags) < 0) {
+        return -1;
+    }
+    // Without a format the consumer asked for plain bytes
+    if ((flags & PyBUF_FORMAT) == PyBUF_FORMAT) {
+        view->format = SAMPLE_FORMAT;
+        view->itemsize = sizeof(sample_record_t);
+        if ((flags & PyBUF_ND) == PyBUF_ND) view->shape = &self->count;
+    }
+    return 0;
+}
+
+static Py_ssize_t samples_length(SamplesObject *self) {
+    return self->count;
+}
+
+static PyObject *samples_item(SamplesObject *self, Py_ssize_t i) {
+    if (i < 0 || i >= self->count) {
+        PyErr_SetString(PyExc_IndexError, "sample index out of range");
+        return NULL;
+    }
+    return record_tuple(&self->records[i]);
+}
+
+static PyBufferProcs samples_as_buffer = {
+    .bf_getbuffer = (getbufferproc)samples_getbuffer,
+};
+
+static PySequenceMethods samples_as_sequence = {
+    .sq_length = (lenfunc)samples_length,
+    .sq_item = (ssizeargfunc)samples_item,
+};
+
+static PyTypeObject SamplesType = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    .tp_name = "_sandbox.Samples",
+    .tp_doc = "Monitoring samples of one job (records of SAMPLE_FORMAT)",
+    .tp_basicsize = sizeof(SamplesObject),
+    .tp_flags = Py_TPFLAGS_DEFAULT,
+    .tp_dealloc = (destructor)samples_dealloc,
+    .tp_as_buffer = &samples_as_buffer,
+    .tp_as_sequence = &samples_as_sequence,
+};
+
+// -------------------------------------------------------------
+// Sandbox: one running job
+// -------------------------------------------------------------
+
+typedef struct {
+    PyObject_HEAD
+    sbx_handle_t *handle;       // NULL once waited
+    pid_t pid;
+    int pidfd;
+    int busy;                   // A call is running without the GIL
+    char *binary;               // Referenced by the job until it is waited
+    char **argv;
+    char *cgroup;
+    char *capture_dir;
+    sample_record_t *records;   // Filled by on_sample, handed to Samples
+    Py_ssize_t count;
+    Py_ssize_t cap;
+} SandboxObject;
+
+// Called from sbx_sample (possibly without the GIL): no Python API here
+static void collect_sample(void *ctx, const telemetry_sample_t *s) {
+    SandboxObject *self = (SandboxObject *)ctx;
+    if (self->count == self->cap) {
+        Py_ssize_t cap = self->cap ? self->cap * 2 : 64;
+        sample_record_t *grown = realloc(self->records, cap * sizeof(sample_record_t));
+        if (!grown) return;
+        self->records = grown;
+        self->cap = cap;
+    }
+    sample_record_t *r = &self->records[self->count++];
+    r->time_ms = s->time_ms;
+    r->cpu_time_ms = s->cpu_time_ms;
+    r->memory_kb = s->memory_kb;
+    r->majflt = s->majflt;
+    r->cpu_percent = s->cpu_percent;
+    r->cpu = s->cpu;
+}
+
+static void free_strings(SandboxObject *self) {
+    if (self->argv) {
+        for (char **a = self->argv; *a; a++) free(*a);
+        free(self->argv);
+        self->argv = NULL;
+    }
+    free(self->binary);
+    free(self->cgroup);
+    free(self->capture_dir);
+    self->binary = NULL;
+    self->cgroup = NULL;
+    self->capture_dir = NULL;
+}
+
+static int check_idle(SandboxObject *self) {
+    if (self->busy) {
+        PyErr_SetString(PyExc_RuntimeError, "sandbox is in use by another thread");
+        return -1;
+    }
+    return 0;
+}
+
+static void sandbox_dealloc(SandboxObject *self) {
+    // Never leave a sandboxed child behind: kill, reap and log it
+    if (self->handle) {
+        kill(self->pid, SIGKILL);
+        Py_BEGIN_ALLOW_THREADS
+        sbx_wait(self->handle, NULL);
+        Py_END_ALLOW_THREADS
+    }
+    free(self->records);
+    free_strings(self);
+    Py_TYPE(self)->tp_free((PyObject *)self);
+}
+
+static PyObject *sandbox_fileno(SandboxObject *self, PyObject *Py_UNUSED(ignored)) {
+    if (self->pidfd < 0) {
+        PyErr_SetString(PyExc_OSError, "no pidfd (pidfd_open unavailable or job already waited)");
+        return NULL;
+    }
+    return PyLong_FromLong(self->pidfd);
+}
+
+static PyObject *sandbox_poll(SandboxObject *self, PyObject *args) {
+    int timeout_ms = 0;
+    if (!PyArg_ParseTuple(args, "|i", &timeout_ms)) return NULL;
+    if (!self->handle) Py_RETURN_TRUE;
+    if (check_idle(self) != 0) return NULL;
+
+    int done;
+    self->busy = 1;
+    Py_BEGIN_ALLOW_THREADS
+    done = sbx_poll(self->handle, timeout_ms);
+    Py_END_ALLOW_THREADS
+    self->busy = 0;
+    return PyBool_FromLong(done);
+}
+
+static PyObject *sandbox_sample(SandboxObject *self, PyObject *Py_UNUSED(ignored)) {
+    if (!self->handle) Py_RETURN_NONE;
+    if (check_idle(self) != 0) return NULL;
+
+    telemetry_sample_t s;
+    if (sbx_sample(self->handle, &s) != 0) Py_RETURN_NONE;
+    return Py_BuildValue("{s:l,s:l,s:l,s:k,s:i,s:i,s:k}", "time_ms", s.time_ms, "cpu_time_ms", s.cpu_time_ms,
+                         "memory_kb", s.memory_kb, "majflt", s.majflt, "cpu_percent", s.cpu_percent,
+                         "cpu", s.cpu, "migrations", s.migrations);
+}
+
+static PyObject *sandbox_wait(SandboxObject *self, PyObject *Py_UNUSED(ignored)) {
+    if (!self->handle) {
+        PyErr_SetString(PyExc_RuntimeError, "sandbox already waited");
+        return NULL;
+    }
+    if (check_idle(self) != 0) return NULL;
+
+    sbx_result_t res = {0};
+    self->busy = 1;
+    Py_BEGIN_ALLOW_THREADS
+    sbx_wait(self->handle, &res);
+    Py_END_ALLOW_THREADS
+    self->busy = 0;
+    self->handle = NULL;
+    self->pidfd = -1;
+    free_strings(self);
+
+    // The records move to the Samples object as they are
+    SamplesObject *samples = PyObject_New(SamplesObject, &SamplesType);
+    if (!samples) return NULL;
+    samples->records = self->records;
+    samples->count = self->count;
+    self->records = NULL;
+    self->count = self->cap = 0;
+
+    return Py_BuildValue("{s:i,s:s,s:l,s:i,s:l,s:l,s:l,s:d,s:s,s:N}", "pid", (int)res.pid,
+                         "exit_reason", res.exit_reason, "runtime_ms", res.runtime_ms,
+                         "cpu_usage_percent", res.cpu_usage_percent, "memory_peak_kb", res.memory_peak_kb,
+                         "cpu_time_ms", res.cpu_time_ms, "frozen_ms", res.frozen_ms,
+                         "mem_gb_seconds", res.mem_gb_seconds, "log_path", res.log_path,
+                         "samples", (PyObject *)samples);
+}
+
+static PyObject *sandbox_get_pid(SandboxObject *self, void *Py_UNUSED(closure)) {
+    return PyLong_FromLong(self->pid);
+}
+
+static PyMethodDef sandbox_methods[] = {
+    {"fileno", (PyCFunction)sandbox_fileno, METH_NOARGS, "The job's pidfd (readable once it has exited)"},
+    {"poll", (PyCFunction)sandbox_poll, METH_VARARGS, "poll(timeout_ms=0) -> True once the job has exited"},
+    {"sample", (PyCFunction)sandbox_sample, METH_NOARGS, "Take one sample (dict), None once the job has ended"},
+    {"wait", (PyCFunction)sandbox_wait, METH_NOARGS, "Monitor to completion; returns the result dict"},
+    {NULL, NULL, 0, NULL}
+};
+
+static PyGetSetDef sandbox_getset[] = {
+    {"pid", (getter)sandbox_get_pid, NULL, "Host PID of the sandboxed child", NULL},
+    {NULL, NULL, NULL, NULL, NULL}
+};
+
+static PyTypeObject SandboxType = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    .tp_name = "_sandbox.Sandbox",
+    .tp_doc = "A running sandboxed job (see _sandbox.spawn)",
+    .tp_basicsize = sizeof(SandboxObject),
+    .tp_flags = Py_TPFLAGS_DEFAULT,
+    .tp_dealloc = (destructor)sandbox_dealloc,
+    .tp_methods = sandbox_methods,
+    .tp_getset = sandbox_getset,
+};
+
+// -------------------------------------------------------------
+// spawn(binary, args=(), profile="STRICT", ...)
+// -------------------------------------------------------------
+
+static PyObject *sandbox_spawn(PyObject *Py_UNUSED(module), PyObject *args, PyObject *kwargs) {
+    static char *keywords[] = { "binary", "args", "profile", "policy", "memory_mb", "nproc", "nofile", "time_ms",
+                                "mem_soft", "tenant", "cgroup", "stdout", "stderr", "quiet", "capture_dir",
+                                "capture_limit", NULL };
+    const char *binary, *profile = "STRICT", *policy = NULL, *tenant = NULL, *cgroup = NULL, *capture_dir = NULL;
+    PyObject *argv_obj = NULL;
+    long memory_mb = 128, time_ms = 0, capture_limit = 1024 * 1024;
+    int nproc = 20, nofile = 64, mem_soft = 0, stdout_fd = -1, stderr_fd = -1, quiet = 1;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "s|Ozzliilpzziipzl", keywords, &binary, &argv_obj, &profile,
+                                     &policy, &memory_mb, &nproc, &nofile, &time_ms, &mem_soft, &tenant, &cgroup,
+                                     &stdout_fd, &stderr_fd, &quiet, &capture_dir, &capture_limit)) {
+        return NULL;
+    }
+
+    sbx_config_t config;
+    sbx_config_init(&config);
+    if (job_parse_profile(profile, &config.profile, &config.profile_name) != 0) {
+        PyErr_Format(PyExc_ValueError, "unknown profile '%s'", profile);
+        return NULL;
+    }
+    if (policy && policy_parse(policy, &config.policy) != 0) {
+        PyErr_Format(PyExc_ValueError, "invalid policy '%s'", policy);
+        return NULL;
+    }
+    config.limits.memory_mb = memory_mb;
+    config.limits.nproc = nproc;
+    config.limits.nofile = nofile;
+    config.limits.time_ms = time_ms;
+    config.mem_soft = mem_soft;
+    config.stdout_fd = stdout_fd;
+    config.stderr_fd = stderr_fd;
+    config.quiet = quiet;
+    config.capture_limit = capture_limit;
+    if (tenant && job_parse_tenant(tenant, config.tenant, sizeof(config.tenant)) != 0) {
+        PyErr_Format(PyExc_ValueError, "invalid tenant '%s'", tenant);
+        return NULL;
+    }
+
+    PyObject *seq = (argv_obj && argv_obj != Py_None) ? PySequence_Fast(argv_obj, "args must be a sequence of str")
+                                                       : PyTuple_New(0);
+    if (!seq) return NULL;
+
+    SandboxObject *self = PyObject_New(SandboxObject, &SandboxType);
+    if (!self) {
+        Py_DECREF(seq);
+        return NULL;
+    }
+    self->handle = NULL;
+    self->pid = 0;
+    self->pidfd = -1;
+    self->busy = 0;
+    self->records = NULL;
+    self->count = self->cap = 0;
+    self->cgroup = cgroup ? strdup(cgroup) : NULL;
+    self->capture_dir = capture_dir ? strdup(capture_dir) : NULL;
+    self->binary = strdup(binary);
+
+    // argv[0] is the binary, as for the launcher
+    Py_ssize_t n = PySequence_Fast_GET_SIZE(seq);
+    self->argv = calloc(n + 2, sizeof(char *));
+    if (self->argv) self->argv[0] = strdup(binary);
+    for (Py_ssize_t i = 0; self->argv && i < n; i++) {
+        const char *arg = PyUnicode_AsUTF8(PySequence_Fast_GET_ITEM(seq, i));
+        if (!arg) {
+            Py_DECREF(seq);
+            Py_DECREF(self);
+            return NULL;
+        }
+        self->argv[i + 1] = strdup(arg);
+    }
+    Py_DECREF(seq);
+    if (!self->binary || !self->argv) {
+        Py_DECREF(self);
+        return PyErr_NoMemory();
+    }
+
+    config.binary_path = self->binary;
+    config.args = self->argv;
+    config.cgroup = self->cgroup;
+    config.capture_dir = self->capture_dir;
+    config.on_sample = collect_sample;
+    config.sample_ctx = self;
+
+    ensure_logs_directory();
+    self->handle = sbx_spawn(&config);
+    if (!self->handle) {
+        Py_DECREF(self);
+        PyErr_Format(PyExc_OSError, "could not create the sandbox for %s", binary);
+        return NULL;
+    }
+    self->pid = sbx_pid(self->handle);
+    self->pidfd = sbx_pidfd(self->handle);
+    return (PyObject *)self;
+}
+
+static PyMethodDef module_methods[] = {
+    {"spawn", (PyCFunction)(void (*)(void))sandbox_spawn, METH_VARARGS | METH_KEYWORDS,
+     "spawn(binary, args=(), profile='STRICT', policy=None, memory_mb=128, nproc=20, nofile=64, time_ms=0,\n"
+     "      mem_soft=False, tenant=None, cgroup=None, stdout=-1, stderr=-1, quiet=True, capture_dir=None,\n"
+     "      capture_limit=1048576) -> Sandbox\n"
+     "capture_dir: stdout/stderr left at -1 go to capture_dir/run_<pid>.stdout|.stderr, capture_limit bytes each"},
+    {NULL, NULL, 0, NULL}
+};
+
+static struct PyModuleDef sandbox_module = {
+    PyModuleDef_HEAD_INIT,
+    .m_name = "_sandbox",
+    .m_doc = "In-process sandboxes through libsandbox",
+    .m_size = -1,
+    .m_methods = module_methods,
+};
+
+PyMODINIT_FUNC PyInit__sandbox(void) {
+    if (PyType_Ready(&SamplesType) < 0 || PyType_Ready(&SandboxType) < 0) return NULL;
+
+    PyObject *m = PyModule_Create(&sandbox_module);
+    if (!m) return NULL;
+
+    PyObject *fields = PyTuple_New(sizeof(sample_fields) / sizeof(sample_fields[0]));
+    for (size_t i = 0; fields && i < sizeof(sample_fields) / sizeof(sample_fields[0]); i++) {
+        PyTuple_SET_ITEM(fields, i, PyUnicode_FromString(sample_fields[i]));
+    }
+    if (PyModule_AddObject(m, "SAMPLE_FIELDS", fields) < 0 ||
+        PyModule_AddStringConstant(m, "SAMPLE_FORMAT", SAMPLE_FORMAT) < 0 ||
+        PyModule_AddIntConstant(m, "SAMPLE_MS", SBX_SAMPLE_MS) < 0) {
+        Py_XDECREF(fields);
+        Py_DECREF(m);
+        return NULL;
+    }
+
+    Py_INCREF(&SamplesType);
+    PyModule_AddObject(m, "Samples", (PyObject *)&SamplesType);
+    Py_INCREF(&SandboxType);
+    PyModule_AddObject(m, "Sandbox", (PyObject *)&SandboxType);
+    return m;
+}
@@ -0,0 +1,163 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <unistd.h>
+#include <sys/mount.h>
+#include <sys/stat.h>
+#include <sys/statvfs.h>
+#include "scratch.h"
+
+/**
+ * SCRATCH AREAS (--scratch-mb)
+ *
+ * The sandbox's root is read-only, so a job that needs temp files gets a
+ * tmpfs at /tmp capped in size and inodes. A single run's child mounts its
+ * own. Batch and daemon mode keep a pool instead, two tmpfs mounts per
+ * worker under DIR/slot_<i>: a job takes a clean slot and the child only
+ * bind-mounts it. A used slot is not emptied file by file, and not on the
+ * job's path either: scratch_release only marks it dirty, and the recycler
+ * thread detaches its tmpfs and mounts a fresh one while the spare slots
+ * serve the next jobs.
+ *
+ * Pre-mounting needs CAP_SYS_ADMIN; without it every child mounts its own,
+ * which its user namespace allows (map_ids in job.c picks the uid its files
+ * are created under).
+ */
+
+enum {
+    SLOT_READY,                 // Fresh tmpfs, nobody has used it
+    SLOT_BUSY,                  // Bound at a running job's /tmp
+    SLOT_DIRTY,                 // Job done, waiting for the recycler
+    SLOT_BROKEN                 // Could not be remounted, never handed out again
+};
+
+int scratch_mount_options(long size_mb, long inodes, char *buf, size_t len) {
+    int n = snprintf(buf, len, "size=%ldm,nr_inodes=%ld,mode=1777", size_mb, inodes);
+    return (n < 0 || (size_t)n >= len) ? -1 : 0;
+}
+
+static int mount_slot(const scratch_pool_t *pool, int slot) {
+    char path[300], options[64];
+    snprintf(path, sizeof(path), "%s/slot_%d", pool->dir, slot);
+    scratch_mount_options(pool->size_mb, pool->inodes, options, sizeof(options));
+    return mount("tmpfs", path, "tmpfs", MS_NOSUID | MS_NODEV, options);
+}
+
+// Create and mount slot pool->count (caller holds the lock or owns the pool)
+static int add_slot(scratch_pool_t *pool) {
+    char path[300];
+    snprintf(path, sizeof(path), "%s/slot_%d", pool->dir, pool->count);
+    if (mkdir(path, 0755) != 0 && errno != EEXIST) return -1;
+    // Left over from a launcher that did not get to clean up
+    umount2(path, MNT_DETACH);
+    if (mount_slot(pool, pool->count) != 0) return -1;
+    pool->state[pool->count++] = SLOT_READY;
+    return 0;
+}
+
+// Swaps fresh tmpfs mounts in for the ones jobs have finished with
+static void *recycler_main(void *arg) {
+    scratch_pool_t *pool = arg;
+    pthread_mutex_lock(&pool->lock);
+    while (!pool->stopping) {
+        int slot = -1;
+        for (int i = 0; i < pool->count && slot < 0; i++) {
+            if (pool->state[i] == SLOT_DIRTY) slot = i;
+        }
+        if (slot < 0) {
+            pthread_cond_wait(&pool->dirty, &pool->lock);
+            continue;
+        }
+        pthread_mutex_unlock(&pool->lock);
+
+        char path[300];
+        snprintf(path, sizeof(path), "%s/slot_%d", pool->dir, slot);
+        umount2(path, MNT_DETACH);
+        int rc = mount_slot(pool, slot);
+        if (rc != 0) perror("scratch remount");
+
+        pthread_mutex_lock(&pool->lock);
+        // Never hand out a slot that may still hold the last job's files
+        pool->state[slot] = rc == 0 ? SLOT_READY : SLOT_BROKEN;
+    }
+    pthread_mutex_unlock(&pool->lock);
+    return NULL;
+}
+
+int scratch_pool_init(scratch_pool_t *pool, const char *dir, int workers, long size_mb, long inodes) {
+    memset(pool, 0, sizeof(*pool));
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->dirty, NULL);
+    pool->size_mb = size_mb;
+    pool->inodes = inodes;
+    // One slot in use and one clean spare per worker
+    int slots = workers * 2 > SCRATCH_MAX_SLOTS ? SCRATCH_MAX_SLOTS : workers * 2;
+
+    // Absolute, so the path means the same thing to the child
+    char real[PATH_MAX];
+    if (mkdir(dir, 0755) != 0 && errno != EEXIST) return -1;
+    if (!realpath(dir, real) || strlen(real) >= sizeof(pool->dir)) return -1;
+    snprintf(pool->dir, sizeof(pool->dir), "%s", real);
+    while (pool->count < slots) {
+        if (add_slot(pool) != 0) return -1;
+    }
+    if (pthread_create(&pool->recycler, NULL, recycler_main, pool) != 0) return -1;
+    pool->recycling = 1;
+    return 0;
+}
+
+void scratch_pool_destroy(scratch_pool_t *pool) {
+    if (pool->recycling) {
+        pthread_mutex_lock(&pool->lock);
+        pool->stopping = 1;
+        pthread_cond_signal(&pool->dirty);
+        pthread_mutex_unlock(&pool->lock);
+        pthread_join(pool->recycler, NULL);
+        pool->recycling = 0;
+    }
+    for (int i = 0; i < pool->count; i++) {
+        char path[300];
+        snprintf(path, sizeof(path), "%s/slot_%d", pool->dir, i);
+        umount2(path, MNT_DETACH);
+        rmdir(path);
+    }
+    pool->count = 0;
+}
+
+// A clean slot for one job (its path in 'path'). When the spares are all
+// taken or still being recycled the pool grows by a slot, up to
+// SCRATCH_MAX_SLOTS; -1 beyond that.
+int scratch_acquire(scratch_pool_t *pool, char *path, size_t len) {
+    int slot = -1;
+    pthread_mutex_lock(&pool->lock);
+    for (int i = 0; i < pool->count && slot < 0; i++) {
+        if (pool->state[i] == SLOT_READY) slot = i;
+    }
+    if (slot < 0 && pool->count < SCRATCH_MAX_SLOTS && add_slot(pool) == 0) slot = pool->count - 1;
+    if (slot >= 0) pool->state[slot] = SLOT_BUSY;
+    pthread_mutex_unlock(&pool->lock);
+
+    if (slot >= 0) snprintf(path, len, "%s/slot_%d", pool->dir, slot);
+    return slot;
+}
+
+// The job is gone: its slot goes to the recycler, no mount work here
+void scratch_release(scratch_pool_t *pool, int slot) {
+    pthread_mutex_lock(&pool->lock);
+    pool->state[slot] = SLOT_DIRTY;
+    pthread_cond_signal(&pool->dirty);
+    pthread_mutex_unlock(&pool->lock);
+}
+
+// Usage of the scratch tmpfs at path. -1 if what is there is not a tmpfs of
+// size_mb (the child has not mounted its own yet).
+int scratch_usage(const char *path, long size_mb, long *used_kb, long *used_inodes) {
+    struct statvfs st;
+    if (statvfs(path, &st) != 0) return -1;
+    if ((unsigned long long)st.f_blocks * st.f_frsize != (unsigned long long)size_mb * 1024 * 1024) return -1;
+    *used_kb = (long)((st.f_blocks - st.f_bfree) * st.f_frsize / 1024);
+    *used_inodes = (long)(st.f_files - st.f_ffree);
+    return 0;
+}
@@ -0,0 +1,36 @@
+#ifndef SCRATCH_H
+#define SCRATCH_H
+
+#include <stddef.h>
+#include <pthread.h>
+
+#define SCRATCH_MAX_SLOTS 64
+
+// Owner of the files in a sandbox's own scratch tmpfs when the launcher is
+// root: the child switches to it, host root is never mapped in (job.c map_ids)
+#define SCRATCH_NOBODY 65534
+
+// Pre-mounted tmpfs scratch areas: a job gets a clean slot bind-mounted at
+// /tmp, and its used slot is replaced with a fresh tmpfs in the background.
+typedef struct {
+    pthread_mutex_t lock;
+    pthread_cond_t dirty;           // A job gave a slot back
+    pthread_t recycler;
+    int recycling;                  // Recycler thread running
+    int stopping;
+    char dir[256];                  // Slots are DIR/slot_<i>
+    long size_mb;                   // tmpfs size= of every slot
+    long inodes;                    // tmpfs nr_inodes= of every slot
+    int count;
+    unsigned char state[SCRATCH_MAX_SLOTS];     // SLOT_* (scratch.c)
+} scratch_pool_t;
+
+// Function prototypes
+int scratch_pool_init(scratch_pool_t *pool, const char *dir, int workers, long size_mb, long inodes);
+void scratch_pool_destroy(scratch_pool_t *pool);
+int scratch_acquire(scratch_pool_t *pool, char *path, size_t len);
+void scratch_release(scratch_pool_t *pool, int slot);
+int scratch_mount_options(long size_mb, long inodes, char *buf, size_t len);
+int scratch_usage(const char *path, long size_mb, long *used_kb, long *used_inodes);
+
+#endif
@@ -6,6 +6,7 @@
 #include <unistd.h>
 #include <sys/time.h>
 #include <sys/stat.h>
+#include <fcntl.h>
 #include "telemetry.h"
 
 // Ensure logs directory exists
@@ -24,33 +25,182 @@ long get_current_time_ms() {
     return (tv.tv_sec * 1000) + (tv.tv_usec / 1000);
 }
 
+// Escape s for use inside a JSON string literal (quotes, backslashes and
+// control characters; other bytes pass through). Truncated to fit out,
+// never in the middle of an escape. Returns out.
+const char *json_escape(const char *s, char *out, size_t len) {
+    size_t n = 0;
+    for (; s && *s; s++) {
+        unsigned char c = (unsigned char)*s;
+        char esc[7];
+        int w;
+        switch (c) {
+            case '"': w = snprintf(esc, sizeof(esc), "\\\""); break;
+            case '\\': w = snprintf(esc, sizeof(esc), "\\\\"); break;
+            case '\n': w = snprintf(esc, sizeof(esc), "\\n"); break;
+            case '\r': w = snprintf(esc, sizeof(esc), "\\r"); break;
+            case '\t': w = snprintf(esc, sizeof(esc), "\\t"); break;
+            default:
+                if (c < 0x20) w = snprintf(esc, sizeof(esc), "\\u%04x", c);
+                else { esc[0] = c; esc[1] = '\0'; w = 1; }
+        }
+        if (n + w >= len) break;
+        memcpy(out + n, esc, w);
+        n += w;
+    }
+    if (len > 0) out[n] = '\0';
+    return out;
+}
+
 // Add a time-series sample
-void add_sample(telemetry_log_t *log, long elapsed_ms, int cpu_percent, long mem_kb) {
+void add_sample(telemetry_log_t *log, const telemetry_sample_t *sample) {
     if (!log->samples) {
         log->samples = malloc(sizeof(telemetry_sample_t) * MAX_SAMPLES);
         log->sample_count = 0;
     }
     
     if (log->sample_count < MAX_SAMPLES) {
-        log->samples[log->sample_count].time_ms = elapsed_ms;
-        log->samples[log->sample_count].cpu_percent = cpu_percent;
-        log->samples[log->sample_count].memory_kb = mem_kb;
+        log->samples[log->sample_count] = *sample;
         log->sample_count++;
+    } else if (log->window_path) {
+        // Service mode: overwrite the oldest sample
+        log->samples[log->ring_start] = *sample;
+        log->ring_start = (log->ring_start + 1) % MAX_SAMPLES;
     }
+
+    if (log->window_path) {
+        if (log->window_count == 0) log->window_start_ms = sample->time_ms;
+        log->window_count++;
+        if (sample->time_ms - log->window_start_ms >= log->window_ms) telemetry_flush_window(log);
+    }
+}
+
+// i-th sample in time order (the ring's oldest first in service mode)
+const telemetry_sample_t *telemetry_sample_at(const telemetry_log_t *log, int i) {
+    return &log->samples[(log->ring_start + i) % MAX_SAMPLES];
+}
+
+// i-th sample counting back from the newest (0 = newest)
+static const telemetry_sample_t *recent_sample(const telemetry_log_t *log, int back) {
+    int newest = (log->ring_start + log->sample_count - 1) % MAX_SAMPLES;
+    return &log->samples[(newest - back + MAX_SAMPLES) % MAX_SAMPLES];
+}
+
+// -------------------------------------------------------------
+// SERVICE MODE (windowed telemetry)
+// A service may run for days, so instead of one log at exit each window is
+// appended to a JSONL file as soon as it completes: its samples plus a
+// rolling summary. One write() and an fsync() per window, so a crash loses
+// at most the window in progress.
+// -------------------------------------------------------------
+int telemetry_flush_window(telemetry_log_t *log) {
+    if (!log->window_path || log->window_count == 0) return 0;
+
+    char *line = NULL;
+    size_t len = 0;
+    FILE *mem = open_memstream(&line, &len);
+    if (!mem) return -1;
+
+    if (log->window_seq == 0) {
+        char program[JSON_STR_MAX], control[JSON_STR_MAX];
+        fprintf(mem, "{\"type\": \"service\", \"program\": \"%s\", \"profile\": \"%s\", \"window_ms\": %ld, "
+                     "\"control_socket\": \"%s\"}\n",
+                json_escape(log->program_name, program, sizeof(program)), log->profile_name, log->window_ms,
+                json_escape(log->control_path, control, sizeof(control)));
+    }
+
+    // A window longer than the ring only keeps its newest samples
+    int count = log->window_count < log->sample_count ? log->window_count : log->sample_count;
+    const telemetry_sample_t *first = recent_sample(log, count - 1);
+    const telemetry_sample_t *last = recent_sample(log, 0);
+    long prev_cpu_ms = count < log->sample_count ? recent_sample(log, count)->cpu_time_ms : 0;
+
+    fprintf(mem, "{\"type\": \"window\", \"window\": %lu, \"start_ms\": %ld, \"end_ms\": %ld, "
+                 "\"samples\": %d, \"dropped\": %d", log->window_seq, first->time_ms, last->time_ms, count,
+            log->window_count - count);
+
+    const char *names[] = { "time_ms", "cpu_percent", "cpu_time_ms", "memory_kb", "page_faults_major" };
+    long cpu_sum = 0, cpu_max = 0, mem_max = 0;
+    for (int field = 0; field < 5; field++) {
+        fprintf(mem, ", \"%s\": [", names[field]);
+        for (int i = count - 1; i >= 0; i--) {
+            const telemetry_sample_t *s = recent_sample(log, i);
+            long v = field == 0 ? s->time_ms : field == 1 ? s->cpu_percent : field == 2 ? s->cpu_time_ms :
+                     field == 3 ? s->memory_kb : (long)s->majflt;
+            fprintf(mem, "%ld%s", v, i > 0 ? "," : "");
+            if (field == 1) {
+                cpu_sum += s->cpu_percent;
+                if (s->cpu_percent > cpu_max) cpu_max = s->cpu_percent;
+            } else if (field == 3 && s->memory_kb > mem_max) {
+                mem_max = s->memory_kb;
+            }
+        }
+        fprintf(mem, "]");
+    }
+
+    // Window figures, then totals since launch
+    fprintf(mem, ", \"summary\": {\"cpu_percent_avg\": %ld, \"cpu_percent_max\": %ld, \"memory_kb_max\": %ld, "
+                 "\"cpu_ms\": %ld, \"total_cpu_time_ms\": %ld, \"total_peak_memory_kb\": %ld, "
+                 "\"total_page_faults_major\": %lu}}\n",
+            cpu_sum / count, cpu_max, mem_max, last->cpu_time_ms - prev_cpu_ms, last->cpu_time_ms,
+            log->memory_peak_kb, last->majflt);
+    fclose(mem);
+
+    int rc = -1;
+    int fd = open(log->window_path, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (fd >= 0) {
+        rc = (write(fd, line, len) == (ssize_t)len && fsync(fd) == 0) ? 0 : -1;
+        close(fd);
+    }
+    if (rc != 0) perror("service window");
+    free(line);
+
+    log->window_seq++;
+    log->window_count = 0;
+    return rc;
+}
+
+// Oldest sample first again, so the final log reads like a normal one
+static void unroll_ring(telemetry_log_t *log) {
+    if (log->ring_start == 0) return;
+    telemetry_sample_t *ordered = malloc(sizeof(telemetry_sample_t) * MAX_SAMPLES);
+    if (!ordered) return;
+    for (int i = 0; i < log->sample_count; i++) {
+        ordered[i] = log->samples[(log->ring_start + i) % MAX_SAMPLES];
+    }
+    free(log->samples);
+    log->samples = ordered;
+    log->ring_start = 0;
 }
 
 // Write telemetry to JSON file with timeline
 void log_telemetry(const char *filename, telemetry_log_t *log, pid_t child_pid) {
+    // Service mode: the last partial window, then the ring as the timeline
+    if (log->window_path) {
+        telemetry_flush_window(log);
+        unroll_ring(log);
+    }
+
     FILE *fp = fopen(filename, "w");
     if (!fp) {
         perror("fopen telemetry log");
         return;
     }
 
+    char esc[JSON_STR_MAX];
     fprintf(fp, "{\n");
     fprintf(fp, "  \"pid\": %d,\n", child_pid);
-    fprintf(fp, "  \"program\": \"%s\",\n", log->program_name);
+    fprintf(fp, "  \"program\": \"%s\",\n", json_escape(log->program_name, esc, sizeof(esc)));
+    if (log->binary_hash && log->binary_hash[0]) {
+        fprintf(fp, "  \"binary_hash\": \"%s\",\n", log->binary_hash);
+    }
     fprintf(fp, "  \"profile\": \"%s\",\n", log->profile_name);
+    if (log->policy_name) {
+        fprintf(fp, "  \"policy\": \"%s\",\n", json_escape(log->policy_name, esc, sizeof(esc)));
+    }
+    if (log->control_path) {
+        fprintf(fp, "  \"control_socket\": \"%s\",\n", json_escape(log->control_path, esc, sizeof(esc)));
+    }
     
     // Timeline data
     fprintf(fp, "  \"timeline\": {\n");
@@ -65,11 +215,71 @@ void log_telemetry(const char *filename, telemetry_log_t *log, pid_t child_pid)
         fprintf(fp, "%d%s", log->samples[i].cpu_percent, i < log->sample_count - 1 ? "," : "");
     }
     fprintf(fp, "],\n");
+
+    // Cumulative CPU time and major faults: the exact inputs of the policy,
+    // so policy-sim can replay the run without approximating from cpu_percent
+    fprintf(fp, "    \"cpu_time_ms\": [");
+    for (int i = 0; i < log->sample_count; i++) {
+        fprintf(fp, "%ld%s", log->samples[i].cpu_time_ms, i < log->sample_count - 1 ? "," : "");
+    }
+    fprintf(fp, "],\n");
+
+    fprintf(fp, "    \"page_faults_major\": [");
+    for (int i = 0; i < log->sample_count; i++) {
+        fprintf(fp, "%lu%s", log->samples[i].majflt, i < log->sample_count - 1 ? "," : "");
+    }
+    fprintf(fp, "],\n");
     
     fprintf(fp, "    \"memory_kb\": [");
     for (int i = 0; i < log->sample_count; i++) {
         fprintf(fp, "%ld%s", log->samples[i].memory_kb, i < log->sample_count - 1 ? "," : "");
     }
+    fprintf(fp, "],\n");
+
+    // CPU placement: where the task ran, and how often it moved
+    fprintf(fp, "    \"cpu\": [");
+    for (int i = 0; i < log->sample_count; i++) {
+        fprintf(fp, "%d%s", log->samples[i].cpu, i < log->sample_count - 1 ? "," : "");
+    }
+    fprintf(fp, "],\n");
+
+    fprintf(fp, "    \"migrations\": [");
+    for (int i = 0; i < log->sample_count; i++) {
+        fprintf(fp, "%lu%s", log->samples[i].migrations, i < log->sample_count - 1 ? "," : "");
+    }
+    fprintf(fp, "],\n");
+
+    if (log->scratch_mode) {
+        fprintf(fp, "    \"scratch_kb\": [");
+        for (int i = 0; i < log->sample_count; i++) {
+            fprintf(fp, "%ld%s", log->samples[i].scratch_kb, i < log->sample_count - 1 ? "," : "");
+        }
+        fprintf(fp, "],\n");
+    }
+
+    // Reclaim counters (memory.stat / memory.events), deltas since launch
+    fprintf(fp, "    \"pgscan\": [");
+    for (int i = 0; i < log->sample_count; i++) {
+        fprintf(fp, "%llu%s", log->samples[i].reclaim.pgscan, i < log->sample_count - 1 ? "," : "");
+    }
+    fprintf(fp, "],\n");
+
+    fprintf(fp, "    \"pgsteal\": [");
+    for (int i = 0; i < log->sample_count; i++) {
+        fprintf(fp, "%llu%s", log->samples[i].reclaim.pgsteal, i < log->sample_count - 1 ? "," : "");
+    }
+    fprintf(fp, "],\n");
+
+    fprintf(fp, "    \"workingset_refault\": [");
+    for (int i = 0; i < log->sample_count; i++) {
+        fprintf(fp, "%llu%s", log->samples[i].reclaim.workingset_refault, i < log->sample_count - 1 ? "," : "");
+    }
+    fprintf(fp, "],\n");
+
+    fprintf(fp, "    \"memory_high_events\": [");
+    for (int i = 0; i < log->sample_count; i++) {
+        fprintf(fp, "%llu%s", log->samples[i].reclaim.high_events, i < log->sample_count - 1 ? "," : "");
+    }
     fprintf(fp, "]\n");
     fprintf(fp, "  },\n");
     
@@ -78,8 +288,56 @@ void log_telemetry(const char *filename, telemetry_log_t *log, pid_t child_pid)
     fprintf(fp, "    \"runtime_ms\": %ld,\n", log->runtime_ms);
     fprintf(fp, "    \"peak_cpu\": %d,\n", log->cpu_usage_percent);
     fprintf(fp, "    \"peak_memory_kb\": %ld,\n", log->memory_peak_kb);
+    fprintf(fp, "    \"peak_rss_kb\": %ld,\n", log->peak_rss_kb);
     fprintf(fp, "    \"page_faults_minor\": %lu,\n", log->minflt);
     fprintf(fp, "    \"page_faults_major\": %lu,\n", log->majflt);
+    fprintf(fp, "    \"memory_mode\": \"%s\",\n", log->memory_mode ? log->memory_mode : "hard");
+    fprintf(fp, "    \"memory_high_events\": %llu,\n", log->reclaim_total.high_events);
+    fprintf(fp, "    \"reclaim_pgscan\": %llu,\n", log->reclaim_total.pgscan);
+    fprintf(fp, "    \"reclaim_pgsteal\": %llu,\n", log->reclaim_total.pgsteal);
+    fprintf(fp, "    \"workingset_refault\": %llu,\n", log->reclaim_total.workingset_refault);
+    fprintf(fp, "    \"cpuset_mode\": \"%s\",\n", log->cpuset_mode ? log->cpuset_mode : "none");
+    fprintf(fp, "    \"cpuset_cpus\": \"%s\",\n", log->cpuset_cpus);
+    fprintf(fp, "    \"migrations\": %lu,\n", log->migrations);
+    fprintf(fp, "    \"queue_wait_ms\": %ld,\n", log->queue_wait_ms);
+    fprintf(fp, "    \"priority\": \"%s\",\n", log->priority ? log->priority : "batch");
+    fprintf(fp, "    \"frozen_ms\": %ld,\n", log->frozen_ms);
+    if (log->stdin_path) {
+        fprintf(fp, "    \"stdin\": {\"path\": \"%s\", \"mode\": \"%s\", \"size\": %lld, \"bytes\": %llu, "
+                    "\"consumed_ms\": %ld},\n",
+                json_escape(log->stdin_path, esc, sizeof(esc)), log->stdin_mode, log->stdin_size, log->stdin_bytes, log->stdin_consumed_ms);
+    }
+    if (log->expected_path) {
+        fprintf(fp, "    \"verify\": {\"expected\": \"%s\", \"mode\": \"%s\", \"verdict\": \"%s\", "
+                    "\"mismatch_offset\": %lld, \"bytes\": %llu},\n",
+                json_escape(log->expected_path, esc, sizeof(esc)), log->verify_mode, log->verdict, log->mismatch_offset, log->verified_bytes);
+    }
+    if (log->capture[0].path || log->capture[1].path) {
+        const char *streams[2] = { "stdout", "stderr" };
+        fprintf(fp, "    \"output\": {\"limit\": %ld", log->capture_limit);
+        for (int i = 0; i < 2; i++) {
+            const telemetry_capture_t *c = &log->capture[i];
+            if (!c->path) continue;
+            fprintf(fp, ", \"%s\": {\"path\": \"%s\", \"bytes\": %llu, \"dropped\": %llu, \"throttle_ms\": %ld}",
+                    streams[i], json_escape(c->path, esc, sizeof(esc)), c->bytes, c->dropped, c->throttle_ms);
+        }
+        fprintf(fp, "},\n");
+    }
+    if (log->scratch_mode) {
+        fprintf(fp, "    \"scratch\": {\"mode\": \"%s\", \"size_mb\": %ld, \"inodes\": %ld, \"peak_kb\": %ld, "
+                    "\"peak_inodes\": %ld},\n",
+                log->scratch_mode, log->scratch_mb, log->scratch_inodes, log->scratch_peak_kb,
+                log->scratch_peak_inodes);
+    }
+    if (log->pred_samples > 0) {
+        fprintf(fp, "    \"prediction\": {\"samples\": %d, \"quantile\": %.2f, \"cpu_percent\": %ld, "
+                    "\"peak_rss_kb\": %ld, \"runtime_ms\": %ld},\n",
+                log->pred_samples, log->pred_quantile, log->pred_cpu_percent, log->pred_rss_kb,
+                log->pred_runtime_ms);
+    }
+    fprintf(fp, "    \"tenant\": \"%s\",\n", json_escape(log->tenant ? log->tenant : "", esc, sizeof(esc)));
+    fprintf(fp, "    \"cpu_time_ms\": %ld,\n", log->cpu_time_ms);
+    fprintf(fp, "    \"memory_gb_seconds\": %.4f,\n", log->mem_gb_seconds);
     fprintf(fp, "    \"termination\": \"%s\",\n", log->termination_signal);
     fprintf(fp, "    \"blocked_syscall\": \"%s\",\n", log->blocked_syscall);
     fprintf(fp, "    \"exit_reason\": \"%s\"\n", log->exit_reason);
@@ -92,7 +350,9 @@ void log_telemetry(const char *filename, telemetry_log_t *log, pid_t child_pid)
         free(log->samples);
     }
     
-    printf("[Telemetry] Log written to %s (%d samples)\n", filename, log->sample_count);
+    if (!log->quiet) {
+        printf("[Telemetry] Log written to %s (%d samples)\n", filename, log->sample_count);
+    }
 }
 
 // Parse /proc/[pid]/stat for CPU usage (Simplified for this project)
@@ -146,22 +406,85 @@ int get_cpu_usage(pid_t pid) {
 
 // Parse /proc/[pid]/status for VmPeak
 long get_memory_peak(pid_t pid) {
+    long peak_kb = 0, hwm_kb = 0;
+    get_memory_peaks(pid, &peak_kb, &hwm_kb, NULL);
+    return peak_kb;
+}
+
+// VmPeak (address space, what RLIMIT_AS caps), VmHWM (resident high-water
+// mark, what the job actually needed) and VmRSS (resident now; rss_kb may be
+// NULL) in one pass over /proc/[pid]/status
+int get_memory_peaks(pid_t pid, long *peak_kb, long *hwm_kb, long *rss_kb) {
     char path[64];
     snprintf(path, sizeof(path), "/proc/%d/status", pid);
-    
+
     FILE *fp = fopen(path, "r");
-    if (!fp) return 0;
-    
+    if (!fp) return -1;
+
     char line[128];
-    long peak_kb = 0;
-    
-    while (fgets(line, sizeof(line), fp)) {
+    int wanted = rss_kb ? 3 : 2, found = 0;
+    while (found < wanted && fgets(line, sizeof(line), fp)) {
         if (strncmp(line, "VmPeak:", 7) == 0) {
-            sscanf(line + 7, "%ld", &peak_kb);
+            sscanf(line + 7, "%ld", peak_kb);
+            found++;
+        } else if (strncmp(line, "VmHWM:", 6) == 0) {
+            sscanf(line + 6, "%ld", hwm_kb);
+            found++;
+        } else if (rss_kb && strncmp(line, "VmRSS:", 6) == 0) {
+            sscanf(line + 6, "%ld", rss_kb);
+            found++;
+        }
+    }
+
+    fclose(fp);
+    return found == wanted ? 0 : -1;
+}
+
+
+// Field 39 of /proc/[pid]/stat: CPU the task last executed on
+int get_process_cpu(pid_t pid) {
+    char path[64];
+    snprintf(path, sizeof(path), "/proc/%d/stat", pid);
+
+    FILE *fp = fopen(path, "r");
+    if (!fp) return -1;
+
+    char buf[1024];
+    if (!fgets(buf, sizeof(buf), fp)) {
+        fclose(fp);
+        return -1;
+    }
+    fclose(fp);
+
+    char *p = strrchr(buf, ')');
+    if (!p) return -1;
+
+    // Fields after "comm)" start at 3 (state); skip to 39
+    int field = 2;
+    while (*p && field < 39) {
+        if (*p == ' ') field++;
+        p++;
+    }
+    return field == 39 ? atoi(p) : -1;
+}
+
+// se.nr_migrations from /proc/[pid]/sched (-1 if the kernel hides it)
+long get_migrations(pid_t pid) {
+    char path[64];
+    snprintf(path, sizeof(path), "/proc/%d/sched", pid);
+
+    FILE *fp = fopen(path, "r");
+    if (!fp) return -1;
+
+    char line[128];
+    long migrations = -1;
+    while (fgets(line, sizeof(line), fp)) {
+        if (strncmp(line, "se.nr_migrations", 16) == 0) {
+            char *colon = strchr(line, ':');
+            if (colon) migrations = atol(colon + 1);
             break;
         }
     }
-    
     fclose(fp);
-    return peak_kb;
+    return migrations;
 }
@@ -2,8 +2,10 @@
 #define TELEMETRY_H
 
 #include <sys/types.h>
+#include "cgroup.h"
 
 #define MAX_SAMPLES 1000  // Max 100 seconds at 100ms intervals
+#define JSON_STR_MAX 1024  // Buffer for one json_escape()d path or name
 
 typedef enum {
     PROFILE_STRICT,
@@ -15,35 +17,120 @@ typedef enum {
 typedef struct {
     long time_ms;
     int cpu_percent;
+    long cpu_time_ms;           // Cumulative utime + stime
+    unsigned long majflt;       // Cumulative major faults
     long memory_kb;
+    int cpu;                    // CPU the task last ran on
+    unsigned long migrations;   // Cumulative CPU migrations
+    cgroup_mem_stat_t reclaim;  // Deltas since launch (memory.high throttling cost)
+    long scratch_kb;            // Used in the job's /tmp tmpfs
 } telemetry_sample_t;
 
+// One captured output stream (job_spec_t.capture_dir)
+typedef struct {
+    const char *path;           // NULL = not captured
+    unsigned long long bytes;   // Written to path
+    unsigned long long dropped; // Past the capture limit
+    long throttle_ms;           // Pipe found full: the job was blocked writing
+} telemetry_capture_t;
+
 // Structure to hold telemetry data with timeline
 typedef struct {
     char *program_name;
     const char *profile_name;
+    const char *policy_name;    // LEARNING policy in effect (NULL otherwise)
     long runtime_ms;
     int cpu_usage_percent;
-    long memory_peak_kb;
+    long memory_peak_kb;        // VmPeak: address space, what RLIMIT_AS caps
+    long peak_rss_kb;           // VmHWM: resident high-water mark
     unsigned long minflt;
     unsigned long majflt;
     char termination_signal[32];
     char blocked_syscall[32];
     char exit_reason[32];
+
+    // Memory limit mode: "hard" (RLIMIT_AS/memory.max) or "soft" (memory.high)
+    const char *memory_mode;
+    cgroup_mem_stat_t reclaim_total;
+
+    // CPU placement (core allocator / cpuset.cpus)
+    const char *cpuset_mode;
+    char cpuset_cpus[64];
+    unsigned long migrations;
+
+    long queue_wait_ms;         // Admission queue wait before launch (batch mode)
+
+    // History-based prediction, logged next to the actuals it predicts
+    const char *binary_hash;
+    int pred_samples;           // 0 = no prediction
+    double pred_quantile;
+    long pred_cpu_percent;
+    long pred_rss_kb;
+    long pred_runtime_ms;
+
+    // Preemption: time frozen for interactive jobs (excluded from runtime_ms)
+    const char *priority;
+    long frozen_ms;
+
+    // Tenant accounting
+    const char *tenant;
+    long cpu_time_ms;
+    double mem_gb_seconds;
     
+    int quiet;                  // Suppress progress output (batch mode)
+    const char *control_path;   // Control socket of the run (NULL = none)
+    telemetry_capture_t capture[2];     // stdout, stderr
+
+    // Input (job_spec_t.stdin_path)
+    const char *stdin_path;     // NULL = inherited or the caller's fd
+    const char *stdin_mode;     // "file" (fd passed on) or "pipe" (streamed with splice)
+    long long stdin_size;       // -1 = unknown (pipe)
+    unsigned long long stdin_bytes;     // Read by the job
+    long stdin_consumed_ms;     // All input read, at sample resolution (-1 = never)
+
+    // Streaming verification (job_spec_t.expected_path)
+    const char *expected_path;  // NULL = not verified
+    const char *verify_mode;
+    const char *verdict;
+    long long mismatch_offset;  // First stdout byte that differs (-1 = none)
+    unsigned long long verified_bytes;
+    long capture_limit;
+
+    // Scratch /tmp (job_spec_t.scratch_mb)
+    const char *scratch_mode;   // "pool" (pre-mounted slot) or "mount" (the child's own), NULL = none
+    long scratch_mb;
+    long scratch_inodes;
+    long scratch_peak_kb;
+    long scratch_peak_inodes;
+
     // Time-series data
     telemetry_sample_t *samples;
     int sample_count;
+
+    // Service mode: windows are appended to window_path as they complete,
+    // and samples[] is a ring of the last MAX_SAMPLES (oldest at ring_start)
+    const char *window_path;    // NULL = one log at exit, samples beyond MAX_SAMPLES dropped
+    long window_ms;
+    int ring_start;
+    int window_count;           // Samples since the last flushed window
+    long window_start_ms;
+    unsigned long window_seq;
 } telemetry_log_t;
 
 // Function prototypes
 void ensure_logs_directory();
 void log_telemetry(const char *filename, telemetry_log_t *log, pid_t child_pid);
-void add_sample(telemetry_log_t *log, long elapsed_ms, int cpu_percent, long mem_kb);
+void add_sample(telemetry_log_t *log, const telemetry_sample_t *sample);
+int telemetry_flush_window(telemetry_log_t *log);
+const telemetry_sample_t *telemetry_sample_at(const telemetry_log_t *log, int i);
 long get_current_time_ms();
+const char *json_escape(const char *s, char *out, size_t len);
 int get_cpu_usage(pid_t pid);
 unsigned long long get_cpu_ticks(pid_t pid);
 unsigned long long get_process_metrics(pid_t pid, unsigned long *minflt_out, unsigned long *majflt_out);
 long get_memory_peak(pid_t pid);
+int get_memory_peaks(pid_t pid, long *peak_kb, long *hwm_kb, long *rss_kb);
+int get_process_cpu(pid_t pid);
+long get_migrations(pid_t pid);
 
 #endif
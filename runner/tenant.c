@@ -0,0 +1,165 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "tenant.h"
+#include "cgroup.h"
+#include "job.h"
+#include "telemetry.h"
+
+/**
+ * TENANTS (Fair share between teams)
+ *
+ * Hierarchy: sandbox_project/<tenant>/<run>. The tenant level carries
+ * cpu.weight, memory.max and pids.max, so one team's burst is bounded by its
+ * own share no matter how many jobs it submits.
+ */
+
+void tenant_init(tenant_t *t, const char *name) {
+    memset(t, 0, sizeof(*t));
+    snprintf(t->name, sizeof(t->name), "%.31s", name);
+    t->weight = 100;
+    snprintf(t->memory_max, sizeof(t->memory_max), "max");
+    snprintf(t->pids_max, sizeof(t->pids_max), "max");
+}
+
+// Parse "name:weight=200,mem=2G,pids=500" (same shape as --policy).
+// Omitted keys keep the cgroup defaults.
+int tenant_parse(const char *spec, tenant_t *t) {
+    char buf[256];
+    snprintf(buf, sizeof(buf), "%s", spec);
+
+    char *body = NULL;
+    char *colon = strchr(buf, ':');
+    if (colon) {
+        *colon = '\0';
+        body = colon + 1;
+    }
+    char name[sizeof(t->name)];
+    if (job_parse_tenant(buf, name, sizeof(name)) != 0) return -1;
+    tenant_init(t, name);
+    if (!body) return 0;
+
+    char *saveptr = NULL;
+    for (char *tok = strtok_r(body, ",", &saveptr); tok; tok = strtok_r(NULL, ",", &saveptr)) {
+        char *eq = strchr(tok, '=');
+        if (!eq) return -1;
+        *eq = '\0';
+        const char *value = eq + 1;
+
+        if (strcmp(tok, "weight") == 0) {
+            char *end;
+            long weight = strtol(value, &end, 10);
+            if (*end != '\0' || weight < 1 || weight > 10000) return -1;
+            t->weight = (int)weight;
+        } else if (strcmp(tok, "mem") == 0) {
+            snprintf(t->memory_max, sizeof(t->memory_max), "%.31s", value);
+        } else if (strcmp(tok, "pids") == 0) {
+            snprintf(t->pids_max, sizeof(t->pids_max), "%.15s", value);
+        } else {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+// Create sandbox_project/<name> and apply the tenant's limits
+int tenant_setup_cgroup(tenant_t *t) {
+    char rel[128];
+    snprintf(rel, sizeof(rel), SANDBOX_CGROUP_PARENT "/%s", t->name);
+    if (cgroup_create(rel, t->cgroup, sizeof(t->cgroup)) != 0) {
+        t->cgroup[0] = '\0';
+        return -1;
+    }
+
+    char weight[16];
+    snprintf(weight, sizeof(weight), "%d", t->weight);
+    int failed = 0;
+    failed |= cgroup_write_file(t->cgroup, "cpu.weight", weight);
+    failed |= cgroup_write_file(t->cgroup, "memory.max", t->memory_max);
+    failed |= cgroup_write_file(t->cgroup, "pids.max", t->pids_max);
+    return failed ? -1 : 0;
+}
+
+tenant_t *tenant_find(tenant_t *tenants, int count, const char *name) {
+    for (int i = 0; i < count; i++) {
+        if (strcmp(tenants[i].name, name) == 0) return &tenants[i];
+    }
+    return NULL;
+}
+
+// -------------------------------------------------------------
+// Weighted fair queuing
+// A tenant's virtual time is the CPU-seconds it has been served, scaled by
+// 100 / cpu.weight. The backlogged tenant with the lowest virtual time goes
+// next, so over a busy period CPU time is split in proportion to weight.
+// -------------------------------------------------------------
+
+// Charge CPU-seconds to a tenant (negative refunds an overestimate)
+void tenant_charge(tenant_t *t, double cpu_seconds) {
+    t->vtime += cpu_seconds * 100.0 / t->weight;
+}
+
+// Eligible tenant with the lowest virtual time, the first one on ties
+// (-1 if none is eligible)
+int tenant_next(const tenant_t *tenants, int count, const unsigned char *eligible) {
+    int best = -1;
+    for (int t = 0; t < count; t++) {
+        if (!eligible[t]) continue;
+        if (best < 0 || tenants[t].vtime < tenants[best].vtime) best = t;
+    }
+    return best;
+}
+
+// Only backlogged tenants compete, so one that was idle (or had not submitted
+// yet) would come back with the virtual time of its idle spell and hold the
+// host until it caught up. When a tenant becomes backlogged its virtual time
+// is raised to the lowest among those already backlogged; *floor keeps that
+// minimum for when none is. waiting[] says who has work queued now and
+// backlogged[] is brought up to date.
+void tenant_update_backlog(tenant_t *tenants, int count, const unsigned char *waiting,
+                           unsigned char *backlogged, double *floor) {
+    int any = 0;
+    for (int t = 0; t < count; t++) {
+        if (!backlogged[t] || !waiting[t]) continue;
+        if (!any || tenants[t].vtime < *floor) *floor = tenants[t].vtime;
+        any = 1;
+    }
+    for (int t = 0; t < count; t++) {
+        if (waiting[t] && !backlogged[t] && tenants[t].vtime < *floor) tenants[t].vtime = *floor;
+        backlogged[t] = waiting[t];
+    }
+}
+
+void tenant_report(const tenant_t *tenants, int count, FILE *out) {
+    double cpu_total = 0;
+    for (int i = 0; i < count; i++) cpu_total += tenants[i].cpu_seconds;
+
+    for (int i = 0; i < count; i++) {
+        const tenant_t *t = &tenants[i];
+        fprintf(out, "[Tenant] %-16s weight %5d  %4lu jobs  %9.2f CPU-s (%5.1f%%)  %9.3f GB-s\n",
+                t->name, t->weight, t->jobs, t->cpu_seconds,
+                cpu_total > 0 ? 100.0 * t->cpu_seconds / cpu_total : 0.0, t->gb_seconds);
+    }
+}
+
+int tenant_write_report(const tenant_t *tenants, int count, const char *path) {
+    FILE *fp = fopen(path, "w");
+    if (!fp) {
+        perror("fopen tenant report");
+        return -1;
+    }
+
+    fprintf(fp, "{\n  \"tenants\": [\n");
+    for (int i = 0; i < count; i++) {
+        const tenant_t *t = &tenants[i];
+        char name[JSON_STR_MAX], mem[JSON_STR_MAX], pids[JSON_STR_MAX];
+        fprintf(fp, "    {\"name\": \"%s\", \"weight\": %d, \"memory_max\": \"%s\", \"pids_max\": \"%s\", "
+                    "\"jobs\": %lu, \"cpu_seconds\": %.3f, \"gb_seconds\": %.4f}%s\n",
+                json_escape(t->name, name, sizeof(name)), t->weight, json_escape(t->memory_max, mem, sizeof(mem)),
+                json_escape(t->pids_max, pids, sizeof(pids)), t->jobs, t->cpu_seconds, t->gb_seconds,
+                i < count - 1 ? "," : "");
+    }
+    fprintf(fp, "  ]\n}\n");
+    fclose(fp);
+    return 0;
+}
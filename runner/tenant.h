@@ -0,0 +1,38 @@
+#ifndef TENANT_H
+#define TENANT_H
+
+#include <stdio.h>
+
+#define MAX_TENANTS 64
+#define DEFAULT_TENANT "default"
+
+// One team sharing the host: its cgroup limits, its place in the fair
+// queue and what it has consumed so far.
+typedef struct {
+    char name[32];
+    int weight;                 // cpu.weight, 1-10000 (cgroup default 100)
+    char memory_max[32];        // memory.max ("max" or a size such as "2G")
+    char pids_max[16];          // pids.max ("max" or a count)
+    char cgroup[512];           // sandbox_project/<name> ("" if not created)
+
+    double vtime;               // WFQ virtual time: CPU-seconds served / weight
+
+    // Aggregate accounting
+    unsigned long jobs;
+    double cpu_seconds;
+    double gb_seconds;          // Memory integral (GB x seconds)
+} tenant_t;
+
+// Function prototypes
+void tenant_init(tenant_t *t, const char *name);
+int tenant_parse(const char *spec, tenant_t *t);
+int tenant_setup_cgroup(tenant_t *t);
+tenant_t *tenant_find(tenant_t *tenants, int count, const char *name);
+void tenant_charge(tenant_t *t, double cpu_seconds);
+int tenant_next(const tenant_t *tenants, int count, const unsigned char *eligible);
+void tenant_update_backlog(tenant_t *tenants, int count, const unsigned char *waiting,
+                           unsigned char *backlogged, double *floor);
+void tenant_report(const tenant_t *tenants, int count, FILE *out);
+int tenant_write_report(const tenant_t *tenants, int count, const char *path);
+
+#endif
@@ -0,0 +1,29 @@
+#ifndef CHECK_H
+#define CHECK_H
+
+#include <stdio.h>
+
+/**
+ * BEHAVIOR CHECKS (make check)
+ *
+ * Each runner/tests/test_<module>.c is a small program: CHECK() reports the
+ * failing expression with its line, and main() returns check_report().
+ */
+
+static int check_failures;
+static int check_count;
+
+#define CHECK(cond) do { \
+    check_count++; \
+    if (!(cond)) { \
+        check_failures++; \
+        fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+    } \
+} while (0)
+
+static inline int check_report(const char *name) {
+    printf("[Tests] %-10s %d/%d checks passed\n", name, check_count - check_failures, check_count);
+    return check_failures ? 1 : 0;
+}
+
+#endif
@@ -0,0 +1,57 @@
+#include <string.h>
+#include "check.h"
+#include "bench.h"
+
+static void test_small(void) {
+    bench_stats_t s;
+    bench_stats(NULL, 0, &s);
+    CHECK(s.median == 0 && s.mad == 0 && s.min == 0 && s.ci_low == 0 && s.ci_high == 0);
+
+    double one[1] = { 7 };
+    bench_stats(one, 1, &s);
+    CHECK(s.median == 7 && s.mad == 0 && s.min == 7 && s.ci_low == 7 && s.ci_high == 7);
+
+    double odd[5] = { 5, 1, 3, 2, 4 };
+    bench_stats(odd, 5, &s);
+    CHECK(s.median == 3 && s.min == 1);
+    CHECK(s.mad == 1);                  // Deviations 0 1 1 2 2
+    CHECK(s.ci_low == 1 && s.ci_high == 5);     // Five runs: the whole range
+    CHECK(odd[0] == 5 && odd[1] == 1);  // Input left unsorted
+
+    double even[4] = { 4, 1, 3, 2 };
+    bench_stats(even, 4, &s);
+    CHECK(s.median == 2.5 && s.mad == 1);
+}
+
+static void test_robust(void) {
+    // One slow outlier moves neither the median nor the MAD
+    double values[5] = { 10, 10, 1000, 10, 10 };
+    bench_stats_t s;
+    bench_stats(values, 5, &s);
+    CHECK(s.median == 10 && s.mad == 0 && s.min == 10);
+    CHECK(s.ci_high == 1000);
+}
+
+static void test_interval(void) {
+    // 1..100, scrambled: the 95% CI of the median is ranks 40 and 61
+    double values[100];
+    for (int i = 0; i < 100; i++) values[i] = (i * 37) % 100 + 1;
+    bench_stats_t s;
+    bench_stats(values, 100, &s);
+    CHECK(s.median == 50.5 && s.min == 1);
+    CHECK(s.mad == 25);
+    CHECK(s.ci_low == 40 && s.ci_high == 61);
+    CHECK(s.ci_low <= s.median && s.median <= s.ci_high);
+
+    // The interval narrows as runs accumulate
+    bench_stats_t fewer;
+    bench_stats(values, 20, &fewer);
+    CHECK(fewer.ci_high - fewer.ci_low > s.ci_high - s.ci_low);
+}
+
+int main(void) {
+    test_small();
+    test_robust();
+    test_interval();
+    return check_report("bench");
+}
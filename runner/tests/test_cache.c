@@ -0,0 +1,165 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include "check.h"
+#include "cache.h"
+
+static char dir[] = "/tmp/test_cache_XXXXXX";
+static char binary[64], input[64], expected[64], fifo[64];
+
+static void write_file(const char *path, const char *text) {
+    FILE *fp = fopen(path, "w");
+    if (fp) {
+        fputs(text, fp);
+        fclose(fp);
+    }
+}
+
+static void base_spec(job_spec_t *spec, char **args) {
+    job_spec_init(spec);
+    spec->binary_path = binary;
+    spec->args = args;
+    spec->stdin_path = "/dev/null";
+}
+
+static int key_of(const job_spec_t *spec, char *key) {
+    return cache_key(spec, key, CACHE_KEY_LEN);
+}
+
+// Key of the base spec after 'change' is applied differs from the base key
+#define CHANGES_KEY(change) do { \
+    job_spec_t spec; \
+    char key[CACHE_KEY_LEN]; \
+    base_spec(&spec, args); \
+    change; \
+    CHECK(key_of(&spec, key) == 0 && strcmp(key, base) != 0); \
+} while (0)
+
+static void test_inputs(void) {
+    char *args[] = { binary, "ab", "c", NULL };
+    char base[CACHE_KEY_LEN], key[CACHE_KEY_LEN];
+    job_spec_t spec;
+    base_spec(&spec, args);
+    CHECK(key_of(&spec, base) == 0);
+    CHECK(strlen(base) == CACHE_KEY_LEN - 1);
+    CHECK(key_of(&spec, key) == 0 && strcmp(key, base) == 0);
+
+    char *split[] = { binary, "a", "bc", NULL };
+    CHANGES_KEY(spec.args = split);
+    CHANGES_KEY(spec.stdin_path = input);
+    CHANGES_KEY(spec.profile_name = "LEARNING");
+    CHANGES_KEY(spec.limits.memory_mb = 256);
+    CHANGES_KEY(spec.limits.time_ms = 1000);
+    CHANGES_KEY(spec.mem_soft = 1);
+    CHANGES_KEY(spec.policy.cpu_ms_threshold += 1);
+    CHANGES_KEY(spec.scratch_mb = 16);
+    CHANGES_KEY(spec.expected_path = expected);
+
+    // The environment the job inherits
+    setenv("TEST_CACHE_VAR", "1", 1);
+    CHECK(key_of(&spec, key) == 0 && strcmp(key, base) != 0);
+    unsetenv("TEST_CACHE_VAR");
+
+    // Inode cap of a scratch /tmp that isn't there changes nothing
+    base_spec(&spec, args);
+    spec.scratch_inodes = 1;
+    CHECK(key_of(&spec, key) == 0 && strcmp(key, base) == 0);
+
+    // The binary's contents, not its path
+    write_file(binary, "#!/bin/sh\necho two\n");
+    base_spec(&spec, args);
+    CHECK(key_of(&spec, key) == 0 && strcmp(key, base) != 0);
+    write_file(binary, "#!/bin/sh\necho one\n");
+    CHECK(key_of(&spec, key) == 0 && strcmp(key, base) == 0);
+}
+
+static void test_verify_inputs(void) {
+    char *args[] = { binary, NULL };
+    char base[CACHE_KEY_LEN], key[CACHE_KEY_LEN];
+    job_spec_t spec;
+    base_spec(&spec, args);
+    spec.expected_path = expected;
+    CHECK(key_of(&spec, base) == 0);
+
+    spec.verify_mode = VERIFY_TOKENS;
+    CHECK(key_of(&spec, key) == 0 && strcmp(key, base) != 0);
+    spec.verify_mode = VERIFY_EXACT;
+    spec.verify_kill = 1;
+    CHECK(key_of(&spec, key) == 0 && strcmp(key, base) != 0);
+    spec.verify_kill = 0;
+
+    write_file(expected, "43\n");
+    CHECK(key_of(&spec, key) == 0 && strcmp(key, base) != 0);
+    write_file(expected, "42\n");
+    CHECK(key_of(&spec, key) == 0 && strcmp(key, base) == 0);
+}
+
+static void test_stdin(void) {
+    char *args[] = { binary, NULL };
+    char by_path[CACHE_KEY_LEN], key[CACHE_KEY_LEN];
+    job_spec_t spec;
+    base_spec(&spec, args);
+    spec.stdin_path = input;
+    CHECK(key_of(&spec, by_path) == 0);
+
+    // An inherited fd is hashed from its current offset, as the job reads it
+    char shifted[64];
+    snprintf(shifted, sizeof(shifted), "%s/shifted", dir);
+    write_file(shifted, "xyz1 2 3\n");
+    int fd = open(shifted, O_RDONLY);
+    lseek(fd, 3, SEEK_SET);
+    base_spec(&spec, args);
+    spec.stdin_path = NULL;
+    spec.stdin_fd = fd;
+    CHECK(key_of(&spec, key) == 0 && strcmp(key, by_path) == 0);
+    CHECK(lseek(fd, 0, SEEK_CUR) == 3);
+    close(fd);
+    unlink(shifted);
+
+    // Pipes and FIFOs can't be hashed without consuming them
+    int p[2];
+    CHECK(pipe(p) == 0);
+    spec.stdin_fd = p[0];
+    CHECK(key_of(&spec, key) == -1);
+    close(p[0]);
+    close(p[1]);
+
+    base_spec(&spec, args);
+    spec.stdin_path = fifo;
+    CHECK(key_of(&spec, key) == -1);       // Returns instead of blocking on open
+    spec.stdin_path = "/nonexistent";
+    CHECK(key_of(&spec, key) == -1);
+    base_spec(&spec, args);
+    spec.binary_path = "/nonexistent";
+    CHECK(key_of(&spec, key) == -1);
+}
+
+int main(void) {
+    if (!mkdtemp(dir)) {
+        perror("mkdtemp");
+        return 1;
+    }
+    snprintf(binary, sizeof(binary), "%s/prog", dir);
+    snprintf(input, sizeof(input), "%s/input", dir);
+    snprintf(expected, sizeof(expected), "%s/expected", dir);
+    snprintf(fifo, sizeof(fifo), "%s/fifo", dir);
+    write_file(binary, "#!/bin/sh\necho one\n");
+    write_file(input, "1 2 3\n");
+    write_file(expected, "42\n");
+    mkfifo(fifo, 0600);
+
+    test_inputs();
+    test_verify_inputs();
+    test_stdin();
+
+    unlink(binary);
+    unlink(input);
+    unlink(expected);
+    unlink(fifo);
+    rmdir(dir);
+    return check_report("cache");
+}
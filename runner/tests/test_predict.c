@@ -0,0 +1,145 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "check.h"
+#include "predict.h"
+
+static history_run_t run_of(const char *hash, const char *program, long cpu, long rss, long runtime) {
+    history_run_t run;
+    memset(&run, 0, sizeof(run));
+    snprintf(run.hash, sizeof(run.hash), "%s", hash);
+    snprintf(run.program, sizeof(run.program), "%s", program);
+    run.cpu_percent = cpu;
+    run.peak_rss_kb = rss;
+    run.runtime_ms = runtime;
+    run.cpu_time_ms = cpu * runtime / 100;
+    return run;
+}
+
+static void test_quantiles(void) {
+    // Ten runs of one program with runtimes 10..100 ms, listed out of order
+    history_run_t runs[12];
+    long runtimes[10] = {70, 20, 100, 40, 10, 90, 30, 60, 80, 50};
+    for (int i = 0; i < 10; i++) runs[i] = run_of("aaaa", "/tmp/a", 100, 1000 + i, runtimes[i]);
+    runs[10] = run_of("bbbb", "/tmp/b", 50, 9999, 5000);
+    runs[11] = run_of("", "/tmp/a", 100, 9999, 5000);   // Same path, no hash: not used while hashes match
+    run_history_t history = { runs, 12 };
+
+    job_prediction_t p;
+    CHECK(predict_job(&history, "aaaa", "/tmp/a", 0.9, 3, &p) == 0);
+    CHECK(p.samples == 10);
+    CHECK(p.runtime_ms == 90);          // Nearest rank: ceil(0.9 * 10) = 9th
+    CHECK(p.peak_rss_kb == 1008);
+    CHECK(predict_job(&history, "aaaa", "/tmp/a", 0.5, 3, &p) == 0);
+    CHECK(p.runtime_ms == 50);
+    CHECK(predict_job(&history, "aaaa", "/tmp/a", 1.0, 3, &p) == 0);
+    CHECK(p.runtime_ms == 100);
+    CHECK(predict_job(&history, "aaaa", "/tmp/a", 0.0, 3, &p) == 0);
+    CHECK(p.runtime_ms == 10);
+}
+
+static void test_matching(void) {
+    history_run_t runs[3] = {
+        run_of("", "/tmp/old", 10, 100, 10),
+        run_of("", "/tmp/old", 10, 200, 20),
+        run_of("cccc", "/tmp/new", 10, 300, 30),
+    };
+    run_history_t history = { runs, 3 };
+
+    job_prediction_t p;
+    // Too few runs with the hash: falls back to runs with the same path
+    CHECK(predict_job(&history, "dddd", "/tmp/old", 0.9, 2, &p) == 0);
+    CHECK(p.samples == 2 && p.peak_rss_kb == 200);
+    CHECK(predict_job(&history, "cccc", "/tmp/elsewhere", 0.9, 1, &p) == 0);
+    CHECK(p.samples == 1 && p.runtime_ms == 30);
+    CHECK(predict_job(&history, "cccc", "/tmp/new", 0.9, 2, &p) == -1);
+    CHECK(p.samples == 0);
+
+    run_history_t empty = { NULL, 0 };
+    CHECK(predict_job(&empty, "cccc", "/tmp/new", 0.9, 1, &p) == -1);
+}
+
+static void write_file(const char *dir, const char *name, const char *text) {
+    char path[512];
+    snprintf(path, sizeof(path), "%s/%s", dir, name);
+    FILE *fp = fopen(path, "w");
+    if (fp) {
+        fputs(text, fp);
+        fclose(fp);
+    }
+}
+
+static void test_history_load(void) {
+    char dir[] = "/tmp/test_predict_XXXXXX";
+    CHECK(mkdtemp(dir) != NULL);
+
+    write_file(dir, "run_1.json",
+               "{\n  \"program\": \"/tmp/we\\\"ird\",\n  \"binary_hash\": \"0123456789abcdef\",\n"
+               "  \"summary\": {\"runtime_ms\": 40, \"peak_cpu\": 50, \"peak_memory_kb\": 90000, "
+               "\"peak_rss_kb\": 1200, \"cpu_time_ms\": 20, \"exit_reason\": \"EXITED(0)\"}\n}\n");
+    // Written before peak_rss_kb and cpu_time_ms: VmPeak and CPU% stand in
+    write_file(dir, "run_2.json",
+               "{\n  \"program\": \"/tmp/old\",\n"
+               "  \"summary\": {\"runtime_ms\": 200, \"peak_cpu\": 50, \"peak_memory_kb\": 5000, "
+               "\"exit_reason\": \"EXITED(1)\"}\n}\n");
+    // Killed runs and cache hits say nothing new about the program
+    write_file(dir, "run_3.json",
+               "{\n  \"program\": \"/tmp/old\",\n"
+               "  \"summary\": {\"runtime_ms\": 9, \"exit_reason\": \"TIMEOUT\"}\n}\n");
+    write_file(dir, "run_4.json",
+               "{\n  \"cached\": true,\n  \"program\": \"/tmp/old\",\n"
+               "  \"summary\": {\"runtime_ms\": 9, \"exit_reason\": \"EXITED(0)\"}\n}\n");
+    write_file(dir, "bench_5.json", "{\n  \"summary\": {\"exit_reason\": \"EXITED(0)\"}\n}\n");
+
+    run_history_t history;
+    CHECK(history_load(dir, &history) == 0);
+    CHECK(history.count == 2);
+    for (int i = 0; i < history.count; i++) {
+        const history_run_t *run = &history.runs[i];
+        if (strcmp(run->program, "/tmp/we\"ird") == 0) {
+            CHECK(strcmp(run->hash, "0123456789abcdef") == 0);
+            CHECK(run->peak_rss_kb == 1200);
+            CHECK(run->cpu_time_ms == 20);
+        } else {
+            CHECK(strcmp(run->program, "/tmp/old") == 0);
+            CHECK(run->peak_rss_kb == 5000);
+            CHECK(run->cpu_time_ms == 100);
+        }
+    }
+    history_free(&history);
+
+    const char *names[] = { "run_1.json", "run_2.json", "run_3.json", "run_4.json", "bench_5.json" };
+    for (int i = 0; i < 5; i++) {
+        char path[512];
+        snprintf(path, sizeof(path), "%s/%s", dir, names[i]);
+        unlink(path);
+    }
+    rmdir(dir);
+}
+
+static void test_hash_file(void) {
+    char dir[] = "/tmp/test_predict_XXXXXX", path[64], hash[17];
+    CHECK(mkdtemp(dir) != NULL);
+    snprintf(path, sizeof(path), "%s/prog", dir);
+
+    write_file(dir, "prog", "a");
+    CHECK(predict_hash_file(path, hash, sizeof(hash)) == 0 && strcmp(hash, "44bd8ad473cd9906") == 0);
+    CHECK(predict_hash_file(path, hash, sizeof(hash)) == 0 && strcmp(hash, "44bd8ad473cd9906") == 0);
+    // Rewritten in place at the same size: not served from the cache
+    write_file(dir, "prog", "b");
+    CHECK(predict_hash_file(path, hash, sizeof(hash)) == 0 && strcmp(hash, "44bd89d473cd9753") == 0);
+    CHECK(predict_hash_file("/nonexistent", hash, sizeof(hash)) == -1);
+
+    unlink(path);
+    rmdir(dir);
+}
+
+int main(void) {
+    test_quantiles();
+    test_matching();
+    test_history_load();
+    test_hash_file();
+    return check_report("predict");
+}
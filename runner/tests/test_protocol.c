@@ -0,0 +1,127 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include "check.h"
+#include "protocol.h"
+
+static void test_fields(void) {
+    static proto_buf_t b;
+    proto_buf_init(&b);
+    proto_put_str(&b, TAG_BINARY, "/bin/echo");
+    proto_put_str(&b, TAG_ARG, "");
+    proto_put_u32(&b, TAG_MEMORY_MB, 4096);
+    proto_put_i64(&b, TAG_RUNTIME_MS, -5);
+    proto_put_i64(&b, TAG_PEAK_MEMORY_KB, 1LL << 40);
+    CHECK(!b.overflow);
+
+    size_t offset = 0;
+    uint16_t tag, len;
+    const uint8_t *value;
+    char str[16];
+    CHECK(proto_next(b.buf, b.len, &offset, &tag, &value, &len) == 1);
+    proto_get_str(value, len, str, sizeof(str));
+    CHECK(tag == TAG_BINARY && strcmp(str, "/bin/echo") == 0);
+    CHECK(proto_next(b.buf, b.len, &offset, &tag, &value, &len) == 1);
+    CHECK(tag == TAG_ARG && len == 0);
+    CHECK(proto_next(b.buf, b.len, &offset, &tag, &value, &len) == 1);
+    CHECK(tag == TAG_MEMORY_MB && proto_get_u32(value, len) == 4096);
+    CHECK(proto_next(b.buf, b.len, &offset, &tag, &value, &len) == 1);
+    CHECK(tag == TAG_RUNTIME_MS && proto_get_i64(value, len) == -5);
+    CHECK(proto_next(b.buf, b.len, &offset, &tag, &value, &len) == 1);
+    CHECK(tag == TAG_PEAK_MEMORY_KB && proto_get_i64(value, len) == 1LL << 40);
+    CHECK(proto_next(b.buf, b.len, &offset, &tag, &value, &len) == 0);
+
+    // A field cut short is reported, never read past the payload
+    offset = 0;
+    CHECK(proto_next(b.buf, 3, &offset, &tag, &value, &len) == -1);
+    offset = 0;
+    CHECK(proto_next(b.buf, 4 + 8, &offset, &tag, &value, &len) == -1);
+
+    // Wrong-sized integers and long strings are handled, not overrun
+    CHECK(proto_get_u32((const uint8_t *)"\1\2", 2) == 0);
+    proto_get_str((const uint8_t *)"abcdefghij", 10, str, 4);
+    CHECK(strcmp(str, "abc") == 0);
+}
+
+static void test_overflow(void) {
+    static proto_buf_t b;
+    static char big[60000];
+    memset(big, 'x', sizeof(big) - 1);
+    big[sizeof(big) - 1] = '\0';
+    proto_buf_init(&b);
+    proto_put_str(&b, TAG_ARG, big);
+    CHECK(!b.overflow);
+    size_t before = b.len;
+    proto_put_str(&b, TAG_ARG, big);
+    CHECK(b.overflow);
+    CHECK(b.len == before);         // Nothing partial is left behind
+}
+
+typedef struct {
+    int fd;
+    const void *payload;
+    uint32_t length;
+} writer_t;
+
+static void *write_frame(void *arg) {
+    writer_t *w = arg;
+    proto_write_frame(w->fd, MSG_SUBMIT, 7, w->payload, w->length);
+    return NULL;
+}
+
+static void test_frames(void) {
+    int sv[2];
+    CHECK(socketpair(AF_UNIX, SOCK_STREAM, 0, sv) == 0);
+
+    // A full-size payload is larger than the socket buffer: the writer
+    // blocks part way and the reader must still get the whole frame
+    static proto_buf_t b;
+    static uint8_t got[PROTO_MAX_PAYLOAD];
+    proto_buf_init(&b);
+    for (int i = 0; !b.overflow; i++) proto_put_u32(&b, TAG_NPROC, i);
+    writer_t w = { sv[0], b.buf, b.len };
+    pthread_t thread;
+    pthread_create(&thread, NULL, write_frame, &w);
+    proto_header_t hdr;
+    CHECK(proto_read_frame(sv[1], &hdr, got, sizeof(got)) == 0);
+    pthread_join(thread, NULL);
+    CHECK(hdr.type == MSG_SUBMIT && hdr.job_tag == 7 && hdr.length == b.len);
+    CHECK(memcmp(got, b.buf, b.len) == 0);
+
+    proto_sample_t sample = { 100, 50, 2048, 3, 75, 1 }, back;
+    CHECK(proto_write_frame(sv[0], MSG_SAMPLE, 8, &sample, sizeof(sample)) == 0);
+    CHECK(proto_read_frame(sv[1], &hdr, &back, sizeof(back)) == 0);
+    CHECK(hdr.type == MSG_SAMPLE && hdr.job_tag == 8 && memcmp(&sample, &back, sizeof(back)) == 0);
+
+    CHECK(proto_write_frame(sv[0], MSG_RESULT, 9, NULL, 0) == 0);
+    CHECK(proto_read_frame(sv[1], &hdr, got, sizeof(got)) == 0);
+    CHECK(hdr.type == MSG_RESULT && hdr.length == 0);
+
+    // Frames larger than the reader's buffer and bad magic are refused
+    CHECK(proto_write_frame(sv[0], MSG_SAMPLE, 10, &sample, sizeof(sample)) == 0);
+    CHECK(proto_read_frame(sv[1], &hdr, &back, sizeof(back) - 1) == -1);
+    close(sv[0]);
+    close(sv[1]);
+
+    CHECK(socketpair(AF_UNIX, SOCK_STREAM, 0, sv) == 0);
+    proto_header_t bad = { 0x1234, MSG_SUBMIT, 11, 0 };
+    CHECK(write(sv[0], &bad, sizeof(bad)) == (ssize_t)sizeof(bad));
+    CHECK(proto_read_frame(sv[1], &hdr, got, sizeof(got)) == -1);
+
+    // EOF part way through a header
+    CHECK(write(sv[0], &bad, 3) == 3);
+    close(sv[0]);
+    CHECK(proto_read_frame(sv[1], &hdr, got, sizeof(got)) == -1);
+    close(sv[1]);
+}
+
+int main(void) {
+    test_fields();
+    test_overflow();
+    test_frames();
+    return check_report("protocol");
+}
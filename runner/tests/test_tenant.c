@@ -0,0 +1,128 @@
+#include <string.h>
+#include "check.h"
+#include "tenant.h"
+#include "job.h"
+
+// Dispatch n equal jobs from always-backlogged tenants, recording the order
+static void dispatch(tenant_t *tenants, int count, int n, double charge_s, int *order) {
+    unsigned char eligible[MAX_TENANTS];
+    memset(eligible, 1, sizeof(eligible));
+    for (int i = 0; i < n; i++) {
+        order[i] = tenant_next(tenants, count, eligible);
+        tenant_charge(&tenants[order[i]], charge_s);
+    }
+}
+
+static void test_weighted_share(void) {
+    tenant_t tenants[2];
+    tenant_init(&tenants[0], "heavy");
+    tenant_init(&tenants[1], "light");
+    tenants[0].weight = 300;
+
+    int order[40], served[2] = {0, 0};
+    dispatch(tenants, 2, 40, 3.0, order);   // Virtual time +1 and +3: exact ties
+    for (int i = 0; i < 40; i++) served[order[i]]++;
+    CHECK(served[0] == 30);
+    CHECK(served[1] == 10);
+
+    // Ties go to the first tenant, so the order repeats heavy, light, heavy, heavy
+    int expect[8] = {0, 1, 0, 0, 0, 1, 0, 0};
+    CHECK(memcmp(order, expect, sizeof(expect)) == 0);
+}
+
+static void test_eligibility(void) {
+    tenant_t tenants[3];
+    tenant_init(&tenants[0], "a");
+    tenant_init(&tenants[1], "b");
+    tenant_init(&tenants[2], "c");
+    tenant_charge(&tenants[0], 1.0);
+    tenant_charge(&tenants[1], 2.0);
+    tenant_charge(&tenants[2], 3.0);
+
+    unsigned char none[3] = {0, 0, 0};
+    unsigned char some[3] = {0, 1, 1};
+    CHECK(tenant_next(tenants, 3, none) == -1);
+    // The lowest virtual time among the eligible, not overall
+    CHECK(tenant_next(tenants, 3, some) == 1);
+}
+
+static void test_correction(void) {
+    tenant_t tenants[2];
+    tenant_init(&tenants[0], "a");
+    tenant_init(&tenants[1], "b");
+    tenants[1].weight = 200;
+
+    // Charged 1 s at dispatch, really used 0.2 s: refunded at exit
+    tenant_charge(&tenants[0], 1.0);
+    tenant_charge(&tenants[0], 0.2 - 1.0);
+    CHECK(tenants[0].vtime > 0.19 && tenants[0].vtime < 0.21);
+    // Same CPU time at twice the weight costs half the virtual time
+    tenant_charge(&tenants[1], 0.2);
+    CHECK(tenants[1].vtime > 0.09 && tenants[1].vtime < 0.11);
+    unsigned char both[2] = {1, 1};
+    CHECK(tenant_next(tenants, 2, both) == 1);
+}
+
+static void test_late_arrival(void) {
+    tenant_t tenants[2];
+    tenant_init(&tenants[0], "early");
+    tenant_init(&tenants[1], "late");
+    unsigned char backlogged[2] = {0, 0}, waiting[2] = {1, 0};
+    double floor = 0;
+
+    // "early" has the host to itself for 10 jobs
+    for (int i = 0; i < 10; i++) {
+        tenant_update_backlog(tenants, 2, waiting, backlogged, &floor);
+        CHECK(tenant_next(tenants, 2, waiting) == 0);
+        tenant_charge(&tenants[0], 1.0);
+    }
+
+    // "late" joins level with it instead of taking the next 10 jobs in a row
+    waiting[1] = 1;
+    int order[4];
+    for (int i = 0; i < 4; i++) {
+        tenant_update_backlog(tenants, 2, waiting, backlogged, &floor);
+        order[i] = tenant_next(tenants, 2, waiting);
+        tenant_charge(&tenants[order[i]], 1.0);
+    }
+    int expect[4] = {0, 1, 0, 1};
+    CHECK(memcmp(order, expect, sizeof(expect)) == 0);
+
+    // Going idle and coming back does not bank the idle time either
+    waiting[1] = 0;
+    for (int i = 0; i < 5; i++) {
+        tenant_update_backlog(tenants, 2, waiting, backlogged, &floor);
+        tenant_charge(&tenants[0], 1.0);
+    }
+    waiting[1] = 1;
+    tenant_update_backlog(tenants, 2, waiting, backlogged, &floor);
+    CHECK(tenants[1].vtime == tenants[0].vtime);
+
+    // A tenant that is already ahead keeps its virtual time
+    tenant_charge(&tenants[1], 3.0);
+    waiting[1] = 0;
+    tenant_update_backlog(tenants, 2, waiting, backlogged, &floor);
+    waiting[1] = 1;
+    tenant_update_backlog(tenants, 2, waiting, backlogged, &floor);
+    CHECK(tenants[1].vtime == tenants[0].vtime + 3.0);
+}
+
+static void test_names(void) {
+    char name[32];
+    CHECK(job_parse_tenant("team-a_1.ci", name, sizeof(name)) == 0 && strcmp(name, "team-a_1.ci") == 0);
+    // Names end up as cgroup directories and JSON strings: nothing else gets through
+    const char *bad[] = {"", ".", "..", ".hidden", "a/b", "a\"b", "a\\b", "a b", "\xc3\xa9",
+                         "abcdefghijklmnopqrstuvwxyz789012"};
+    for (size_t i = 0; i < sizeof(bad) / sizeof(bad[0]); i++) {
+        CHECK(job_parse_tenant(bad[i], name, sizeof(name)) == -1);
+    }
+}
+
+int main(void) {
+    test_weighted_share();
+    test_eligibility();
+    test_correction();
+    test_late_arrival();
+    test_names();
+    return check_report("tenant");
+}
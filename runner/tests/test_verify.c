@@ -0,0 +1,141 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "check.h"
+#include "verify.h"
+
+static char path[] = "/tmp/test_verify_XXXXXX";
+
+// First mismatching output offset (-1 = accepted), feeding 'chunk' bytes at a time
+static long long verdict_chunked(verify_mode_t mode, const char *expected, const char *output, size_t chunk) {
+    FILE *fp = fopen(path, "w");
+    if (!fp) return -2;
+    fputs(expected, fp);
+    fclose(fp);
+
+    verifier_t v;
+    if (verify_open(&v, path, mode) != 0) return -2;
+    size_t len = strlen(output);
+    for (size_t i = 0; i < len; i += chunk) {
+        size_t n = len - i < chunk ? len - i : chunk;
+        if (verify_feed(&v, (const unsigned char *)output + i, n) != 0) break;
+    }
+    verify_finish(&v);
+    verify_close(&v);
+    return v.mismatch;
+}
+
+// Same verdict whether the output arrives byte by byte or in one piece
+static long long verdict(verify_mode_t mode, const char *expected, const char *output) {
+    static const size_t chunks[] = { 1, 2, 7, 16, 17, 1 << 20 };
+    long long first = verdict_chunked(mode, expected, output, chunks[0]);
+    for (size_t i = 1; i < sizeof(chunks) / sizeof(chunks[0]); i++) {
+        long long got = verdict_chunked(mode, expected, output, chunks[i]);
+        if (got != first) {
+            fprintf(stderr, "chunk %zu: mismatch %lld, byte by byte %lld (\"%s\")\n", chunks[i], got, first, output);
+            return -3;
+        }
+    }
+    return first;
+}
+
+static void test_common_prefix(void) {
+    // Every difference position around the 16-byte blocks, at two alignments
+    unsigned char a[64], b[64];
+    for (int i = 0; i < 64; i++) a[i] = (unsigned char)('a' + i % 26);
+    int ok = 1;
+    for (int shift = 0; shift < 2; shift++) {
+        for (size_t n = 0; n + shift <= 48; n++) {
+            for (size_t diff = 0; diff <= n; diff++) {
+                memcpy(b, a, sizeof(b));
+                if (diff < n) b[shift + diff] ^= 0x80;
+                if (verify_common_prefix(a + shift, b + shift, n) != diff) ok = 0;
+            }
+        }
+    }
+    CHECK(ok);
+}
+
+static void test_modes(void) {
+    verify_mode_t mode;
+    CHECK(verify_parse_mode("tokens", &mode) == 0 && mode == VERIFY_TOKENS);
+    CHECK(verify_parse_mode("fuzzy", &mode) == -1);
+    CHECK(strcmp(verify_mode_name(VERIFY_WHITESPACE), "whitespace") == 0);
+}
+
+static void test_exact(void) {
+    CHECK(verdict(VERIFY_EXACT, "1 2\n", "1 2\n") == -1);
+    CHECK(verdict(VERIFY_EXACT, "1 2\n", "1 2 \n") == 3);
+    CHECK(verdict(VERIFY_EXACT, "1 2\n", "1 2") == 3);          // Ends early
+    CHECK(verdict(VERIFY_EXACT, "1 2\n", "1 2\n3") == 4);       // Goes on
+    CHECK(verdict(VERIFY_EXACT, "", "") == -1);
+    CHECK(verdict(VERIFY_EXACT, "", "x") == 0);
+}
+
+static void test_whitespace(void) {
+    CHECK(verdict(VERIFY_WHITESPACE, "1 2\n3\n", "1 2  \n3\t\n") == -1);
+    CHECK(verdict(VERIFY_WHITESPACE, "1 2\n", "1 2\r\n\n\n") == -1);
+    CHECK(verdict(VERIFY_WHITESPACE, "1 2 \n\n", "1 2") == -1);
+    CHECK(verdict(VERIFY_WHITESPACE, "", "\n \n") == -1);
+    // Whitespace inside a line counts, reported where it began
+    CHECK(verdict(VERIFY_WHITESPACE, "1 2\n", "1  2\n") == 2);
+    CHECK(verdict(VERIFY_WHITESPACE, "1 2\n", "12\n") == 1);
+    CHECK(verdict(VERIFY_WHITESPACE, "1\n2\n", "1\n") == 2);    // Missing line
+    CHECK(verdict(VERIFY_WHITESPACE, "1\n", "1\n\n2\n") == 3);  // Extra line
+}
+
+static void test_tokens(void) {
+    CHECK(verdict(VERIFY_TOKENS, "1 2 3\n", "1   2\n\n3") == -1);
+    CHECK(verdict(VERIFY_TOKENS, "  1\t2\n", "1 2") == -1);
+    CHECK(verdict(VERIFY_TOKENS, "1 2 3\n", "12 3\n") == 1);
+    CHECK(verdict(VERIFY_TOKENS, "1 2 3\n", "1 23\n") == 3);
+    CHECK(verdict(VERIFY_TOKENS, "1 2 3\n", "1 2\n") == 4);     // Missing token
+    CHECK(verdict(VERIFY_TOKENS, "1 2 3\n", "1 2 3 4\n") == 6);
+    CHECK(verdict(VERIFY_TOKENS, "10\n", "1") == 1);            // Token cut short
+}
+
+static void test_long(void) {
+    // Past the first SIMD blocks, so the fast skip and the byte rules meet
+    // at every offset
+    char expected[256], output[256];
+    for (int i = 0; i < 200; i++) expected[i] = (i % 10 == 9) ? '\n' : (char)('0' + i % 10);
+    expected[200] = '\0';
+    int ok = 1;
+    for (int at = 0; at < 200; at++) {
+        memcpy(output, expected, sizeof(output));
+        if (expected[at] == '\n') continue;
+        output[at] = 'x';
+        if (verdict(VERIFY_EXACT, expected, output) != at) ok = 0;
+        if (verdict(VERIFY_WHITESPACE, expected, output) != at) ok = 0;
+        if (verdict(VERIFY_TOKENS, expected, output) != at) ok = 0;
+    }
+    CHECK(ok);
+
+    // Trailing spaces on every line
+    int n = 0;
+    for (int line = 0; line < 20; line++) n += sprintf(output + n, "%.9s  \n", expected + line * 10);
+    CHECK(verdict(VERIFY_EXACT, expected, output) == 9);
+    CHECK(verdict(VERIFY_WHITESPACE, expected, output) == -1);
+    CHECK(verdict(VERIFY_TOKENS, expected, output) == -1);
+}
+
+int main(void) {
+    int fd = mkstemp(path);
+    if (fd < 0) {
+        perror("mkstemp");
+        return 1;
+    }
+    close(fd);
+
+    test_common_prefix();
+    test_modes();
+    test_exact();
+    test_whitespace();
+    test_tokens();
+    test_long();
+
+    unlink(path);
+    return check_report("verify");
+}
@@ -0,0 +1,490 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sched.h>
+#include <signal.h>
+#include <dirent.h>
+#include <time.h>
+#include <sys/signalfd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+#include "testset.h"
+#include "telemetry.h"
+#include "cgroup.h"
+
+/**
+ * MULTI-TESTCASE MODE (--tests DIR)
+ *
+ * One submitted binary, many inputs. Namespaces, mounts and rlimits are set
+ * up once, in a zygote that is PID 1 of the sandbox's PID namespace. Every
+ * testcase is a fork of the zygote that takes its own stdin/stdout/stderr,
+ * loads the precompiled seccomp filter and execs the binary, so a case pays
+ * for fork + exec only.
+ *
+ * The zygote's root is read-only, so the launcher opens each case's files
+ * and passes them over a SOCK_SEQPACKET socketpair (SCM_RIGHTS); the zygote
+ * answers with the case's wait4() rusage on the same socket.
+ *
+ * --tenant and --cpuset place the zygote, before the first case is sent,
+ * in one cgroup (sandbox_project/[<tenant>/]tests_<pid>) pinned to its
+ * cores; every case is forked from it and so runs there too.
+ */
+
+#define STACK_SIZE (1024 * 1024)
+#define MAX_WORKERS 16      // Each running case holds 3 fds under RLIMIT_NOFILE
+
+// zygote -> launcher, one per testcase
+typedef struct {
+    int index;
+    int status;             // wait4() status, -1 if fork failed
+    int timed_out;
+    long runtime_ms;
+    long cpu_time_ms;
+    long peak_memory_kb;
+} test_report_t;
+
+typedef struct {
+    const job_spec_t *spec;
+    int sock;
+    int peer;               // Launcher's end, inherited by clone()
+} zygote_args_t;
+
+typedef struct {
+    pid_t pid;
+    int index;
+    long start_ms;
+    int killed;
+} running_case_t;
+
+// Where the zygote and its cases run (tenant / cpuset)
+typedef struct {
+    char cgroup[512];           // "" = none
+    char cpus[64];
+    cpu_set_t run_on;
+    cpu_set_t reserved;         // Held in spec->cores until the set is done
+    int pinned;
+} placement_t;
+
+// -------------------------------------------------------------
+// Descriptor passing
+// -------------------------------------------------------------
+
+static int send_case(int sock, int index, const int fds[3]) {
+    char control[CMSG_SPACE(3 * sizeof(int))] = {0};
+    struct iovec iov = { &index, sizeof(index) };
+    struct msghdr msg = {0};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+
+    struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(3 * sizeof(int));
+    memcpy(CMSG_DATA(cmsg), fds, 3 * sizeof(int));
+    return sendmsg(sock, &msg, MSG_NOSIGNAL) == sizeof(index) ? 0 : -1;
+}
+
+// Returns 0 with the case's fds, -1 at EOF (no more cases) or on error
+static int recv_case(int sock, int *index, int fds[3]) {
+    char control[CMSG_SPACE(3 * sizeof(int))];
+    struct iovec iov = { index, sizeof(*index) };
+    struct msghdr msg = {0};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+
+    ssize_t n;
+    do {
+        n = recvmsg(sock, &msg, MSG_CMSG_CLOEXEC);
+    } while (n < 0 && errno == EINTR);
+    if (n != sizeof(*index)) return -1;
+
+    struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+    if (!cmsg || cmsg->cmsg_type != SCM_RIGHTS || cmsg->cmsg_len != CMSG_LEN(3 * sizeof(int))) return -1;
+    memcpy(fds, CMSG_DATA(cmsg), 3 * sizeof(int));
+    return 0;
+}
+
+// -------------------------------------------------------------
+// Zygote (inside the sandbox namespaces)
+// -------------------------------------------------------------
+
+static void report_case(int sock, const running_case_t *rc, int status, const struct rusage *ru) {
+    test_report_t report = {0};
+    report.index = rc->index;
+    report.status = status;
+    report.timed_out = rc->killed;
+    report.runtime_ms = get_current_time_ms() - rc->start_ms;
+    report.cpu_time_ms = (ru->ru_utime.tv_sec + ru->ru_stime.tv_sec) * 1000 +
+                         (ru->ru_utime.tv_usec + ru->ru_stime.tv_usec) / 1000;
+    report.peak_memory_kb = ru->ru_maxrss;
+    ssize_t ignored = send(sock, &report, sizeof(report), MSG_NOSIGNAL);
+    (void)ignored;
+}
+
+static int zygote_fn(void *arg) {
+    const zygote_args_t *z = (const zygote_args_t *)arg;
+    const job_spec_t *spec = z->spec;
+
+    // Otherwise the launcher closing its end would never read as EOF here
+    close(z->peer);
+    job_enter_sandbox(spec);
+
+    // SIGCHLD through a signalfd so one poll() covers new cases and exits
+    sigset_t chld;
+    sigemptyset(&chld);
+    sigaddset(&chld, SIGCHLD);
+    sigprocmask(SIG_BLOCK, &chld, NULL);
+    int sfd = signalfd(-1, &chld, SFD_CLOEXEC | SFD_NONBLOCK);
+
+    running_case_t running[MAX_WORKERS];
+    int nrunning = 0;
+    int open = 1;
+
+    while (open || nrunning > 0) {
+        int status;
+        struct rusage ru;
+        pid_t pid;
+        while ((pid = wait4(-1, &status, WNOHANG, &ru)) > 0) {
+            for (int i = 0; i < nrunning; i++) {
+                if (running[i].pid != pid) continue;
+                report_case(z->sock, &running[i], status, &ru);
+                running[i] = running[--nrunning];
+                break;
+            }
+        }
+
+        // Per-case wall-clock limit
+        int timeout = -1;
+        long now = get_current_time_ms();
+        for (int i = 0; i < nrunning && spec->limits.time_ms > 0; i++) {
+            long left = running[i].start_ms + spec->limits.time_ms - now;
+            if (running[i].killed) continue;
+            if (left <= 0) {
+                kill(running[i].pid, SIGKILL);
+                running[i].killed = 1;
+            } else if (timeout < 0 || left < timeout) {
+                timeout = (int)left;
+            }
+        }
+        if (!open && nrunning == 0) break;
+
+        struct pollfd pfd[2] = {
+            { sfd, POLLIN, 0 },
+            { open && nrunning < MAX_WORKERS ? z->sock : -1, POLLIN, 0 }
+        };
+        if (poll(pfd, 2, timeout) < 0 && errno != EINTR) break;
+        if (pfd[0].revents & POLLIN) {
+            struct signalfd_siginfo info;
+            while (read(sfd, &info, sizeof(info)) == sizeof(info)) {}
+        }
+        if (!(pfd[1].revents & (POLLIN | POLLHUP))) continue;
+
+        int index, fds[3];
+        if (recv_case(z->sock, &index, fds) != 0) {
+            open = 0;
+            continue;
+        }
+
+        long start = get_current_time_ms();
+        pid_t child = fork();
+        if (child == 0) {
+            // The signal mask survives execve
+            sigprocmask(SIG_UNBLOCK, &chld, NULL);
+            dup2(fds[0], STDIN_FILENO);
+            dup2(fds[1], STDOUT_FILENO);
+            dup2(fds[2], STDERR_FILENO);
+            job_exec(spec);
+        }
+        for (int i = 0; i < 3; i++) close(fds[i]);
+
+        running_case_t rc = { child, index, start, 0 };
+        if (child < 0) {
+            struct rusage none = {0};
+            report_case(z->sock, &rc, -1, &none);
+        } else {
+            running[nrunning++] = rc;
+        }
+    }
+    _exit(0);
+}
+
+// -------------------------------------------------------------
+// Launcher side
+// -------------------------------------------------------------
+
+static int is_input(const struct dirent *ent) {
+    size_t len = strlen(ent->d_name);
+    return len > 3 && strcmp(ent->d_name + len - 3, ".in") == 0;
+}
+
+static void describe_exit(const test_report_t *r, char *out, size_t len) {
+    if (r->status == -1) {
+        snprintf(out, len, "SPAWN_FAILED");
+    } else if (WIFEXITED(r->status)) {
+        snprintf(out, len, "EXITED(%d)", WEXITSTATUS(r->status));
+    } else if (r->timed_out) {
+        snprintf(out, len, "TIME_LIMIT_EXCEEDED");
+    } else if (WTERMSIG(r->status) == SIGSYS) {
+        snprintf(out, len, "SECURITY_VIOLATION");
+    } else if (WTERMSIG(r->status) == SIGKILL) {
+        snprintf(out, len, "KILLED_BY_OS");
+    } else {
+        snprintf(out, len, "SIGNALED");
+    }
+}
+
+static int open_case(const testcase_t *tc, int fds[3]) {
+    char err_path[520];
+    snprintf(err_path, sizeof(err_path), "%.*s.err", (int)strlen(tc->output) - 4, tc->output);
+
+    fds[0] = open(tc->input, O_RDONLY | O_CLOEXEC);
+    fds[1] = open(tc->output, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    fds[2] = open(err_path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fds[0] >= 0 && fds[1] >= 0 && fds[2] >= 0) return 0;
+
+    perror(tc->input);
+    for (int i = 0; i < 3; i++) {
+        if (fds[i] >= 0) close(fds[i]);
+    }
+    return -1;
+}
+
+static int write_log(const char *path, const job_spec_t *spec, const char *dir, int workers,
+                     const testcase_t *cases, int count, long total_ms) {
+    FILE *fp = fopen(path, "w");
+    if (!fp) {
+        perror("fopen tests log");
+        return -1;
+    }
+
+    int ok = 0;
+    for (int i = 0; i < count; i++) ok += strcmp(cases[i].exit_reason, "EXITED(0)") == 0;
+
+    char esc[JSON_STR_MAX], name[JSON_STR_MAX], input[JSON_STR_MAX], output[JSON_STR_MAX];
+    fprintf(fp, "{\n");
+    fprintf(fp, "  \"program\": \"%s\",\n", json_escape(spec->binary_path, esc, sizeof(esc)));
+    fprintf(fp, "  \"profile\": \"%s\",\n", spec->profile_name);
+    if (spec->binary_hash[0]) fprintf(fp, "  \"binary_hash\": \"%s\",\n", spec->binary_hash);
+    fprintf(fp, "  \"tests_dir\": \"%s\",\n", json_escape(dir, esc, sizeof(esc)));
+    fprintf(fp, "  \"summary\": {\"cases\": %d, \"exited_ok\": %d, \"workers\": %d, \"total_ms\": %ld},\n",
+            count, ok, workers, total_ms);
+    fprintf(fp, "  \"cases\": [\n");
+    for (int i = 0; i < count; i++) {
+        const testcase_t *tc = &cases[i];
+        fprintf(fp, "    {\"name\": \"%s\", \"input\": \"%s\", \"output\": \"%s\", \"exit_reason\": \"%s\", "
+                    "\"runtime_ms\": %ld, \"cpu_time_ms\": %ld, \"peak_memory_kb\": %ld}%s\n",
+                json_escape(tc->name, name, sizeof(name)), json_escape(tc->input, input, sizeof(input)),
+                json_escape(tc->output, output, sizeof(output)), tc->exit_reason, tc->runtime_ms, tc->cpu_time_ms,
+                tc->peak_memory_kb, i < count - 1 ? "," : "");
+    }
+    fprintf(fp, "  ]\n}\n");
+    fclose(fp);
+    return 0;
+}
+
+static void free_ents(struct dirent **ents, int count) {
+    for (int i = 0; i < count; i++) free(ents[i]);
+    free(ents);
+}
+
+// Cores and a cgroup for the whole set, as job.c does per job
+static void place_prepare(const job_spec_t *spec, placement_t *pl) {
+    memset(pl, 0, sizeof(*pl));
+    if (spec->cpuset_mode != CPUSET_NONE && spec->cores) {
+        if (core_allocate(spec->cores, spec->cpuset_mode, spec->cpuset_cores, spec->idle_siblings,
+                          &pl->run_on, &pl->reserved) != 0) {
+            fprintf(stderr, "[Tests] WARNING: exclusive CPUs cannot fit %d core(s). Using the shared pool.\n",
+                    spec->cpuset_cores);
+            core_allocate(spec->cores, CPUSET_SHARED, 0, 0, &pl->run_on, &pl->reserved);
+        }
+        cpuset_format(&pl->run_on, pl->cpus, sizeof(pl->cpus));
+        pl->pinned = 1;
+    }
+    if (!pl->pinned && !spec->tenant[0]) return;
+
+    char rel[128], ours[512];
+    if (spec->tenant[0]) {
+        snprintf(rel, sizeof(rel), SANDBOX_CGROUP_PARENT "/%s/tests_%d", spec->tenant, getpid());
+    } else {
+        snprintf(rel, sizeof(rel), SANDBOX_CGROUP_PARENT "/tests_%d", getpid());
+    }
+    if (cgroup_create(rel, pl->cgroup, sizeof(pl->cgroup)) != 0) {
+        fprintf(stderr, "[Tests] WARNING: could not create cgroup %s; cases run in ours.\n", rel);
+        pl->cgroup[0] = '\0';
+        return;
+    }
+    if (cgroup_path_of(getpid(), ours, sizeof(ours)) == 0) cgroup_copy_limits(ours, pl->cgroup);
+    if (pl->cpus[0]) cgroup_write_file(pl->cgroup, "cpuset.cpus", pl->cpus);
+}
+
+static void place_zygote(const placement_t *pl, pid_t zygote) {
+    if (pl->cgroup[0] && cgroup_attach(pl->cgroup, zygote) != 0) perror("cgroup attach");
+    if (pl->pinned) sched_setaffinity(zygote, sizeof(cpu_set_t), &pl->run_on);
+}
+
+static void place_release(const job_spec_t *spec, const placement_t *pl) {
+    if (pl->cgroup[0]) cgroup_remove(pl->cgroup);
+    if (pl->pinned) core_release(spec->cores, &pl->reserved);
+}
+
+int testset_run(const char *dir, const job_spec_t *spec_in, int workers) {
+    struct dirent **ents;
+    int count = scandir(dir, &ents, is_input, alphasort);
+    if (count < 0) {
+        perror(dir);
+        return 1;
+    }
+    if (count == 0) {
+        fprintf(stderr, "[Tests] No *.in files in %s\n", dir);
+        free(ents);
+        return 1;
+    }
+    if (workers <= 0) workers = 1;
+    if (workers > MAX_WORKERS) workers = MAX_WORKERS;
+
+    // Outputs live next to the combined log
+    char out_dir[128];
+    long stamp = time(NULL);
+    snprintf(out_dir, sizeof(out_dir), "logs/tests_%d_%ld", getpid(), stamp);
+    if (mkdir(out_dir, 0755) != 0) {
+        perror(out_dir);
+        free_ents(ents, count);
+        return 1;
+    }
+
+    testcase_t *cases = calloc(count, sizeof(testcase_t));
+    for (int i = 0; i < count; i++) {
+        size_t len = strlen(ents[i]->d_name) - 3;
+        snprintf(cases[i].name, sizeof(cases[i].name), "%.*s", (int)len, ents[i]->d_name);
+        snprintf(cases[i].input, sizeof(cases[i].input), "%s/%s", dir, ents[i]->d_name);
+        snprintf(cases[i].output, sizeof(cases[i].output), "%s/%s.out", out_dir, cases[i].name);
+    }
+    free_ents(ents, count);
+
+    // Cases write to their own files, so nothing may go to our stdout
+    job_spec_t spec = *spec_in;
+    spec.quiet = 1;
+    struct sock_fprog own_filter = {0};
+    if (!spec.filter) {
+        if (job_compile_filter(spec.profile, &own_filter) != 0) {
+            free(cases);
+            return 1;
+        }
+        spec.filter = &own_filter;
+    }
+    if (!spec.binary_hash[0]) predict_hash_file(spec.binary_path, spec.binary_hash, sizeof(spec.binary_hash));
+
+    int sv[2];
+    char *stack = malloc(STACK_SIZE);
+    if (!stack || socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, sv) != 0) {
+        perror("tests setup");
+        free(stack);
+        free(own_filter.filter);
+        free(cases);
+        return 1;
+    }
+
+    // Same isolation as job.c, prepared once for every case
+    int flags = CLONE_NEWNS | CLONE_NEWPID | CLONE_NEWIPC | CLONE_NEWUTS | CLONE_NEWUSER | SIGCHLD;
+    zygote_args_t z = { &spec, sv[1], sv[0] };
+    placement_t pl;
+    place_prepare(&spec, &pl);
+    long start = get_current_time_ms();
+    fflush(stdout);
+    pid_t zygote = clone(zygote_fn, stack + STACK_SIZE, flags, &z);
+    free(stack);
+    close(sv[1]);
+    if (zygote == -1) {
+        perror("clone failed");
+        close(sv[0]);
+        place_release(&spec, &pl);
+        free(own_filter.filter);
+        free(cases);
+        return 1;
+    }
+    // Cases are forked from the zygote once it has a case to run, by then
+    // it sits in the cgroup and on the cores
+    place_zygote(&pl, zygote);
+    printf("[Tests] Sandbox prepared once (zygote PID %d): %d case(s) from %s, %d at a time\n",
+           zygote, count, dir, workers);
+    if (pl.cgroup[0] || pl.pinned) {
+        printf("[Tests] Cases run in %s%s%s\n", pl.cgroup[0] ? pl.cgroup : "our cgroup",
+               pl.pinned ? " on CPUs " : "", pl.cpus);
+    }
+
+    int next = 0, outstanding = 0, done = 0;
+    while (done < count) {
+        while (outstanding < workers && next < count) {
+            int fds[3];
+            testcase_t *tc = &cases[next++];
+            if (open_case(tc, fds) != 0) {
+                snprintf(tc->exit_reason, sizeof(tc->exit_reason), "NO_INPUT");
+                tc->done = 1;
+                done++;
+                continue;
+            }
+            int sent = send_case(sv[0], (int)(tc - cases), fds);
+            for (int i = 0; i < 3; i++) close(fds[i]);
+            if (sent != 0) {
+                next = count;
+                break;
+            }
+            outstanding++;
+        }
+        if (outstanding == 0) break;
+
+        test_report_t report;
+        ssize_t n = recv(sv[0], &report, sizeof(report), 0);
+        if (n < 0 && errno == EINTR) continue;
+        if (n != sizeof(report) || report.index < 0 || report.index >= count) {
+            fprintf(stderr, "[Tests] Sandbox zygote exited early\n");
+            break;
+        }
+
+        testcase_t *tc = &cases[report.index];
+        describe_exit(&report, tc->exit_reason, sizeof(tc->exit_reason));
+        tc->runtime_ms = report.runtime_ms;
+        tc->cpu_time_ms = report.cpu_time_ms;
+        tc->peak_memory_kb = report.peak_memory_kb;
+        tc->done = 1;
+        outstanding--;
+        done++;
+        printf("[Tests] %-24s %-20s %6ld ms %6ld ms CPU %8ld KB\n", tc->name, tc->exit_reason,
+               tc->runtime_ms, tc->cpu_time_ms, tc->peak_memory_kb);
+    }
+
+    // EOF tells the zygote there are no more cases
+    close(sv[0]);
+    waitpid(zygote, NULL, 0);
+    long total_ms = get_current_time_ms() - start;
+    place_release(&spec, &pl);
+
+    int ok = 0;
+    for (int i = 0; i < count; i++) {
+        if (!cases[i].done) snprintf(cases[i].exit_reason, sizeof(cases[i].exit_reason), "NOT_RUN");
+        ok += strcmp(cases[i].exit_reason, "EXITED(0)") == 0;
+    }
+    printf("[Tests] %d/%d case(s) exited 0 in %ld ms (%.1f ms per case)\n", ok, count, total_ms,
+           (double)total_ms / count);
+
+    char log_path[160];
+    snprintf(log_path, sizeof(log_path), "logs/tests_%d_%ld.json", getpid(), stamp);
+    if (write_log(log_path, &spec, dir, workers, cases, count, total_ms) == 0) {
+        printf("[Tests] Log written to %s (outputs in %s/)\n", log_path, out_dir);
+    }
+
+    free(own_filter.filter);
+    free(cases);
+    return ok == count ? 0 : 1;
+}
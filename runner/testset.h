@@ -0,0 +1,21 @@
+#ifndef TESTSET_H
+#define TESTSET_H
+
+#include "job.h"
+
+// One input file and what happened when the binary ran on it
+typedef struct {
+    char name[128];             // Input file name without ".in"
+    char input[512];
+    char output[512];           // Captured stdout (stderr next to it as .err)
+    char exit_reason[32];
+    long runtime_ms;
+    long cpu_time_ms;           // utime + stime (wait4 rusage)
+    long peak_memory_kb;        // ru_maxrss
+    int done;
+} testcase_t;
+
+// Run spec's binary once per DIR/*.in (stdin = the file), `workers` at a time
+int testset_run(const char *dir, const job_spec_t *spec, int workers);
+
+#endif
@@ -0,0 +1,237 @@
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#include "verify.h"
+
+/**
+ * STREAMING OUTPUT VERIFIER (--expect=FILE)
+ *
+ * The job's stdout is compared with the expected output as it arrives, one
+ * pipe-full at a time, so memory does not grow with the output and a wrong
+ * answer is known at its first wrong byte rather than at exit. The expected
+ * file is mmap()ed and walked with a cursor.
+ *
+ * Most output matches, so every mode first skips the longest run of bytes
+ * identical to the expected output (verify_common_prefix, 16 bytes per
+ * SSE2 compare) and only runs the per-byte rules where the two differ:
+ *   exact       any difference is a mismatch
+ *   whitespace  spaces, tabs and CRs before a newline (or the end) and
+ *               blank lines at the end may differ
+ *   tokens      only the whitespace-separated tokens must match
+ * A run of identical bytes leaves every mode in the same state as applying
+ * its rules byte by byte would, which is what makes the skip safe.
+ */
+
+enum {
+    WS_MATCH,                   // Output and expected aligned
+    WS_PENDING,                 // Output has whitespace the expected line lacks: fine only before a newline
+    WS_TRAILING                 // Expected exhausted: only blank lines may follow
+};
+
+static const char *mode_names[] = { "exact", "whitespace", "tokens" };
+
+int verify_parse_mode(const char *name, verify_mode_t *mode) {
+    for (int i = 0; i < 3; i++) {
+        if (strcmp(name, mode_names[i]) == 0) {
+            *mode = (verify_mode_t)i;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+const char *verify_mode_name(verify_mode_t mode) {
+    return mode_names[mode];
+}
+
+static int is_hspace(int c) {
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+static int is_space(int c) {
+    return is_hspace(c) || c == '\n' || c == '\v' || c == '\f';
+}
+
+// Length of the common prefix of a and b
+size_t verify_common_prefix(const unsigned char *a, const unsigned char *b, size_t n) {
+    size_t i = 0;
+#ifdef __SSE2__
+    for (; i + 16 <= n; i += 16) {
+        __m128i x = _mm_loadu_si128((const __m128i *)(a + i));
+        __m128i y = _mm_loadu_si128((const __m128i *)(b + i));
+        unsigned mask = (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(x, y));
+        if (mask != 0xFFFF) return i + __builtin_ctz(~mask);
+    }
+#endif
+    while (i < n && a[i] == b[i]) i++;
+    return i;
+}
+
+int verify_open(verifier_t *v, const char *expected_path, verify_mode_t mode) {
+    memset(v, 0, sizeof(*v));
+    v->mode = mode;
+    v->mismatch = -1;
+
+    int fd = open(expected_path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return -1;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+        close(fd);
+        return -1;
+    }
+    if (st.st_size > 0) {
+        void *map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (map == MAP_FAILED) {
+            close(fd);
+            return -1;
+        }
+        madvise(map, st.st_size, MADV_SEQUENTIAL);
+        v->expected = map;
+        v->expected_len = st.st_size;
+    }
+    close(fd);
+    return 0;
+}
+
+void verify_close(verifier_t *v) {
+    if (v->expected) munmap((void *)v->expected, v->expected_len);
+    v->expected = NULL;
+}
+
+// Next expected byte, -1 at the end
+static int peek(const verifier_t *v) {
+    return v->pos < v->expected_len ? v->expected[v->pos] : -1;
+}
+
+static void skip_expected(verifier_t *v, int (*pred)(int)) {
+    while (v->pos < v->expected_len && pred(v->expected[v->pos])) v->pos++;
+}
+
+static int step_whitespace(verifier_t *v, int c) {
+    int x = peek(v);
+    switch (v->state) {
+    case WS_TRAILING:
+        return (is_hspace(c) || c == '\n') ? 0 : -1;
+    case WS_PENDING:
+        if (is_hspace(c)) return 0;
+        if (c != '\n') return -1;
+        skip_expected(v, is_hspace);
+        x = peek(v);
+        if (x < 0) {
+            v->state = WS_TRAILING;
+            return 0;
+        }
+        if (x != '\n') return -1;
+        v->pos++;
+        v->state = WS_MATCH;
+        return 0;
+    default:
+        if (x == c) {
+            v->pos++;
+            return 0;
+        }
+        if (is_hspace(c)) {
+            v->state = WS_PENDING;
+            v->pending_at = v->offset;
+            return 0;
+        }
+        // Expected has trailing whitespace the output lacks
+        if (is_hspace(x)) {
+            skip_expected(v, is_hspace);
+            x = peek(v);
+        }
+        if (c != '\n') return -1;
+        if (x == '\n') {
+            v->pos++;
+            return 0;
+        }
+        if (x < 0) {
+            v->state = WS_TRAILING;
+            return 0;
+        }
+        return -1;
+    }
+}
+
+static int step_tokens(verifier_t *v, int c) {
+    int x = peek(v);
+    if (is_space(c)) {
+        // A token may not end in the output while it goes on in the expected
+        if (v->in_token && x >= 0 && !is_space(x)) return -1;
+        v->in_token = 0;
+        if (x >= 0 && is_space(x)) v->pos++;
+        return 0;
+    }
+    if (!v->in_token) {
+        skip_expected(v, is_space);
+        x = peek(v);
+        v->in_token = 1;
+    }
+    if (x != c) return -1;
+    v->pos++;
+    return 0;
+}
+
+// Feed the next output bytes. Returns -1 once the output has diverged.
+int verify_feed(verifier_t *v, const unsigned char *buf, size_t len) {
+    size_t i = 0;
+    while (i < len && v->mismatch < 0) {
+        if (v->state == WS_MATCH && v->pos < v->expected_len) {
+            size_t n = len - i < v->expected_len - v->pos ? len - i : v->expected_len - v->pos;
+            size_t same = verify_common_prefix(buf + i, v->expected + v->pos, n);
+            if (same > 0) {
+                if (v->mode == VERIFY_TOKENS) v->in_token = !is_space(buf[i + same - 1]);
+                i += same;
+                v->pos += same;
+                v->offset += same;
+                continue;
+            }
+        }
+
+        int rc;
+        if (v->mode == VERIFY_WHITESPACE) {
+            rc = step_whitespace(v, buf[i]);
+        } else if (v->mode == VERIFY_TOKENS) {
+            rc = step_tokens(v, buf[i]);
+        } else {
+            rc = -1;    // Not part of a common prefix
+        }
+        if (rc != 0) {
+            // Whitespace inside a line: the difference began where it did
+            v->mismatch = (long long)(v->state == WS_PENDING ? v->pending_at : v->offset);
+            break;
+        }
+        i++;
+        v->offset++;
+    }
+    return v->mismatch < 0 ? 0 : -1;
+}
+
+// The output has ended. Returns -1 if it does not match (or did not before).
+int verify_finish(verifier_t *v) {
+    if (v->mismatch >= 0) return -1;
+
+    int ok;
+    if (v->mode == VERIFY_WHITESPACE) {
+        if (v->state != WS_TRAILING) {
+            while (v->pos < v->expected_len && (is_hspace(v->expected[v->pos]) || v->expected[v->pos] == '\n')) {
+                v->pos++;
+            }
+        }
+        ok = v->pos == v->expected_len;
+    } else if (v->mode == VERIFY_TOKENS) {
+        int x = peek(v);
+        ok = !(v->in_token && x >= 0 && !is_space(x));
+        skip_expected(v, is_space);
+        ok = ok && v->pos == v->expected_len;
+    } else {
+        ok = v->pos == v->expected_len;
+    }
+    if (!ok) v->mismatch = (long long)v->offset;
+    return ok ? 0 : -1;
+}
@@ -0,0 +1,35 @@
+#ifndef VERIFY_H
+#define VERIFY_H
+
+#include <stddef.h>
+
+// How output is compared with the expected output (--expect-mode)
+typedef enum {
+    VERIFY_EXACT,               // Byte for byte
+    VERIFY_WHITESPACE,          // Trailing whitespace on lines and trailing blank lines ignored
+    VERIFY_TOKENS               // Whitespace-separated tokens
+} verify_mode_t;
+
+// Incremental comparison of one output stream with an expected-output file
+typedef struct {
+    verify_mode_t mode;
+    const unsigned char *expected;  // mmap()ed, NULL when empty
+    size_t expected_len;
+    size_t pos;                 // Expected bytes accounted for
+    unsigned long long offset;  // Output bytes seen
+    int state;                  // Whitespace mode (see verify.c)
+    unsigned long long pending_at;  // Whitespace mode: where the unmatched whitespace began
+    int in_token;               // Token mode: last output byte was part of a token
+    long long mismatch;         // Output offset of the first difference (-1 = none so far)
+} verifier_t;
+
+// Function prototypes
+int verify_parse_mode(const char *name, verify_mode_t *mode);
+const char *verify_mode_name(verify_mode_t mode);
+size_t verify_common_prefix(const unsigned char *a, const unsigned char *b, size_t n);
+int verify_open(verifier_t *v, const char *expected_path, verify_mode_t mode);
+int verify_feed(verifier_t *v, const unsigned char *buf, size_t len);
+int verify_finish(verifier_t *v);
+void verify_close(verifier_t *v);
+
+#endif